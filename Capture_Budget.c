@@ -0,0 +1,400 @@
+#include <windows.h>
+#include <tlhelp32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "Capture_Budget.h"
+
+#define PAGE_WRITABLE_ANY (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)
+#define PAGE_EXECUTABLE_ANY (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)
+
+static const char *const classNames[CAPTURE_CLASS_COUNT] = { "stack", "ip", "heap", "image_data", "image_code", "bulk" };
+static const char *const outcomeNames[] = { "pending", "whole", "partial", "sampled", "skipped" };
+static const char *const stopNames[] = { "-", "budget", "deadline", "unreadable", "shutdown" };
+
+// Thread pointer inside a region, waiting to become a stack or instruction span
+typedef struct {
+    uint64_t address;
+    CaptureClass spanClass;
+} HotPoint;
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    CaptureClass spanClass;
+} HotRange;
+
+static uint64_t PageDown(uint64_t address) {
+    return address & ~(uint64_t)(CAPTURE_PAGE_SIZE - 1);
+}
+
+static uint64_t PageUp(uint64_t address) {
+    return (address + CAPTURE_PAGE_SIZE - 1) & ~(uint64_t)(CAPTURE_PAGE_SIZE - 1);
+}
+
+void StartCaptureBudget(CapturePlan *plan, uint64_t byteBudget, uint64_t timeBudgetMs) {
+    memset(plan, 0, sizeof(*plan));
+    plan->byteBudget = byteBudget;
+    plan->startTick = GetTickCount64();
+    plan->deadlineTick = plan->startTick + timeBudgetMs;
+}
+
+bool CaptureDeadlinePassed(const CapturePlan *plan) {
+    return GetTickCount64() >= plan->deadlineTick;
+}
+
+// Function to decide what a region is worth when no thread points into it; CAPTURE_CLASS_COUNT means never
+static CaptureClass RegionClass(const CaptureRegion *region) {
+    if (region->type == MEM_IMAGE) {
+        // Read-only image sections repeat the file on disk
+        if (region->protect & PAGE_EXECUTABLE_ANY) return CAPTURE_IMAGE_CODE;
+        if (region->protect & PAGE_WRITABLE_ANY) return CAPTURE_IMAGE_DATA;
+        return CAPTURE_CLASS_COUNT;
+    }
+    if (region->type == MEM_PRIVATE && region->size <= CAPTURE_SMALL_REGION) return CAPTURE_HEAP;
+    if (region->type == MEM_PRIVATE || region->type == MEM_MAPPED) return CAPTURE_BULK;
+    return CAPTURE_CLASS_COUNT;
+}
+
+static bool AddSpan(CapturePlan *plan, const CaptureRegion *region, uint64_t start, uint64_t end, CaptureClass spanClass) {
+    if (end <= start) return true;
+
+    // Neighbouring windows of the same kind, such as threads waiting in the same function, become one span
+    CaptureSpan *previous = plan->spanCount ? &plan->spans[plan->spanCount - 1] : NULL;
+    if (previous && previous->spanClass == spanClass && previous->base + previous->size == start &&
+        previous->base >= region->base) {
+        previous->size += end - start;
+        plan->plannedBytes += end - start;
+        return true;
+    }
+
+    if (plan->spanCount == plan->spanCapacity) {
+        size_t capacity = plan->spanCapacity ? plan->spanCapacity * 2 : 1024;
+        CaptureSpan *spans = (CaptureSpan *)realloc(plan->spans, capacity * sizeof(CaptureSpan));
+        if (!spans) return false;
+        plan->spans = spans;
+        plan->spanCapacity = capacity;
+    }
+    CaptureSpan *span = &plan->spans[plan->spanCount++];
+    memset(span, 0, sizeof(*span));
+    span->base = start;
+    span->size = end - start;
+    span->protect = region->protect;
+    span->type = region->type;
+    span->spanClass = spanClass;
+    span->executable = (region->protect & PAGE_EXECUTABLE_ANY) != 0;
+    plan->plannedBytes += span->size;
+    return true;
+}
+
+static int CompareHotPoints(const void *a, const void *b) {
+    uint64_t left = ((const HotPoint *)a)->address;
+    uint64_t right = ((const HotPoint *)b)->address;
+    return (left > right) - (left < right);
+}
+
+static int CompareHotRanges(const void *a, const void *b) {
+    const HotRange *left = (const HotRange *)a;
+    const HotRange *right = (const HotRange *)b;
+    if (left->start != right->start) return (left->start > right->start) - (left->start < right->start);
+    return (int)left->spanClass - (int)right->spanClass;
+}
+
+// Capture order: class first; bulk spans smallest first so the budget a small one leaves passes to the larger ones
+static int CompareSpans(const void *a, const void *b) {
+    const CaptureSpan *left = (const CaptureSpan *)a;
+    const CaptureSpan *right = (const CaptureSpan *)b;
+    if (left->spanClass != right->spanClass) return (int)left->spanClass - (int)right->spanClass;
+    if (left->spanClass == CAPTURE_BULK && left->size != right->size) return (left->size > right->size) - (left->size < right->size);
+    return (left->base > right->base) - (left->base < right->base);
+}
+
+// Function to split regions (in address order) into spans around thread stacks and instruction pointers,
+// then order the spans for capture
+bool PlanCaptureSpans(CapturePlan *plan, const CaptureRegion *regions, size_t regionCount,
+                      const ThreadPointers *threads, size_t threadCount) {
+    HotPoint *points = (HotPoint *)malloc((threadCount * 2 + 1) * sizeof(HotPoint));
+    HotRange *ranges = (HotRange *)malloc((threadCount * 2 + 1) * sizeof(HotRange));
+    bool ok = points && ranges;
+    size_t pointCount = 0;
+    for (size_t i = 0; ok && i < threadCount; i++) {
+        points[pointCount].address = threads[i].stackPointer;
+        points[pointCount++].spanClass = CAPTURE_STACK;
+        points[pointCount].address = threads[i].instructionPointer;
+        points[pointCount++].spanClass = CAPTURE_INSTRUCTION;
+    }
+    if (pointCount > 1) qsort(points, pointCount, sizeof(HotPoint), CompareHotPoints);
+    plan->regionCount = regionCount;
+    plan->threadCount = (uint32_t)threadCount;
+
+    size_t point = 0;
+    for (size_t r = 0; ok && r < regionCount; r++) {
+        const CaptureRegion *region = &regions[r];
+        uint64_t end = region->base + region->size;
+        while (point < pointCount && points[point].address < region->base) point++;
+
+        size_t rangeCount = 0;
+        for (; point < pointCount && points[point].address < end; point++) {
+            HotRange *range = &ranges[rangeCount++];
+            range->spanClass = points[point].spanClass;
+            if (range->spanClass == CAPTURE_STACK) {
+                // Stacks grow down: the live frames run from the stack pointer to the top of the region
+                range->start = PageDown(points[point].address);
+                range->end = end;
+            } else {
+                uint64_t address = points[point].address;
+                range->start = address - region->base > CAPTURE_IP_WINDOW / 2 ? PageDown(address - CAPTURE_IP_WINDOW / 2) : region->base;
+                range->end = end - address > CAPTURE_IP_WINDOW / 2 ? PageUp(address + CAPTURE_IP_WINDOW / 2) : end;
+            }
+        }
+
+        CaptureClass regionClass = RegionClass(region);
+        if (rangeCount == 0 && regionClass == CAPTURE_CLASS_COUNT) continue;
+        if (rangeCount > 1) qsort(ranges, rangeCount, sizeof(HotRange), CompareHotRanges);
+
+        // Hot ranges in address order; where two overlap, the earlier one keeps the shared bytes
+        uint64_t cursor = region->base;
+        for (size_t i = 0; ok && i < rangeCount; i++) {
+            uint64_t start = ranges[i].start > cursor ? ranges[i].start : cursor;
+            if (ranges[i].end <= start) continue;
+            if (regionClass != CAPTURE_CLASS_COUNT) ok = AddSpan(plan, region, cursor, start, regionClass);
+            ok = ok && AddSpan(plan, region, start, ranges[i].end, ranges[i].spanClass);
+            cursor = ranges[i].end;
+        }
+        if (ok && regionClass != CAPTURE_CLASS_COUNT) ok = AddSpan(plan, region, cursor, end, regionClass);
+    }
+
+    if (ok && plan->spanCount > 1) qsort(plan->spans, plan->spanCount, sizeof(CaptureSpan), CompareSpans);
+    for (size_t i = 0; ok && i < plan->spanCount; i++) {
+        if (plan->spans[i].spanClass == CAPTURE_BULK) plan->bulkRemaining++;
+    }
+    free(points);
+    free(ranges);
+    return ok;
+}
+
+// Function to read a thread's instruction and stack pointers, suspending it for the moment it takes
+static bool ReadThreadPointers(HANDLE hThread, bool wow64, ThreadPointers *pointers) {
+#ifdef _WIN64
+    if (wow64) {
+        // A 32-bit process: its own registers, not those of the WOW64 layer underneath
+        WOW64_CONTEXT wowContext;
+        memset(&wowContext, 0, sizeof(wowContext));
+        wowContext.ContextFlags = WOW64_CONTEXT_CONTROL;
+        if (Wow64SuspendThread(hThread) == (DWORD)-1) return false;
+        bool ok = Wow64GetThreadContext(hThread, &wowContext) != 0;
+        ResumeThread(hThread);
+        pointers->instructionPointer = wowContext.Eip;
+        pointers->stackPointer = wowContext.Esp;
+        return ok;
+    }
+#else
+    (void)wow64;
+#endif
+    CONTEXT context;
+    memset(&context, 0, sizeof(context));
+    context.ContextFlags = CONTEXT_CONTROL;
+    if (SuspendThread(hThread) == (DWORD)-1) return false;
+    bool ok = GetThreadContext(hThread, &context) != 0;
+    ResumeThread(hThread);
+#ifdef _WIN64
+    pointers->instructionPointer = context.Rip;
+    pointers->stackPointer = context.Rsp;
+#else
+    pointers->instructionPointer = context.Eip;
+    pointers->stackPointer = context.Esp;
+#endif
+    return ok;
+}
+
+static size_t CollectThreadPointers(HANDLE hProcess, DWORD pid, ThreadPointers **threads) {
+    size_t count = 0, capacity = 0;
+    *threads = NULL;
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) return 0;
+
+    BOOL wow64 = FALSE;
+    IsWow64Process(hProcess, &wow64);
+    THREADENTRY32 entry;
+    entry.dwSize = sizeof(entry);
+    for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+        if (entry.th32OwnerProcessID != pid) continue;
+        HANDLE hThread = OpenThread(THREAD_GET_CONTEXT | THREAD_SUSPEND_RESUME | THREAD_QUERY_INFORMATION, FALSE, entry.th32ThreadID);
+        if (!hThread) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            ThreadPointers *grown = (ThreadPointers *)realloc(*threads, capacity * sizeof(ThreadPointers));
+            if (!grown) {
+                CloseHandle(hThread);
+                break;
+            }
+            *threads = grown;
+        }
+        if (ReadThreadPointers(hThread, wow64 != FALSE, &(*threads)[count])) count++;
+        CloseHandle(hThread);
+    }
+    CloseHandle(snapshot);
+    return count;
+}
+
+// Function to plan a process's capture from its committed, readable regions and its threads' registers
+bool BuildCapturePlan(CapturePlan *plan, HANDLE hProcess, DWORD pid) {
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    MEMORY_BASIC_INFORMATION memInfo;
+    CaptureRegion *regions = NULL;
+    size_t regionCount = 0, regionCapacity = 0;
+    bool ok = true;
+
+    LPVOID addr = sysInfo.lpMinimumApplicationAddress;
+    while (ok && addr < sysInfo.lpMaximumApplicationAddress) {
+        if (VirtualQueryEx(hProcess, addr, &memInfo, sizeof(memInfo)) != sizeof(memInfo)) {
+            addr = (LPVOID)((SIZE_T)addr + CAPTURE_PAGE_SIZE);  // Move to next page
+            continue;
+        }
+        bool readable = (memInfo.Protect & (PAGE_GUARD | PAGE_NOACCESS)) == 0;
+        if (memInfo.State == MEM_COMMIT && readable) {
+            if (regionCount == regionCapacity) {
+                regionCapacity = regionCapacity ? regionCapacity * 2 : 1024;
+                CaptureRegion *grown = (CaptureRegion *)realloc(regions, regionCapacity * sizeof(CaptureRegion));
+                ok = grown != NULL;
+                if (!ok) break;
+                regions = grown;
+            }
+            CaptureRegion *region = &regions[regionCount++];
+            region->base = (uint64_t)(SIZE_T)memInfo.BaseAddress;
+            region->size = memInfo.RegionSize;
+            region->protect = memInfo.Protect;
+            region->type = memInfo.Type;
+        }
+        addr = (LPVOID)((SIZE_T)memInfo.BaseAddress + memInfo.RegionSize);
+    }
+
+    ThreadPointers *threads = NULL;
+    size_t threadCount = ok ? CollectThreadPointers(hProcess, pid, &threads) : 0;
+    ok = ok && PlanCaptureSpans(plan, regions, regionCount, threads, threadCount);
+    free(threads);
+    free(regions);
+    return ok;
+}
+
+void FreeCapturePlan(CapturePlan *plan) {
+    free(plan->spans);
+    plan->spans = NULL;
+    plan->spanCount = 0;
+    plan->spanCapacity = 0;
+}
+
+// Function to give a span its share of what is left of the budget and split it into pieces; 0 means skip it.
+// Other spans take what fits. A bulk span shares the rest evenly with the bulk spans after it, and if its share
+// is smaller than the span it is sampled; one no larger than a sample gets a prefix instead.
+uint32_t AllotCaptureSpan(CapturePlan *plan, CaptureSpan *span) {
+    bool bulk = span->spanClass == CAPTURE_BULK;
+    if (bulk && plan->bulkRemaining > 0) plan->bulkRemaining--;
+    uint64_t remaining = plan->bytesUsed < plan->byteBudget ? plan->byteBudget - plan->bytesUsed : 0;
+
+    span->pieceCount = 0;
+    span->allottedBytes = 0;
+    if (CaptureDeadlinePassed(plan)) {
+        span->stopReason = CAPTURE_STOP_DEADLINE;
+        return 0;
+    }
+
+    uint64_t share = bulk ? remaining / (plan->bulkRemaining + 1) : remaining;
+    if (share >= span->size) {
+        span->allottedBytes = span->size;
+    } else if (bulk && span->size > CAPTURE_SAMPLE_SIZE && remaining >= CAPTURE_SAMPLE_SIZE) {
+        uint64_t samples = share / CAPTURE_SAMPLE_SIZE;
+        span->sampled = true;
+        span->pieceSize = CAPTURE_SAMPLE_SIZE;
+        span->pieceCount = (uint32_t)(samples ? samples : 1);
+        span->allottedBytes = (uint64_t)span->pieceCount * CAPTURE_SAMPLE_SIZE;
+        return span->pieceCount;
+    } else {
+        span->allottedBytes = bulk && remaining < CAPTURE_SAMPLE_SIZE ? 0 : PageDown(share);
+    }
+
+    if (span->allottedBytes < span->size) span->stopReason = CAPTURE_STOP_BUDGET;
+    span->pieceSize = CAPTURE_PIECE_SIZE;
+    span->pieceCount = (uint32_t)((span->allottedBytes + CAPTURE_PIECE_SIZE - 1) / CAPTURE_PIECE_SIZE);
+    return span->pieceCount;
+}
+
+// Function to place a piece: consecutive from the span's start, or samples spread evenly from start to end
+uint64_t CapturePieceOffset(const CaptureSpan *span, uint32_t piece) {
+    if (!span->sampled || span->pieceCount < 2) return (uint64_t)piece * span->pieceSize;
+    // The last sample ends at the span's end; rounding the step rather than each offset keeps samples from overlapping
+    if (piece == span->pieceCount - 1) return span->size - span->pieceSize;
+    uint64_t step = PageDown((span->size - span->pieceSize) / (span->pieceCount - 1));
+    return step * piece;
+}
+
+// Function to size a piece; it never runs past the span's end, and 0 means nothing is left to read
+uint64_t CapturePieceLength(const CaptureSpan *span, uint32_t piece) {
+    uint64_t offset = CapturePieceOffset(span, piece);
+    uint64_t end = span->sampled ? span->size : span->allottedBytes;
+    if (end > span->size) end = span->size;
+    if (offset >= end) return 0;
+    return end - offset < span->pieceSize ? end - offset : span->pieceSize;
+}
+
+void RecordCapturedPiece(CapturePlan *plan, CaptureSpan *span, uint64_t bytes, bool gap) {
+    plan->bytesUsed += bytes;
+    span->capturedBytes += bytes;
+    span->piecesCaptured++;
+    if (gap) span->gapPieces++;
+}
+
+void StopCaptureSpan(CaptureSpan *span, CaptureStopReason reason) {
+    span->stopReason = reason;
+}
+
+void FinishCaptureSpan(CaptureSpan *span) {
+    if (span->capturedBytes == 0) {
+        span->outcome = CAPTURE_SKIPPED;
+    } else if (span->sampled) {
+        span->outcome = CAPTURE_SAMPLED;
+    } else {
+        span->outcome = span->capturedBytes == span->size ? CAPTURE_WHOLE : CAPTURE_PARTIAL;
+    }
+}
+
+// Function to record every span in capture order: what it was, what was read of it, and why reading stopped
+bool WriteCaptureManifest(const CapturePlan *plan, const TCHAR *fileName) {
+    FILE *manifest = _tfopen(fileName, _T("wb"));
+    if (!manifest) return false;
+
+    uint64_t classPlanned[CAPTURE_CLASS_COUNT] = {0};
+    uint64_t classCaptured[CAPTURE_CLASS_COUNT] = {0};
+    for (size_t i = 0; i < plan->spanCount; i++) {
+        classPlanned[plan->spans[i].spanClass] += plan->spans[i].size;
+        classCaptured[plan->spans[i].spanClass] += plan->spans[i].capturedBytes;
+    }
+
+    fprintf(manifest, "# Captured %llu of %llu bytes in %llu ms (budget %llu bytes, %llu ms); %u spans from %u regions, %u threads\r\n",
+            (unsigned long long)plan->bytesUsed, (unsigned long long)plan->plannedBytes,
+            (unsigned long long)(GetTickCount64() - plan->startTick), (unsigned long long)plan->byteBudget,
+            (unsigned long long)(plan->deadlineTick - plan->startTick), (unsigned)plan->spanCount,
+            (unsigned)plan->regionCount, plan->threadCount);
+    for (int c = 0; c < CAPTURE_CLASS_COUNT; c++) {
+        fprintf(manifest, "# %s %llu of %llu bytes\r\n", classNames[c], (unsigned long long)classCaptured[c],
+                (unsigned long long)classPlanned[c]);
+    }
+    fprintf(manifest, "# class base size protect type outcome captured_bytes stop gap_pieces; sampled spans list each sample\r\n");
+
+    for (size_t i = 0; i < plan->spanCount; i++) {
+        const CaptureSpan *span = &plan->spans[i];
+        fprintf(manifest, "%s %016llx %016llx %08x %08x %s %llu %s %u\r\n", classNames[span->spanClass],
+                (unsigned long long)span->base, (unsigned long long)span->size, span->protect, span->type,
+                outcomeNames[span->outcome], (unsigned long long)span->capturedBytes, stopNames[span->stopReason],
+                span->gapPieces);
+        for (uint32_t piece = 0; span->sampled && piece < span->piecesCaptured; piece++) {
+            fprintf(manifest, "  sample %016llx %016llx\r\n", (unsigned long long)(span->base + CapturePieceOffset(span, piece)),
+                    (unsigned long long)span->pieceSize);
+        }
+    }
+    return fclose(manifest) == 0;
+}
@@ -0,0 +1,107 @@
+#ifndef CAPTURE_BUDGET_H
+#define CAPTURE_BUDGET_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+
+#define CAPTURE_BYTE_BUDGET (256ull * 1024 * 1024)  // Process memory read per capture
+#define CAPTURE_TIME_BUDGET_MS 15000                 // Wall time per capture, including waits on the pipeline
+#define CAPTURE_IP_WINDOW (64 * 1024)                // Bytes around each thread's instruction pointer
+#define CAPTURE_SMALL_REGION (4 * 1024 * 1024)       // Largest private region treated as heap rather than bulk
+#define CAPTURE_PIECE_SIZE (4 * 1024 * 1024)         // Most bytes read between deadline checks
+#define CAPTURE_SAMPLE_SIZE (1024 * 1024)            // Bytes per sample of a bulk region too large to capture whole
+#define CAPTURE_PAGE_SIZE 0x1000
+#define CAPTURE_MANIFEST_FILE _T("windbg_output_memory_manifest.txt")
+
+// Span classes in capture order
+typedef enum {
+    CAPTURE_STACK,                      // Live part of a thread stack, from the stack pointer up
+    CAPTURE_INSTRUCTION,                // Window around a thread's instruction pointer
+    CAPTURE_HEAP,                       // Private region up to CAPTURE_SMALL_REGION
+    CAPTURE_IMAGE_DATA,                 // Writable image section: the module's globals
+    CAPTURE_IMAGE_CODE,                 // Executable image section
+    CAPTURE_BULK,                       // Large private or mapped region; sampled once the budget is short
+    CAPTURE_CLASS_COUNT
+} CaptureClass;
+
+typedef enum {
+    CAPTURE_PENDING,
+    CAPTURE_WHOLE,
+    CAPTURE_PARTIAL,                    // A prefix of the span; stopReason says why it ended
+    CAPTURE_SAMPLED,                    // Evenly spaced samples of the span
+    CAPTURE_SKIPPED
+} CaptureOutcome;
+
+typedef enum {
+    CAPTURE_STOP_NONE,
+    CAPTURE_STOP_BUDGET,
+    CAPTURE_STOP_DEADLINE,
+    CAPTURE_STOP_UNREADABLE,
+    CAPTURE_STOP_SHUTDOWN
+} CaptureStopReason;
+
+// Committed, readable region as reported by VirtualQueryEx
+typedef struct {
+    uint64_t base;
+    uint64_t size;
+    uint32_t protect;
+    uint32_t type;
+} CaptureRegion;
+
+typedef struct {
+    uint64_t instructionPointer;
+    uint64_t stackPointer;
+} ThreadPointers;
+
+// Part of a region captured as one unit; pieces are read and submitted to the pipeline separately
+typedef struct {
+    uint64_t base;
+    uint64_t size;
+    uint32_t protect;
+    uint32_t type;
+    CaptureClass spanClass;
+    bool executable;
+    uint64_t allottedBytes;             // Set by AllotCaptureSpan
+    uint32_t pieceCount;
+    uint64_t pieceSize;
+    bool sampled;
+    uint32_t piecesCaptured;            // Pieces are captured in order, so these are the first ones
+    uint64_t capturedBytes;
+    uint32_t gapPieces;                 // Captured pieces with pages that vanished mid-read, zero-filled
+    CaptureOutcome outcome;
+    CaptureStopReason stopReason;
+} CaptureSpan;
+
+// Spans in capture order, with the budget they are drawn from
+typedef struct {
+    CaptureSpan *spans;
+    size_t spanCount;
+    size_t spanCapacity;
+    size_t regionCount;
+    uint32_t threadCount;
+    uint64_t plannedBytes;
+    uint64_t byteBudget;
+    uint64_t bytesUsed;
+    uint64_t startTick;
+    uint64_t deadlineTick;
+    size_t bulkRemaining;               // Bulk spans not yet allotted, sharing what is left of the budget
+} CapturePlan;
+
+void StartCaptureBudget(CapturePlan *plan, uint64_t byteBudget, uint64_t timeBudgetMs);
+bool PlanCaptureSpans(CapturePlan *plan, const CaptureRegion *regions, size_t regionCount,
+                      const ThreadPointers *threads, size_t threadCount);
+bool BuildCapturePlan(CapturePlan *plan, HANDLE hProcess, DWORD pid);
+void FreeCapturePlan(CapturePlan *plan);
+bool CaptureDeadlinePassed(const CapturePlan *plan);
+uint32_t AllotCaptureSpan(CapturePlan *plan, CaptureSpan *span);
+uint64_t CapturePieceOffset(const CaptureSpan *span, uint32_t piece);
+uint64_t CapturePieceLength(const CaptureSpan *span, uint32_t piece);
+void RecordCapturedPiece(CapturePlan *plan, CaptureSpan *span, uint64_t bytes, bool gap);
+void StopCaptureSpan(CaptureSpan *span, CaptureStopReason reason);
+void FinishCaptureSpan(CaptureSpan *span);
+bool WriteCaptureManifest(const CapturePlan *plan, const TCHAR *fileName);
+
+#endif
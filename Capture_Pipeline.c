@@ -0,0 +1,421 @@
+#include <stdlib.h>
+#include <string.h>
+#include "Capture_Pipeline.h"
+
+#define PIPELINE_RING_MASK (PIPELINE_RING_SIZE - 1)
+#define PIPELINE_SPIN_LIMIT 64          // Busy-wait rounds before yielding the processor
+#define PIPELINE_YIELD_LIMIT 128        // Yield rounds before sleeping between polls, or blocking on an empty ring
+
+// Function to read a shared counter with acquire semantics
+static LONG AtomicLoad(volatile LONG *value) {
+    return InterlockedCompareExchange(value, 0, 0);
+}
+
+static LONG NextPosition(LONG position) {
+    return (LONG)((ULONG)position + 1);
+}
+
+// Function to wait for a queue to change: spin briefly, then yield, then sleep
+static void Backoff(int *rounds) {
+    if (*rounds < PIPELINE_SPIN_LIMIT) {
+        YieldProcessor();
+    } else if (*rounds < PIPELINE_YIELD_LIMIT) {
+        SwitchToThread();
+    } else {
+        Sleep(1);
+    }
+    (*rounds)++;
+}
+
+// Function to push an item; only the producing stage calls this
+bool SpscPush(SpscRing *ring, const PipelineItem *item) {
+    LONG tail = ring->tail;
+    LONG head = AtomicLoad(&ring->head);
+    if ((ULONG)tail - (ULONG)head >= PIPELINE_RING_SIZE) {
+        return false;
+    }
+    ring->items[(ULONG)tail & PIPELINE_RING_MASK] = *item;
+    InterlockedExchange(&ring->tail, NextPosition(tail));      // Publish the slot
+    if (ring->itemReady && AtomicLoad(&ring->consumerWaiting)) {
+        SetEvent(ring->itemReady);
+    }
+    return true;
+}
+
+// Function to pop an item; only the consuming stage calls this
+bool SpscPop(SpscRing *ring, PipelineItem *item) {
+    LONG head = ring->head;
+    LONG tail = AtomicLoad(&ring->tail);
+    if (head == tail) {
+        return false;
+    }
+    *item = ring->items[(ULONG)head & PIPELINE_RING_MASK];
+    InterlockedExchange(&ring->head, NextPosition(head));      // Hand the slot back
+    return true;
+}
+
+// Function to initialise a bounded MPMC queue: each cell's sequence says which lap may use it
+void InitMpmcQueue(MpmcQueue *queue) {
+    for (LONG i = 0; i < PIPELINE_RING_SIZE; i++) {
+        queue->cells[i].sequence = i;
+        queue->cells[i].data = NULL;
+    }
+    queue->enqueuePosition = 0;
+    queue->dequeuePosition = 0;
+}
+
+bool MpmcPush(MpmcQueue *queue, void *data) {
+    LONG position = AtomicLoad(&queue->enqueuePosition);
+    MpmcCell *cell;
+    while (true) {
+        cell = &queue->cells[(ULONG)position & PIPELINE_RING_MASK];
+        LONG difference = (LONG)((ULONG)AtomicLoad(&cell->sequence) - (ULONG)position);
+        if (difference == 0) {
+            // Cell is free on this lap; claim the position
+            if (InterlockedCompareExchange(&queue->enqueuePosition, NextPosition(position), position) == position) break;
+            position = AtomicLoad(&queue->enqueuePosition);
+        } else if (difference < 0) {
+            return false;               // Full
+        } else {
+            position = AtomicLoad(&queue->enqueuePosition);
+        }
+    }
+    cell->data = data;
+    InterlockedExchange(&cell->sequence, NextPosition(position));
+    return true;
+}
+
+void *MpmcPop(MpmcQueue *queue) {
+    LONG position = AtomicLoad(&queue->dequeuePosition);
+    MpmcCell *cell;
+    while (true) {
+        cell = &queue->cells[(ULONG)position & PIPELINE_RING_MASK];
+        LONG difference = (LONG)((ULONG)AtomicLoad(&cell->sequence) - (ULONG)NextPosition(position));
+        if (difference == 0) {
+            if (InterlockedCompareExchange(&queue->dequeuePosition, NextPosition(position), position) == position) break;
+            position = AtomicLoad(&queue->dequeuePosition);
+        } else if (difference < 0) {
+            return NULL;                // Empty
+        } else {
+            position = AtomicLoad(&queue->dequeuePosition);
+        }
+    }
+    void *data = cell->data;
+    InterlockedExchange(&cell->sequence, (LONG)((ULONG)position + PIPELINE_RING_SIZE));   // Free for the next lap
+    return data;
+}
+
+// Function to push into the next stage, waiting while it is full
+static void PushItem(SpscRing *ring, const PipelineItem *item) {
+    int rounds = 0;
+    while (!SpscPush(ring, item)) {
+        Backoff(&rounds);
+    }
+}
+
+// Function to pop from a stage's input: spin and yield briefly, then block on the ring's event until a push
+static void PopItem(SpscRing *ring, PipelineItem *item) {
+    int rounds = 0;
+    while (!SpscPop(ring, item)) {
+        if (rounds < PIPELINE_YIELD_LIMIT || !ring->itemReady) {
+            Backoff(&rounds);
+            continue;
+        }
+        // Announce the wait before looking again, so a push in between either is seen or signals the event
+        InterlockedExchange(&ring->consumerWaiting, 1);
+        if (!SpscPop(ring, item)) {
+            WaitForSingleObject(ring->itemReady, INFINITE);
+            InterlockedExchange(&ring->consumerWaiting, 0);
+            continue;
+        }
+        InterlockedExchange(&ring->consumerWaiting, 0);
+        return;
+    }
+}
+
+// Function to return a block to the pool once the last stage is done with it
+void ReleaseCaptureBlock(CapturePipeline *pipeline, CaptureBlock *block) {
+    MpmcPush(&pipeline->freeBlocks, block);
+}
+
+// Parse stage: split the finished transcript into timed command sections and pull strings out of memory
+static void ParseItem(CapturePipeline *pipeline, PipelineItem *item) {
+    CaptureJob *job = item->job;
+    (void)pipeline;
+    if (item->kind == PIPELINE_JOB_BEGIN) {
+        if (job->quitDetected) {
+            // The transcript is complete; its .echotime stamps time each debugger command
+            TCHAR clipboardFileName[PIPELINE_PATH_SIZE + 32];
+            _stprintf(clipboardFileName, _T("%s\\windbg_output_clipboard.txt"), job->outputFolder);
+            RecordDebuggerCommandTimings(clipboardFileName);
+        }
+        TCHAR stringsFileName[PIPELINE_PATH_SIZE + 32];
+        _stprintf(stringsFileName, _T("%s\\windbg_output_strings.txt"), job->outputFolder);
+        job->stringsFile = _tfopen(stringsFileName, _T("wb"));
+        job->strings = (StringExtractor*)malloc(sizeof(StringExtractor));
+        if (job->strings && job->stringsFile) {
+            BeginStringExtraction(job->strings, job->stringsFile);
+        }
+    } else if (item->kind == PIPELINE_REGION_DATA) {
+        // Extract ASCII and UTF-16 strings as UTF-8 text
+        if (job->strings && job->stringsFile) {
+            CaptureBlock *block = item->block;
+            if (block->regionStart) BeginStringRegion(job->strings, block->regionBase);
+            AppendStringData(job->strings, block->data, block->length);
+            if (block->regionEnd) EndStringRegion(job->strings);
+        }
+    } else if (item->kind == PIPELINE_JOB_END) {
+        if (job->stringsFile) {
+            fclose(job->stringsFile);
+            job->stringsFile = NULL;
+        }
+        free(job->strings);
+        job->strings = NULL;
+    }
+}
+
+// Feature stage: page entropy map and opcode n-grams of executable regions
+static void FeatureItem(CapturePipeline *pipeline, PipelineItem *item) {
+    CaptureJob *job = item->job;
+    (void)pipeline;
+    if (item->kind == PIPELINE_JOB_BEGIN) {
+        TCHAR entropyFileName[PIPELINE_PATH_SIZE + 32];
+        TCHAR opcodesFileName[PIPELINE_PATH_SIZE + 32];
+        _stprintf(entropyFileName, _T("%s\\windbg_output_entropy.txt"), job->outputFolder);
+        _stprintf(opcodesFileName, _T("%s\\windbg_output_opcodes.txt"), job->outputFolder);
+        job->entropy = (EntropyMapWriter*)malloc(sizeof(EntropyMapWriter));
+        if (job->entropy && !BeginEntropyMap(job->entropy, entropyFileName)) {
+            _tprintf(_T("Failed to create entropy map for process %d\n"), job->pid);
+            free(job->entropy);
+            job->entropy = NULL;
+        }
+        job->opcodes = (OpcodeFeatureWriter*)malloc(sizeof(OpcodeFeatureWriter));
+        if (job->opcodes && !BeginOpcodeFeatures(job->opcodes, opcodesFileName)) {
+            _tprintf(_T("Failed to create opcode features for process %d\n"), job->pid);
+            free(job->opcodes);
+            job->opcodes = NULL;
+        }
+    } else if (item->kind == PIPELINE_REGION_DATA) {
+        CaptureBlock *block = item->block;
+        if (job->entropy) {
+            if (block->regionStart) {
+                BeginEntropyRegion(job->entropy, block->regionBase, block->regionSize, block->protect, block->type);
+            }
+            AppendEntropyData(job->entropy, block->data, block->length);
+            if (block->regionEnd) EndEntropyRegion(job->entropy);
+        }
+
+        // Linear-sweep the code for opcode n-gram features
+        if (job->opcodes && block->executable) {
+            if (block->regionStart) {
+                BeginOpcodeRegion(job->opcodes, block->regionBase, block->regionSize, block->protect, block->type,
+                                  block->moduleName);
+            }
+            AppendOpcodeData(job->opcodes, block->data, block->length);
+            if (block->regionEnd) EndOpcodeRegion(job->opcodes);
+        }
+    } else if (item->kind == PIPELINE_JOB_END) {
+        TCHAR featuresFileName[PIPELINE_PATH_SIZE + 32];
+        if (job->entropy) {
+            _stprintf(featuresFileName, _T("%s\\windbg_output_memory.features"), job->outputFolder);
+            EndEntropyMap(job->entropy);
+            WriteEntropyFeatures(&job->entropy->summary, featuresFileName);
+            free(job->entropy);
+            job->entropy = NULL;
+        }
+        if (job->opcodes) {
+            _stprintf(featuresFileName, _T("%s\\windbg_output_opcodes.features"), job->outputFolder);
+            EndOpcodeFeatures(job->opcodes);
+            WriteOpcodeFeatures(&job->opcodes->total, featuresFileName);
+            free(job->opcodes);
+            job->opcodes = NULL;
+        }
+    }
+}
+
+// Persistence stage: chunk the memory into the store, then fold the finished process into the fleet sketch
+static void PersistItem(CapturePipeline *pipeline, PipelineItem *item) {
+    CaptureJob *job = item->job;
+    if (item->kind == PIPELINE_JOB_BEGIN) {
+        TCHAR recipeFileName[PIPELINE_PATH_SIZE + 32];
+        _stprintf(recipeFileName, _T("%s\\windbg_output_memory.recipe"), job->outputFolder);
+        job->recipe = (ChunkRecipeWriter*)malloc(sizeof(ChunkRecipeWriter));
+        if (job->recipe && !BeginChunkRecipe(job->recipe, pipeline->store, recipeFileName)) {
+            _tprintf(_T("Failed to create memory recipe for process %d\n"), job->pid);
+            free(job->recipe);
+            job->recipe = NULL;
+        }
+    } else if (item->kind == PIPELINE_REGION_DATA) {
+        CaptureBlock *block = item->block;
+        if (job->recipe) {
+            if (block->regionStart) {
+                BeginChunkRegion(job->recipe, block->regionBase, block->regionSize, block->protect, block->type);
+            }
+            AppendChunkData(job->recipe, block->data, block->length);
+            if (block->regionEnd) EndChunkRegion(job->recipe);
+        }
+        ReleaseCaptureBlock(pipeline, block);
+    } else if (item->kind == PIPELINE_JOB_END) {
+        if (job->recipe) {
+            if (!EndChunkRecipe(job->recipe)) {
+                _tprintf(_T("Memory recipe for process %d is incomplete: %llu chunks could not be stored\n"),
+                         job->pid, (unsigned long long)job->recipe->failedChunks);
+                AddMetricCounter("recipe_failures", 1);
+            }
+            PrintChunkStoreStats(_T("Memory dump"), &job->recipe->stats);
+            free(job->recipe);
+        }
+        PrintChunkStoreStats(_T("Sweep chunk store"), &pipeline->store->stats);
+
+        if (pipeline->fleetSketch) {
+            MetricTimer sketchTimer = BeginMetricTimer();
+            AddProcessToFleetSketch(pipeline->fleetSketch, job->outputFolder, job->processName);
+            SaveFleetSketch(pipeline->fleetSketch, pipeline->fleetSketchFileName);
+            EndMetricTimer(sketchTimer, "fleet_sketch");
+        }
+
+        EndMetricTimer(job->timer, "process_total");
+        AddMetricCounter("processes_captured", 1);
+        free(job);
+        InterlockedDecrement(&pipeline->jobsInFlight);
+    }
+}
+
+// Function run by each stage thread until the shutdown item passes through
+static DWORD WINAPI StageThread(LPVOID parameter) {
+    PipelineStage *stage = (PipelineStage*)parameter;
+    PipelineItem item;
+    while (true) {
+        PopItem(stage->input, &item);
+        if (item.kind == PIPELINE_SHUTDOWN) {
+            if (stage->output) PushItem(stage->output, &item);
+            break;
+        }
+
+        MetricTimer stageTimer = BeginMetricTimer();
+        stage->process(stage->pipeline, &item);
+        EndMetricTimer(stageTimer, stage->name);
+        if (stage->output) PushItem(stage->output, &item);
+    }
+    return 0;
+}
+
+// Function to allocate the block pool and start the stage threads
+bool StartCapturePipeline(CapturePipeline *pipeline, ChunkStore *store, FleetSketch *fleetSketch, const TCHAR *fleetSketchFileName) {
+    static const char *stageNames[PIPELINE_STAGE_COUNT] = { "parse", "features", "persist" };
+    static void (*stageProcess[PIPELINE_STAGE_COUNT])(CapturePipeline*, PipelineItem*) = { ParseItem, FeatureItem, PersistItem };
+
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->store = store;
+    pipeline->fleetSketch = fleetSketch;
+    pipeline->fleetSketchFileName = fleetSketchFileName;
+    pipeline->blocks = (CaptureBlock*)malloc(sizeof(CaptureBlock) * PIPELINE_BLOCK_COUNT);
+    if (!pipeline->blocks) {
+        return false;
+    }
+    InitMpmcQueue(&pipeline->freeBlocks);
+    for (int i = 0; i < PIPELINE_BLOCK_COUNT; i++) {
+        MpmcPush(&pipeline->freeBlocks, &pipeline->blocks[i]);
+    }
+
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        PipelineStage *stage = &pipeline->stages[i];
+        stage->pipeline = pipeline;
+        stage->name = stageNames[i];
+        stage->input = &pipeline->rings[i];
+        stage->output = i + 1 < PIPELINE_STAGE_COUNT ? &pipeline->rings[i + 1] : NULL;
+        stage->process = stageProcess[i];
+        pipeline->rings[i].itemReady = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (!pipeline->rings[i].itemReady) {
+            StopCapturePipeline(pipeline);
+            return false;
+        }
+    }
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        pipeline->stages[i].thread = CreateThread(NULL, 0, StageThread, &pipeline->stages[i], 0, NULL);
+        if (!pipeline->stages[i].thread) {
+            StopCapturePipeline(pipeline);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to queue a new process; the parse, feature and persistence stages open their own outputs
+CaptureJob *BeginCaptureJob(CapturePipeline *pipeline, DWORD pid, const TCHAR *processName, const TCHAR *outputFolder, bool quitDetected) {
+    CaptureJob *job = (CaptureJob*)calloc(1, sizeof(CaptureJob));
+    if (!job) {
+        return NULL;
+    }
+    job->pid = pid;
+    _tcsncpy(job->processName, processName, PIPELINE_PATH_SIZE - 1);
+    _tcsncpy(job->outputFolder, outputFolder, PIPELINE_PATH_SIZE - 1);
+    job->quitDetected = quitDetected;
+    job->timer = BeginMetricTimer();
+    InterlockedIncrement(&pipeline->jobsInFlight);
+
+    PipelineItem item = { PIPELINE_JOB_BEGIN, job, NULL };
+    PushItem(&pipeline->rings[PIPELINE_STAGE_PARSE], &item);
+    return job;
+}
+
+// Function to take a free block, waiting for the persistence stage to return one if all are in flight
+CaptureBlock *AcquireCaptureBlock(CapturePipeline *pipeline) {
+    CaptureBlock *block = (CaptureBlock*)MpmcPop(&pipeline->freeBlocks);
+    if (block) {
+        return block;
+    }
+
+    AddMetricCounter("pipeline_block_waits", 1);
+    int rounds = 0;
+    while (!(block = (CaptureBlock*)MpmcPop(&pipeline->freeBlocks))) {
+        Backoff(&rounds);
+    }
+    return block;
+}
+
+void SubmitCaptureBlock(CapturePipeline *pipeline, CaptureJob *job, CaptureBlock *block) {
+    PipelineItem item = { PIPELINE_REGION_DATA, job, block };
+    PushItem(&pipeline->rings[PIPELINE_STAGE_PARSE], &item);
+}
+
+// Function to close a process; capture can move on while the stages finish it
+void EndCaptureJob(CapturePipeline *pipeline, CaptureJob *job) {
+    PipelineItem item = { PIPELINE_JOB_END, job, NULL };
+    PushItem(&pipeline->rings[PIPELINE_STAGE_PARSE], &item);
+}
+
+// Function to drain every queued process, stop the stage threads and free the block pool
+void StopCapturePipeline(CapturePipeline *pipeline) {
+    PipelineItem item = { PIPELINE_SHUTDOWN, NULL, NULL };
+    LONG pendingJobs = AtomicLoad(&pipeline->jobsInFlight);
+    if (pendingJobs > 0) {
+        _tprintf(_T("Finishing %ld queued process captures...\n"), (long)pendingJobs);
+    }
+    HANDLE threads[PIPELINE_STAGE_COUNT];
+    DWORD threadCount = 0;
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        if (pipeline->stages[i].thread) threads[threadCount++] = pipeline->stages[i].thread;
+    }
+
+    if (threadCount == PIPELINE_STAGE_COUNT) {
+        PushItem(&pipeline->rings[PIPELINE_STAGE_PARSE], &item);
+        WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+    } else {
+        // Startup failed part way; the running stages have no work queued
+        for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+            if (pipeline->stages[i].thread) PushItem(&pipeline->rings[i], &item);
+        }
+        if (threadCount) WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+    }
+    for (DWORD i = 0; i < threadCount; i++) {
+        CloseHandle(threads[i]);
+    }
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        if (pipeline->rings[i].itemReady) CloseHandle(pipeline->rings[i].itemReady);
+        pipeline->rings[i].itemReady = NULL;
+    }
+    memset(pipeline->stages, 0, sizeof(pipeline->stages));
+    free(pipeline->blocks);
+    pipeline->blocks = NULL;
+}
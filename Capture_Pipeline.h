@@ -0,0 +1,127 @@
+#ifndef CAPTURE_PIPELINE_H
+#define CAPTURE_PIPELINE_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+#include "Chunk_Store.h"
+#include "Memory_Entropy.h"
+#include "Opcode_Features.h"
+#include "Text_Encoding.h"
+#include "Fleet_Sketch.h"
+#include "Sweep_Metrics.h"
+
+#define PIPELINE_BLOCK_SIZE (1024 * 1024)   // Region bytes per pooled block
+#define PIPELINE_BLOCK_COUNT 32             // Blocks in flight; capture waits when all are queued
+#define PIPELINE_RING_SIZE 64               // Power of two, at least PIPELINE_BLOCK_COUNT + control items
+#define PIPELINE_PATH_SIZE 1024
+#define PIPELINE_CACHE_LINE 64
+
+// Pooled block of process memory; one region may span several blocks
+typedef struct {
+    uint64_t regionBase;
+    uint64_t regionSize;
+    uint32_t protect;
+    uint32_t type;
+    bool regionStart;                       // First block of the region
+    bool regionEnd;                         // Last block of the region
+    bool executable;
+    char moduleName[OPCODE_MODULE_NAME_SIZE];
+    size_t length;
+    uint8_t data[PIPELINE_BLOCK_SIZE];
+} CaptureBlock;
+
+// One captured process; each writer is only touched by the stage that owns it
+typedef struct {
+    DWORD pid;
+    TCHAR processName[PIPELINE_PATH_SIZE];
+    TCHAR outputFolder[PIPELINE_PATH_SIZE];
+    bool quitDetected;                      // Transcript is complete and can be parsed for command timings
+    MetricTimer timer;
+    StringExtractor *strings;               // Parse stage
+    FILE *stringsFile;
+    EntropyMapWriter *entropy;              // Feature stage
+    OpcodeFeatureWriter *opcodes;
+    ChunkRecipeWriter *recipe;              // Persistence stage
+} CaptureJob;
+
+typedef enum {
+    PIPELINE_JOB_BEGIN,
+    PIPELINE_REGION_DATA,
+    PIPELINE_JOB_END,
+    PIPELINE_SHUTDOWN
+} PipelineItemKind;
+
+typedef struct {
+    PipelineItemKind kind;
+    CaptureJob *job;
+    CaptureBlock *block;                    // PIPELINE_REGION_DATA only
+} PipelineItem;
+
+// Single-producer single-consumer ring between two neighbouring stages
+typedef struct {
+    volatile LONG head;                     // Next slot to pop, written by the consumer
+    char headPadding[PIPELINE_CACHE_LINE - sizeof(LONG)];
+    volatile LONG tail;                     // Next slot to push, written by the producer
+    char tailPadding[PIPELINE_CACHE_LINE - sizeof(LONG)];
+    volatile LONG consumerWaiting;          // Set while an idle consumer blocks on itemReady
+    HANDLE itemReady;                       // Auto-reset event; NULL when the consumer only polls
+    PipelineItem items[PIPELINE_RING_SIZE];
+} SpscRing;
+
+// Bounded multi-producer multi-consumer queue of pointers, used as the block free list
+typedef struct {
+    volatile LONG sequence;
+    void *data;
+} MpmcCell;
+
+typedef struct {
+    volatile LONG enqueuePosition;
+    char enqueuePadding[PIPELINE_CACHE_LINE - sizeof(LONG)];
+    volatile LONG dequeuePosition;
+    char dequeuePadding[PIPELINE_CACHE_LINE - sizeof(LONG)];
+    MpmcCell cells[PIPELINE_RING_SIZE];
+} MpmcQueue;
+
+struct CapturePipeline;
+
+typedef struct {
+    struct CapturePipeline *pipeline;
+    const char *name;                       // Metric stage name
+    SpscRing *input;
+    SpscRing *output;                       // NULL for the last stage
+    void (*process)(struct CapturePipeline *pipeline, PipelineItem *item);
+    HANDLE thread;
+} PipelineStage;
+
+enum { PIPELINE_STAGE_PARSE, PIPELINE_STAGE_FEATURES, PIPELINE_STAGE_PERSIST, PIPELINE_STAGE_COUNT };
+
+// Capture -> parse (transcript sections, strings) -> features (entropy, opcodes) -> persist (chunk store, sketch)
+typedef struct CapturePipeline {
+    SpscRing rings[PIPELINE_STAGE_COUNT];   // rings[i] feeds stages[i]
+    MpmcQueue freeBlocks;
+    CaptureBlock *blocks;
+    PipelineStage stages[PIPELINE_STAGE_COUNT];
+    ChunkStore *store;
+    FleetSketch *fleetSketch;
+    const TCHAR *fleetSketchFileName;
+    volatile LONG jobsInFlight;
+} CapturePipeline;
+
+bool SpscPush(SpscRing *ring, const PipelineItem *item);
+bool SpscPop(SpscRing *ring, PipelineItem *item);
+void InitMpmcQueue(MpmcQueue *queue);
+bool MpmcPush(MpmcQueue *queue, void *data);
+void *MpmcPop(MpmcQueue *queue);
+
+bool StartCapturePipeline(CapturePipeline *pipeline, ChunkStore *store, FleetSketch *fleetSketch, const TCHAR *fleetSketchFileName);
+CaptureJob *BeginCaptureJob(CapturePipeline *pipeline, DWORD pid, const TCHAR *processName, const TCHAR *outputFolder, bool quitDetected);
+CaptureBlock *AcquireCaptureBlock(CapturePipeline *pipeline);
+void ReleaseCaptureBlock(CapturePipeline *pipeline, CaptureBlock *block);
+void SubmitCaptureBlock(CapturePipeline *pipeline, CaptureJob *job, CaptureBlock *block);
+void EndCaptureJob(CapturePipeline *pipeline, CaptureJob *job);
+void StopCapturePipeline(CapturePipeline *pipeline);
+
+#endif
@@ -0,0 +1,384 @@
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Chunk_Store.h"
+
+#define CHUNK_NORMAL_MASK_SMALL 0x0003590703530000ULL  // 15 bits: harder to cut before the average size
+#define CHUNK_NORMAL_MASK_LARGE 0x0000d90003530000ULL  // 11 bits: easier to cut after the average size
+#define CHUNK_INITIAL_SLOTS 65536
+
+static uint64_t gearTable[256];
+static bool gearTableReady = false;
+
+// Function to fill the gear table from a fixed seed so chunk boundaries are stable across hosts and runs
+static void InitGearTable(void) {
+    uint64_t seed = 0x57696e4462674344ULL;
+    for (int i = 0; i < 256; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        gearTable[i] = z ^ (z >> 31);
+    }
+    gearTableReady = true;
+}
+
+// Function to find the next FastCDC cut point; returns size when no boundary is found yet
+static size_t FindChunkBoundary(const uint8_t *data, size_t size) {
+    size_t normalSize = CHUNK_AVG_SIZE;
+    if (size <= CHUNK_MIN_SIZE) return size;
+    if (size > CHUNK_MAX_SIZE) size = CHUNK_MAX_SIZE;
+    if (size < normalSize) normalSize = size;
+
+    uint64_t fingerprint = 0;
+    size_t i = CHUNK_MIN_SIZE;
+    for (; i < normalSize; i++) {
+        fingerprint = (fingerprint << 1) + gearTable[data[i]];
+        if (!(fingerprint & CHUNK_NORMAL_MASK_SMALL)) return i + 1;
+    }
+    for (; i < size; i++) {
+        fingerprint = (fingerprint << 1) + gearTable[data[i]];
+        if (!(fingerprint & CHUNK_NORMAL_MASK_LARGE)) return i + 1;
+    }
+    return size;
+}
+
+static uint64_t SlotKey(const uint8_t *hash) {
+    uint64_t key;
+    memcpy(&key, hash, sizeof(key));
+    return key;
+}
+
+static const ChunkIndexEntry *FindChunk(const ChunkStore *store, const uint8_t *hash) {
+    size_t mask = store->slotCount - 1;
+    for (size_t slot = SlotKey(hash) & mask; store->slots[slot] != 0; slot = (slot + 1) & mask) {
+        const ChunkIndexEntry *entry = &store->entries[store->slots[slot] - 1];
+        if (memcmp(entry->hash, hash, SHA256_DIGEST_SIZE) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void InsertSlot(ChunkStore *store, uint32_t entryNumber) {
+    size_t mask = store->slotCount - 1;
+    size_t slot = SlotKey(store->entries[entryNumber - 1].hash) & mask;
+    while (store->slots[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    store->slots[slot] = entryNumber;
+}
+
+// Function to keep the hash table at most half full
+static bool GrowSlots(ChunkStore *store, size_t minimumEntries) {
+    size_t slotCount = store->slotCount ? store->slotCount : CHUNK_INITIAL_SLOTS;
+    while (slotCount < minimumEntries * 2) slotCount *= 2;
+    if (slotCount == store->slotCount) return true;
+
+    uint32_t *slots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+    if (!slots) return false;
+    free(store->slots);
+    store->slots = slots;
+    store->slotCount = slotCount;
+    for (size_t i = 0; i < store->entryCount; i++) {
+        InsertSlot(store, (uint32_t)(i + 1));
+    }
+    return true;
+}
+
+static bool AddIndexEntry(ChunkStore *store, const ChunkIndexEntry *entry) {
+    if (store->entryCount == store->entryCapacity) {
+        size_t capacity = store->entryCapacity ? store->entryCapacity * 2 : 4096;
+        ChunkIndexEntry *entries = (ChunkIndexEntry *)realloc(store->entries, capacity * sizeof(ChunkIndexEntry));
+        if (!entries) return false;
+        store->entries = entries;
+        store->entryCapacity = capacity;
+    }
+    store->entries[store->entryCount++] = *entry;
+    if (store->entryCount * 2 > store->slotCount && !GrowSlots(store, store->entryCount)) {
+        store->entryCount--;
+        return false;
+    }
+    InsertSlot(store, (uint32_t)store->entryCount);
+    return true;
+}
+
+static FILE *OpenOrCreateBinary(const TCHAR *fileName) {
+    FILE *file = _tfopen(fileName, _T("r+b"));
+    if (!file) {
+        file = _tfopen(fileName, _T("w+b"));
+    }
+    return file;
+}
+
+// Function to load the chunk index, dropping entries a crash left without pack data
+static bool LoadChunkIndex(ChunkStore *store, const TCHAR *indexFileName) {
+    _fseeki64(store->indexFile, 0, SEEK_END);
+    int64_t indexSize = _ftelli64(store->indexFile);
+    size_t recordCount = (size_t)(indexSize / (int64_t)sizeof(ChunkIndexEntry));
+    bool rewrite = (indexSize % (int64_t)sizeof(ChunkIndexEntry)) != 0;
+
+    _fseeki64(store->indexFile, 0, SEEK_SET);
+    ChunkIndexEntry entry;
+    for (size_t i = 0; i < recordCount; i++) {
+        if (fread(&entry, sizeof(entry), 1, store->indexFile) != 1) {
+            rewrite = true;
+            break;
+        }
+        if (entry.offset + entry.length > store->packSize || FindChunk(store, entry.hash)) {
+            rewrite = true;
+            continue;
+        }
+        if (!AddIndexEntry(store, &entry)) return false;
+    }
+
+    if (rewrite) {
+        fclose(store->indexFile);
+        store->indexFile = _tfopen(indexFileName, _T("w+b"));
+        if (!store->indexFile) return false;
+        fwrite(store->entries, sizeof(ChunkIndexEntry), store->entryCount, store->indexFile);
+        fflush(store->indexFile);
+    }
+    return true;
+}
+
+bool OpenChunkStore(ChunkStore *store, const TCHAR *storeFolder) {
+    memset(store, 0, sizeof(*store));
+    if (!gearTableReady) InitGearTable();
+
+    TCHAR packFileName[MAX_PATH];
+    TCHAR indexFileName[MAX_PATH];
+    _stprintf(packFileName, _T("%s\\%s"), storeFolder, CHUNK_PACK_FILE);
+    _stprintf(indexFileName, _T("%s\\%s"), storeFolder, CHUNK_INDEX_FILE);
+
+    store->packFile = OpenOrCreateBinary(packFileName);
+    store->indexFile = OpenOrCreateBinary(indexFileName);
+    if (!store->packFile || !store->indexFile || !GrowSlots(store, 0)) {
+        CloseChunkStore(store);
+        return false;
+    }
+
+    _fseeki64(store->packFile, 0, SEEK_END);
+    store->packSize = (uint64_t)_ftelli64(store->packFile);
+    if (!LoadChunkIndex(store, indexFileName)) {
+        CloseChunkStore(store);
+        return false;
+    }
+    return true;
+}
+
+void CloseChunkStore(ChunkStore *store) {
+    if (store->packFile) fclose(store->packFile);
+    if (store->indexFile) fclose(store->indexFile);
+    free(store->entries);
+    free(store->slots);
+    store->packFile = NULL;
+    store->indexFile = NULL;
+    store->entries = NULL;
+    store->slots = NULL;
+    store->entryCount = store->entryCapacity = store->slotCount = 0;
+}
+
+// Function to hash a chunk, append it to the pack if unseen, and reference it from the recipe.
+// A chunk the store cannot take is left out of the recipe and counted, so no line points at missing data.
+static void EmitChunk(ChunkRecipeWriter *writer, const uint8_t *data, size_t size) {
+    ChunkStore *store = writer->store;
+    uint8_t hash[SHA256_DIGEST_SIZE];
+    Sha256Buffer(data, size, hash);
+
+    if (!FindChunk(store, hash)) {
+        ChunkIndexEntry entry;
+        memcpy(entry.hash, hash, SHA256_DIGEST_SIZE);
+        entry.offset = store->packSize;
+        entry.length = (uint32_t)size;
+        entry.reserved = 0;
+
+        // Pack data goes down before the index record that points at it. Both are written at the end of
+        // what is known good, so a failed or partial write is overwritten by the next chunk.
+        bool stored = _fseeki64(store->packFile, (int64_t)store->packSize, SEEK_SET) == 0 &&
+                      fwrite(data, 1, size, store->packFile) == size &&
+                      _fseeki64(store->indexFile, (int64_t)(store->entryCount * sizeof(entry)), SEEK_SET) == 0 &&
+                      fwrite(&entry, sizeof(entry), 1, store->indexFile) == 1 &&
+                      AddIndexEntry(store, &entry);
+        if (!stored) {
+            if (writer->failedChunks == 0) {
+                _tprintf(_T("Failed to store a %u-byte chunk; the memory recipe will be marked failed\n"), (unsigned)size);
+            }
+            writer->failedChunks++;
+            return;
+        }
+        store->packSize += size;
+        writer->stats.storedBytes += size;
+        writer->stats.uniqueChunkCount++;
+    }
+
+    char hex[SHA256_HEX_SIZE];
+    DigestToHex(hash, SHA256_DIGEST_SIZE, hex);
+    fprintf(writer->recipeFile, "chunk %s %u\n", hex, (unsigned)size);
+    writer->stats.chunkCount++;
+}
+
+bool BeginChunkRecipe(ChunkRecipeWriter *writer, ChunkStore *store, const TCHAR *recipeFileName) {
+    memset(&writer->stats, 0, sizeof(writer->stats));
+    writer->store = store;
+    writer->pendingSize = 0;
+    writer->regionOpen = false;
+    writer->failedChunks = 0;
+    writer->recipeFile = _tfopen(recipeFileName, _T("w"));
+    if (!writer->recipeFile) return false;
+    fprintf(writer->recipeFile, "%s\n", CHUNK_RECIPE_HEADER);
+    return true;
+}
+
+void BeginChunkRegion(ChunkRecipeWriter *writer, uint64_t baseAddress, uint64_t regionSize, uint32_t protect, uint32_t type) {
+    if (writer->regionOpen) EndChunkRegion(writer);
+    fprintf(writer->recipeFile, "region %016llx %016llx %08x %08x\n",
+            (unsigned long long)baseAddress, (unsigned long long)regionSize, protect, type);
+    writer->regionOpen = true;
+}
+
+// Function to stream region bytes through the chunker; data may arrive in any split
+void AppendChunkData(ChunkRecipeWriter *writer, const void *data, size_t size) {
+    clock_t startTime = clock();
+    const uint8_t *bytes = (const uint8_t *)data;
+    writer->stats.logicalBytes += size;
+
+    while (size > 0) {
+        if (writer->pendingSize == 0) {
+            // Cut straight from the caller's buffer while whole chunks are available
+            size_t cut = FindChunkBoundary(bytes, size);
+            if (cut < size || cut == CHUNK_MAX_SIZE) {
+                EmitChunk(writer, bytes, cut);
+                bytes += cut;
+                size -= cut;
+                continue;
+            }
+        }
+
+        size_t take = CHUNK_MAX_SIZE - writer->pendingSize;
+        if (take > size) take = size;
+        memcpy(writer->pending + writer->pendingSize, bytes, take);
+        writer->pendingSize += take;
+        bytes += take;
+        size -= take;
+
+        size_t cut = FindChunkBoundary(writer->pending, writer->pendingSize);
+        if (cut < writer->pendingSize || cut == CHUNK_MAX_SIZE) {
+            EmitChunk(writer, writer->pending, cut);
+            writer->pendingSize -= cut;
+            memmove(writer->pending, writer->pending + cut, writer->pendingSize);
+        }
+    }
+
+    writer->stats.ingestSeconds += (double)(clock() - startTime) / CLOCKS_PER_SEC;
+}
+
+void EndChunkRegion(ChunkRecipeWriter *writer) {
+    clock_t startTime = clock();
+    // Drain the tail; the remainder may still hold several boundaries
+    size_t offset = 0;
+    while (offset < writer->pendingSize) {
+        size_t cut = FindChunkBoundary(writer->pending + offset, writer->pendingSize - offset);
+        EmitChunk(writer, writer->pending + offset, cut);
+        offset += cut;
+    }
+    writer->pendingSize = 0;
+    writer->regionOpen = false;
+    writer->stats.ingestSeconds += (double)(clock() - startTime) / CLOCKS_PER_SEC;
+}
+
+// Function to close a recipe; false when any chunk could not be stored or the recipe could not be written
+bool EndChunkRecipe(ChunkRecipeWriter *writer) {
+    bool ok = true;
+    if (writer->regionOpen) EndChunkRegion(writer);
+    if (writer->recipeFile) {
+        if (writer->failedChunks > 0) {
+            fprintf(writer->recipeFile, "failed %llu %llu\n",
+                    (unsigned long long)writer->stats.logicalBytes, (unsigned long long)writer->failedChunks);
+        } else {
+            fprintf(writer->recipeFile, "end %llu %llu\n",
+                    (unsigned long long)writer->stats.logicalBytes, (unsigned long long)writer->stats.chunkCount);
+        }
+        ok = !ferror(writer->recipeFile);
+        ok = fclose(writer->recipeFile) == 0 && ok;
+        writer->recipeFile = NULL;
+    }
+    fflush(writer->store->packFile);
+    fflush(writer->store->indexFile);
+
+    ChunkStoreStats *total = &writer->store->stats;
+    total->logicalBytes += writer->stats.logicalBytes;
+    total->storedBytes += writer->stats.storedBytes;
+    total->chunkCount += writer->stats.chunkCount;
+    total->uniqueChunkCount += writer->stats.uniqueChunkCount;
+    total->ingestSeconds += writer->stats.ingestSeconds;
+    return ok && writer->failedChunks == 0;
+}
+
+// Function to rebuild the exact memory dump a recipe describes, verifying every chunk hash
+bool ReconstructFromRecipe(ChunkStore *store, const TCHAR *recipeFileName, const TCHAR *outputFileName) {
+    FILE *recipeFile = _tfopen(recipeFileName, _T("r"));
+    if (!recipeFile) return false;
+    FILE *outputFile = _tfopen(outputFileName, _T("wb"));
+    if (!outputFile) {
+        fclose(recipeFile);
+        return false;
+    }
+
+    uint8_t *buffer = (uint8_t *)malloc(CHUNK_MAX_SIZE);
+    char line[256];
+    uint64_t writtenBytes = 0;
+    bool ok = buffer != NULL && fgets(line, sizeof(line), recipeFile) &&
+              strncmp(line, CHUNK_RECIPE_HEADER, strlen(CHUNK_RECIPE_HEADER)) == 0;
+    bool sawEnd = false;
+
+    while (ok && fgets(line, sizeof(line), recipeFile)) {
+        char hex[SHA256_HEX_SIZE];
+        unsigned length;
+        unsigned long long expectedBytes, expectedChunks;
+        if (sscanf(line, "chunk %64s %u", hex, &length) == 2) {
+            uint8_t hash[SHA256_DIGEST_SIZE];
+            uint8_t check[SHA256_DIGEST_SIZE];
+            const ChunkIndexEntry *entry = HexToDigest(hex, hash, SHA256_DIGEST_SIZE) ? FindChunk(store, hash) : NULL;
+            if (!entry || entry->length != length) {
+                _tprintf(_T("Chunk %hs missing from store\n"), hex);
+                ok = false;
+                break;
+            }
+            _fseeki64(store->packFile, (int64_t)entry->offset, SEEK_SET);
+            if (fread(buffer, 1, length, store->packFile) != length) {
+                ok = false;
+                break;
+            }
+            Sha256Buffer(buffer, length, check);
+            if (memcmp(check, hash, SHA256_DIGEST_SIZE) != 0) {
+                _tprintf(_T("Chunk %hs failed verification\n"), hex);
+                ok = false;
+                break;
+            }
+            fwrite(buffer, 1, length, outputFile);
+            writtenBytes += length;
+        } else if (sscanf(line, "end %llu %llu", &expectedBytes, &expectedChunks) == 2) {
+            ok = (expectedBytes == writtenBytes);
+            sawEnd = true;
+        } else if (sscanf(line, "failed %llu %llu", &expectedBytes, &expectedChunks) == 2) {
+            _tprintf(_T("Recipe is incomplete: %llu chunks could not be stored when it was captured\n"), expectedChunks);
+            ok = false;
+        }
+    }
+
+    free(buffer);
+    fclose(outputFile);
+    fclose(recipeFile);
+    return ok && sawEnd;
+}
+
+void PrintChunkStoreStats(const TCHAR *label, const ChunkStoreStats *stats) {
+    double logicalMB = (double)stats->logicalBytes / (1024.0 * 1024.0);
+    double storedMB = (double)stats->storedBytes / (1024.0 * 1024.0);
+    double ratio = stats->storedBytes ? (double)stats->logicalBytes / (double)stats->storedBytes : 0.0;
+    double throughput = stats->ingestSeconds > 0 ? logicalMB / stats->ingestSeconds : 0.0;
+    _tprintf(_T("%s: %.1f MB logical, %.1f MB stored, %llu/%llu new chunks, dedup ratio %.2fx, ingest %.1f MB/s\n"),
+             label, logicalMB, storedMB, (unsigned long long)stats->uniqueChunkCount,
+             (unsigned long long)stats->chunkCount, ratio, throughput);
+}
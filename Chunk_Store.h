@@ -0,0 +1,73 @@
+#ifndef CHUNK_STORE_H
+#define CHUNK_STORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+#include "Content_Hash.h"
+
+// FastCDC parameters: chunks are cut at content-defined boundaries so identical
+// images (ntdll, kernel32, ...) produce identical chunks in every process
+#define CHUNK_MIN_SIZE 2048
+#define CHUNK_AVG_SIZE 8192
+#define CHUNK_MAX_SIZE 65536
+
+#define CHUNK_STORE_FOLDER _T("chunk_store")
+#define CHUNK_PACK_FILE _T("chunks.pack")
+#define CHUNK_INDEX_FILE _T("chunks.idx")
+#define CHUNK_RECIPE_HEADER "CHUNK_RECIPE 1"
+
+// On-disk index record, appended to chunks.idx for every new chunk in chunks.pack
+typedef struct {
+    uint8_t hash[SHA256_DIGEST_SIZE];
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+} ChunkIndexEntry;
+
+typedef struct {
+    uint64_t logicalBytes;      // Bytes presented to the store
+    uint64_t storedBytes;       // Bytes actually appended to the pack
+    uint64_t chunkCount;        // Chunks referenced by recipes
+    uint64_t uniqueChunkCount;  // Chunks appended to the pack
+    double ingestSeconds;       // Time spent chunking, hashing and storing
+} ChunkStoreStats;
+
+// Shared, content-addressed chunk pool for one sweep
+typedef struct {
+    FILE *packFile;
+    FILE *indexFile;
+    uint64_t packSize;
+    ChunkIndexEntry *entries;
+    size_t entryCount;
+    size_t entryCapacity;
+    uint32_t *slots;            // Open-addressing table of entry index + 1 (0 = empty)
+    size_t slotCount;
+    ChunkStoreStats stats;
+} ChunkStore;
+
+// Per-process recipe: the ordered list of chunks that rebuilds one memory dump
+typedef struct {
+    ChunkStore *store;
+    FILE *recipeFile;
+    uint8_t pending[CHUNK_MAX_SIZE];
+    size_t pendingSize;
+    bool regionOpen;
+    uint64_t failedChunks;      // Chunks the store could not take; the recipe ends with "failed" instead of "end"
+    ChunkStoreStats stats;
+} ChunkRecipeWriter;
+
+bool OpenChunkStore(ChunkStore *store, const TCHAR *storeFolder);
+void CloseChunkStore(ChunkStore *store);
+
+bool BeginChunkRecipe(ChunkRecipeWriter *writer, ChunkStore *store, const TCHAR *recipeFileName);
+void BeginChunkRegion(ChunkRecipeWriter *writer, uint64_t baseAddress, uint64_t regionSize, uint32_t protect, uint32_t type);
+void AppendChunkData(ChunkRecipeWriter *writer, const void *data, size_t size);
+void EndChunkRegion(ChunkRecipeWriter *writer);
+bool EndChunkRecipe(ChunkRecipeWriter *writer);
+
+bool ReconstructFromRecipe(ChunkStore *store, const TCHAR *recipeFileName, const TCHAR *outputFileName);
+void PrintChunkStoreStats(const TCHAR *label, const ChunkStoreStats *stats);
+
+#endif
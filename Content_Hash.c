@@ -0,0 +1,327 @@
+#include <string.h>
+#include "Content_Hash.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_USE_SSE2 1
+#endif
+
+static const uint32_t sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// Function to compress one 64-byte block into the hash state
+static void Sha256Transform(uint32_t state[8], const uint8_t *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t S1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + S1 + ch + sha256K[i] + w[i];
+        uint32_t S0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = S0 + maj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void Sha256Init(Sha256Context *ctx) {
+    static const uint32_t initialState[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, initialState, sizeof(initialState));
+    ctx->totalLength = 0;
+    ctx->blockUsed = 0;
+}
+
+void Sha256Update(Sha256Context *ctx, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    ctx->totalLength += size;
+
+    // Top up a partially filled block first
+    if (ctx->blockUsed > 0) {
+        size_t take = SHA256_BLOCK_SIZE - ctx->blockUsed;
+        if (take > size) take = size;
+        memcpy(ctx->block + ctx->blockUsed, bytes, take);
+        ctx->blockUsed += take;
+        bytes += take;
+        size -= take;
+        if (ctx->blockUsed < SHA256_BLOCK_SIZE) return;
+        Sha256Transform(ctx->state, ctx->block);
+        ctx->blockUsed = 0;
+    }
+
+    // Hash whole blocks straight from the caller's buffer
+    while (size >= SHA256_BLOCK_SIZE) {
+        Sha256Transform(ctx->state, bytes);
+        bytes += SHA256_BLOCK_SIZE;
+        size -= SHA256_BLOCK_SIZE;
+    }
+
+    if (size > 0) {
+        memcpy(ctx->block, bytes, size);
+        ctx->blockUsed = size;
+    }
+}
+
+void Sha256Final(Sha256Context *ctx, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    uint64_t bitLength = ctx->totalLength * 8;
+
+    ctx->block[ctx->blockUsed++] = 0x80;
+    if (ctx->blockUsed > SHA256_BLOCK_SIZE - 8) {
+        memset(ctx->block + ctx->blockUsed, 0, SHA256_BLOCK_SIZE - ctx->blockUsed);
+        Sha256Transform(ctx->state, ctx->block);
+        ctx->blockUsed = 0;
+    }
+    memset(ctx->block + ctx->blockUsed, 0, SHA256_BLOCK_SIZE - 8 - ctx->blockUsed);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bitLength >> (i * 8));
+    }
+    Sha256Transform(ctx->state, ctx->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)ctx->state[i];
+    }
+}
+
+void Sha256Buffer(const void *data, size_t size, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    Sha256Context ctx;
+    Sha256Init(&ctx);
+    Sha256Update(&ctx, data, size);
+    Sha256Final(&ctx, digest);
+}
+
+static uint32_t LoadBigEndian32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+#ifdef HASH_USE_SSE2
+#define ROTR32X4(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+
+// Function to compress one block of each of four messages; every 32-bit lane is one message
+static void Sha256TransformX4(uint32_t *states[SHA256_LANES], const uint8_t *blocks[SHA256_LANES]) {
+    __m128i w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = _mm_set_epi32((int)LoadBigEndian32(blocks[3] + i * 4), (int)LoadBigEndian32(blocks[2] + i * 4),
+                             (int)LoadBigEndian32(blocks[1] + i * 4), (int)LoadBigEndian32(blocks[0] + i * 4));
+    }
+    for (int i = 16; i < 64; i++) {
+        __m128i s0 = _mm_xor_si128(_mm_xor_si128(ROTR32X4(w[i - 15], 7), ROTR32X4(w[i - 15], 18)), _mm_srli_epi32(w[i - 15], 3));
+        __m128i s1 = _mm_xor_si128(_mm_xor_si128(ROTR32X4(w[i - 2], 17), ROTR32X4(w[i - 2], 19)), _mm_srli_epi32(w[i - 2], 10));
+        w[i] = _mm_add_epi32(_mm_add_epi32(w[i - 16], s0), _mm_add_epi32(w[i - 7], s1));
+    }
+
+    __m128i v[8];
+    for (int j = 0; j < 8; j++) {
+        v[j] = _mm_set_epi32((int)states[3][j], (int)states[2][j], (int)states[1][j], (int)states[0][j]);
+    }
+    __m128i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+    for (int i = 0; i < 64; i++) {
+        __m128i S1 = _mm_xor_si128(_mm_xor_si128(ROTR32X4(e, 6), ROTR32X4(e, 11)), ROTR32X4(e, 25));
+        __m128i ch = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+        __m128i t1 = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(h, S1), _mm_add_epi32(ch, _mm_set1_epi32((int)sha256K[i]))), w[i]);
+        __m128i S0 = _mm_xor_si128(_mm_xor_si128(ROTR32X4(a, 2), ROTR32X4(a, 13)), ROTR32X4(a, 22));
+        __m128i maj = _mm_xor_si128(_mm_xor_si128(_mm_and_si128(a, b), _mm_and_si128(a, c)), _mm_and_si128(b, c));
+        __m128i t2 = _mm_add_epi32(S0, maj);
+        h = g; g = f; f = e; e = _mm_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm_add_epi32(t1, t2);
+    }
+    v[0] = _mm_add_epi32(v[0], a); v[1] = _mm_add_epi32(v[1], b); v[2] = _mm_add_epi32(v[2], c); v[3] = _mm_add_epi32(v[3], d);
+    v[4] = _mm_add_epi32(v[4], e); v[5] = _mm_add_epi32(v[5], f); v[6] = _mm_add_epi32(v[6], g); v[7] = _mm_add_epi32(v[7], h);
+
+    for (int j = 0; j < 8; j++) {
+        uint32_t lanes[SHA256_LANES];
+        _mm_storeu_si128((__m128i *)lanes, v[j]);
+        for (int lane = 0; lane < SHA256_LANES; lane++) states[lane][j] = lanes[lane];
+    }
+}
+#endif
+
+void Sha256UpdateLanes(Sha256Context *ctx[SHA256_LANES], const uint8_t *data[SHA256_LANES], size_t size) {
+    size_t done = 0;
+#ifdef HASH_USE_SSE2
+    // Lockstep only works while all four lanes are live and block-aligned
+    bool lockstep = true;
+    for (int lane = 0; lane < SHA256_LANES; lane++) {
+        if (!ctx[lane] || ctx[lane]->blockUsed != 0) lockstep = false;
+    }
+    if (lockstep) {
+        uint32_t *states[SHA256_LANES];
+        const uint8_t *blocks[SHA256_LANES];
+        for (int lane = 0; lane < SHA256_LANES; lane++) states[lane] = ctx[lane]->state;
+        for (; done + SHA256_BLOCK_SIZE <= size; done += SHA256_BLOCK_SIZE) {
+            for (int lane = 0; lane < SHA256_LANES; lane++) blocks[lane] = data[lane] + done;
+            Sha256TransformX4(states, blocks);
+        }
+        for (int lane = 0; lane < SHA256_LANES; lane++) ctx[lane]->totalLength += done;
+    }
+#endif
+    for (int lane = 0; lane < SHA256_LANES; lane++) {
+        if (ctx[lane]) Sha256Update(ctx[lane], data[lane] + done, size - done);
+    }
+}
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define ROTL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+static uint64_t LoadLittleEndian64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+static uint32_t LoadLittleEndian32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t Xxh64Round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * XXH_PRIME64_2;
+    accumulator = ROTL64(accumulator, 31);
+    return accumulator * XXH_PRIME64_1;
+}
+
+static uint64_t Xxh64MergeRound(uint64_t hash, uint64_t accumulator) {
+    hash ^= Xxh64Round(0, accumulator);
+    return hash * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+void Xxh64Init(Xxh64Context *ctx, uint64_t seed) {
+    ctx->seed = seed;
+    ctx->accumulators[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+    ctx->accumulators[1] = seed + XXH_PRIME64_2;
+    ctx->accumulators[2] = seed;
+    ctx->accumulators[3] = seed - XXH_PRIME64_1;
+    ctx->totalLength = 0;
+    ctx->stripeUsed = 0;
+}
+
+// Function to fold whole 32-byte stripes into the four accumulators
+static void Xxh64Stripes(uint64_t accumulators[4], const uint8_t *bytes, size_t stripes) {
+    uint64_t v1 = accumulators[0], v2 = accumulators[1], v3 = accumulators[2], v4 = accumulators[3];
+    for (size_t i = 0; i < stripes; i++, bytes += 32) {
+        v1 = Xxh64Round(v1, LoadLittleEndian64(bytes));
+        v2 = Xxh64Round(v2, LoadLittleEndian64(bytes + 8));
+        v3 = Xxh64Round(v3, LoadLittleEndian64(bytes + 16));
+        v4 = Xxh64Round(v4, LoadLittleEndian64(bytes + 24));
+    }
+    accumulators[0] = v1; accumulators[1] = v2; accumulators[2] = v3; accumulators[3] = v4;
+}
+
+void Xxh64Update(Xxh64Context *ctx, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    ctx->totalLength += size;
+
+    if (ctx->stripeUsed > 0) {
+        size_t take = sizeof(ctx->stripe) - ctx->stripeUsed;
+        if (take > size) take = size;
+        memcpy(ctx->stripe + ctx->stripeUsed, bytes, take);
+        ctx->stripeUsed += take;
+        bytes += take;
+        size -= take;
+        if (ctx->stripeUsed < sizeof(ctx->stripe)) return;
+        Xxh64Stripes(ctx->accumulators, ctx->stripe, 1);
+        ctx->stripeUsed = 0;
+    }
+
+    Xxh64Stripes(ctx->accumulators, bytes, size / 32);
+    bytes += size & ~(size_t)31;
+    size &= 31;
+    memcpy(ctx->stripe, bytes, size);
+    ctx->stripeUsed = size;
+}
+
+uint64_t Xxh64Final(const Xxh64Context *ctx) {
+    const uint64_t *v = ctx->accumulators;
+    uint64_t hash;
+    if (ctx->totalLength >= 32) {
+        hash = ROTL64(v[0], 1) + ROTL64(v[1], 7) + ROTL64(v[2], 12) + ROTL64(v[3], 18);
+        for (int i = 0; i < 4; i++) hash = Xxh64MergeRound(hash, v[i]);
+    } else {
+        hash = ctx->seed + XXH_PRIME64_5;
+    }
+    hash += ctx->totalLength;
+
+    // Fold the tail that did not fill a stripe
+    const uint8_t *p = ctx->stripe;
+    size_t left = ctx->stripeUsed;
+    for (; left >= 8; left -= 8, p += 8) {
+        hash ^= Xxh64Round(0, LoadLittleEndian64(p));
+        hash = ROTL64(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (left >= 4) {
+        hash ^= (uint64_t)LoadLittleEndian32(p) * XXH_PRIME64_1;
+        hash = ROTL64(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        left -= 4;
+        p += 4;
+    }
+    for (; left > 0; left--, p++) {
+        hash ^= (uint64_t)*p * XXH_PRIME64_5;
+        hash = ROTL64(hash, 11) * XXH_PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Function to format a digest as lowercase hex (hex must hold digestSize * 2 + 1 chars)
+void DigestToHex(const uint8_t *digest, size_t digestSize, char *hex) {
+    static const char hexDigits[] = "0123456789abcdef";
+    for (size_t i = 0; i < digestSize; i++) {
+        hex[i * 2] = hexDigits[digest[i] >> 4];
+        hex[i * 2 + 1] = hexDigits[digest[i] & 0x0f];
+    }
+    hex[digestSize * 2] = '\0';
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Function to parse a hex digest back to bytes
+bool HexToDigest(const char *hex, uint8_t *digest, size_t digestSize) {
+    for (size_t i = 0; i < digestSize; i++) {
+        int high = HexValue(hex[i * 2]);
+        int low = (high < 0) ? -1 : HexValue(hex[i * 2 + 1]);
+        if (low < 0) return false;
+        digest[i] = (uint8_t)((high << 4) | low);
+    }
+    return true;
+}
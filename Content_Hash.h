@@ -0,0 +1,47 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_HEX_SIZE (SHA256_DIGEST_SIZE * 2 + 1)
+#define SHA256_LANES 4              // Independent messages hashed together by Sha256UpdateLanes
+#define XXH64_HEX_SIZE 17
+
+// Streaming SHA-256 state
+typedef struct {
+    uint32_t state[8];
+    uint64_t totalLength;
+    uint8_t block[SHA256_BLOCK_SIZE];
+    size_t blockUsed;
+} Sha256Context;
+
+void Sha256Init(Sha256Context *ctx);
+void Sha256Update(Sha256Context *ctx, const void *data, size_t size);
+void Sha256Final(Sha256Context *ctx, uint8_t digest[SHA256_DIGEST_SIZE]);
+void Sha256Buffer(const void *data, size_t size, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// Multi-buffer update: adds size bytes of data[i] to ctx[i] for every lane. Whole blocks of all
+// four lanes go through one SSE2 transform; lanes may be NULL when fewer messages are left.
+void Sha256UpdateLanes(Sha256Context *ctx[SHA256_LANES], const uint8_t *data[SHA256_LANES], size_t size);
+
+// Streaming XXH64, a fast non-cryptographic hash; matches the reference xxHash output
+typedef struct {
+    uint64_t accumulators[4];
+    uint64_t seed;
+    uint64_t totalLength;
+    uint8_t stripe[32];
+    size_t stripeUsed;
+} Xxh64Context;
+
+void Xxh64Init(Xxh64Context *ctx, uint64_t seed);
+void Xxh64Update(Xxh64Context *ctx, const void *data, size_t size);
+uint64_t Xxh64Final(const Xxh64Context *ctx);
+
+void DigestToHex(const uint8_t *digest, size_t digestSize, char *hex);
+bool HexToDigest(const char *hex, uint8_t *digest, size_t digestSize);
+
+#endif
@@ -0,0 +1,30 @@
+#include <windows.h>
+#include <stdio.h>
+#include <tchar.h>
+#include <stdbool.h>
+#include "Chunk_Store.h"
+
+// Rebuilds a process memory dump from its chunk recipe:
+//   Dump_Restore.exe <chunk_store folder> <windbg_output_memory.recipe> <output file>
+int _tmain(int argc, TCHAR *argv[]) {
+    if (argc != 4) {
+        _tprintf(_T("Usage: %s <chunk_store folder> <recipe file> <output file>\n"), argv[0]);
+        return 1;
+    }
+
+    ChunkStore store;
+    if (!OpenChunkStore(&store, argv[1])) {
+        _tprintf(_T("Failed to open chunk store at %s\n"), argv[1]);
+        return 1;
+    }
+
+    bool ok = ReconstructFromRecipe(&store, argv[2], argv[3]);
+    if (ok) {
+        _tprintf(_T("Reconstructed %s from %s\n"), argv[3], argv[2]);
+    } else {
+        _tprintf(_T("Failed to reconstruct %s from %s\n"), argv[3], argv[2]);
+    }
+
+    CloseChunkStore(&store);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,667 @@
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <float.h>
+#include <math.h>
+#include "Fleet_Sketch.h"
+
+#define FLEET_SKETCH_MAGIC "FLSK"
+#define FLEET_SKETCH_VERSION 1
+#define SKETCH_SECTION_HLL 1
+#define SKETCH_SECTION_CMS 2
+#define SKETCH_SECTION_DIGEST 3
+#define SKETCH_LINE_SIZE 4096
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const char *hllNames[FLEET_HLL_COUNT] = { "distinct_modules", "distinct_processes" };
+static const char *cmsNames[FLEET_CMS_COUNT] = { "strings", "modules", "processes" };
+static const char *digestNames[FLEET_DIGEST_COUNT] = {
+    "memory_bytes", "entropy_mean", "exec_bytes", "module_count", "string_count"
+};
+
+// Function to hash a key with 64-bit FNV-1a and a murmur finaliser; the value is part of the file format
+uint64_t SketchHash(const void *data, size_t length) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void HyperLogLogAdd(HyperLogLog *hll, const void *data, size_t length) {
+    uint64_t h = SketchHash(data, length);
+    uint32_t index = (uint32_t)(h >> (64 - SKETCH_HLL_PRECISION));
+    uint64_t rest = h << SKETCH_HLL_PRECISION;
+    uint8_t rank = 1;
+    while (rank <= 64 - SKETCH_HLL_PRECISION && !(rest & 0x8000000000000000ULL)) {
+        rank++;
+        rest <<= 1;
+    }
+    if (rank > hll->registers[index]) hll->registers[index] = rank;
+}
+
+// Function to estimate the distinct count, with linear counting for small cardinalities
+double HyperLogLogEstimate(const HyperLogLog *hll) {
+    const double m = SKETCH_HLL_REGISTERS;
+    double sum = 0.0;
+    uint32_t zeros = 0;
+    for (uint32_t i = 0; i < SKETCH_HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -hll->registers[i]);
+        if (hll->registers[i] == 0) zeros++;
+    }
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros);
+    }
+    return estimate;
+}
+
+static uint32_t CountMinColumn(uint64_t hash, int row) {
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    return (h1 + (uint32_t)row * h2) % SKETCH_CMS_WIDTH;
+}
+
+static uint64_t CountMinEstimateHash(const CountMinTopK *cms, uint64_t hash) {
+    uint64_t estimate = UINT64_MAX;
+    for (int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        uint32_t value = cms->counters[row][CountMinColumn(hash, row)];
+        if (value < estimate) estimate = value;
+    }
+    return estimate;
+}
+
+uint64_t CountMinEstimate(const CountMinTopK *cms, const char *key, size_t length) {
+    return CountMinEstimateHash(cms, SketchHash(key, length));
+}
+
+// Function to offer a key to the top-K table at its current estimate
+static void OfferTopK(CountMinTopK *cms, uint64_t hash, const char *key, size_t length, uint64_t estimate) {
+    uint32_t smallest = 0;
+    for (uint32_t i = 0; i < cms->topCount; i++) {
+        if (cms->top[i].hash == hash) {
+            cms->top[i].estimate = estimate;
+            return;
+        }
+        if (cms->top[i].estimate < cms->top[smallest].estimate) smallest = i;
+    }
+
+    TopKEntry *entry;
+    if (cms->topCount < SKETCH_TOPK) {
+        entry = &cms->top[cms->topCount++];
+    } else if (estimate > cms->top[smallest].estimate) {
+        entry = &cms->top[smallest];
+    } else {
+        return;
+    }
+    if (length >= SKETCH_TOPK_KEY_SIZE) length = SKETCH_TOPK_KEY_SIZE - 1;
+    entry->hash = hash;
+    entry->estimate = estimate;
+    memcpy(entry->key, key, length);
+    entry->key[length] = '\0';
+}
+
+void CountMinAdd(CountMinTopK *cms, const char *key, size_t length, uint32_t count) {
+    uint64_t hash = SketchHash(key, length);
+    for (int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        uint32_t *counter = &cms->counters[row][CountMinColumn(hash, row)];
+        *counter = (*counter > UINT32_MAX - count) ? UINT32_MAX : *counter + count;
+    }
+    cms->total += count;
+    OfferTopK(cms, hash, key, length, CountMinEstimateHash(cms, hash));
+}
+
+static int CompareCentroids(const void *a, const void *b) {
+    double ma = ((const Centroid *)a)->mean;
+    double mb = ((const Centroid *)b)->mean;
+    return (ma > mb) - (ma < mb);
+}
+
+// Scale function k1: centroids may span one unit of k, which keeps them small near q = 0 and q = 1
+static double DigestScale(double q) {
+    return SKETCH_DIGEST_COMPRESSION / (2.0 * M_PI) * asin(2.0 * q - 1.0);
+}
+
+static double DigestScaleInverse(double k) {
+    double q = (sin(k * 2.0 * M_PI / SKETCH_DIGEST_COMPRESSION) + 1.0) / 2.0;
+    return q > 1.0 ? 1.0 : q;
+}
+
+// Function to fold buffered points into the centroid list (merging t-digest)
+void DigestCompress(TDigest *digest) {
+    if (digest->bufferCount == 0) return;
+    Centroid all[SKETCH_DIGEST_CENTROIDS + SKETCH_DIGEST_BUFFER];
+    uint32_t n = digest->centroidCount;
+    memcpy(all, digest->centroids, n * sizeof(Centroid));
+    memcpy(all + n, digest->buffer, digest->bufferCount * sizeof(Centroid));
+    n += digest->bufferCount;
+    digest->bufferCount = 0;
+    qsort(all, n, sizeof(Centroid), CompareCentroids);
+
+    double total = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        total += all[i].weight;
+    }
+
+    uint32_t out = 0;
+    Centroid current = all[0];
+    double weightSoFar = 0.0;
+    double limit = DigestScaleInverse(DigestScale(0.0) + 1.0) * total;
+    for (uint32_t i = 1; i < n; i++) {
+        if (weightSoFar + current.weight + all[i].weight <= limit || out == SKETCH_DIGEST_CENTROIDS - 1) {
+            double weight = current.weight + all[i].weight;
+            current.mean += (all[i].mean - current.mean) * all[i].weight / weight;
+            current.weight = weight;
+        } else {
+            weightSoFar += current.weight;
+            digest->centroids[out++] = current;
+            limit = DigestScaleInverse(DigestScale(weightSoFar / total) + 1.0) * total;
+            current = all[i];
+        }
+    }
+    digest->centroids[out++] = current;
+    digest->centroidCount = out;
+}
+
+void DigestAdd(TDigest *digest, double value, double weight) {
+    if (weight <= 0.0 || value != value) return;
+    if (digest->bufferCount == SKETCH_DIGEST_BUFFER) DigestCompress(digest);
+    digest->buffer[digest->bufferCount].mean = value;
+    digest->buffer[digest->bufferCount].weight = weight;
+    digest->bufferCount++;
+    digest->count += weight;
+    if (value < digest->min) digest->min = value;
+    if (value > digest->max) digest->max = value;
+}
+
+// Function to interpolate a quantile between centroid centres, pinned to the exact min and max
+double DigestQuantile(TDigest *digest, double q) {
+    DigestCompress(digest);
+    uint32_t n = digest->centroidCount;
+    if (n == 0) return 0.0;
+    if (n == 1 || q <= 0.0) return q <= 0.0 ? digest->min : digest->centroids[0].mean;
+    if (q >= 1.0) return digest->max;
+
+    const Centroid *c = digest->centroids;
+    double target = q * digest->count;
+    double cumulative = c[0].weight / 2.0;
+    if (target < cumulative) {
+        return digest->min + (c[0].mean - digest->min) * target / cumulative;
+    }
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        double next = cumulative + (c[i].weight + c[i + 1].weight) / 2.0;
+        if (target <= next) {
+            double fraction = next > cumulative ? (target - cumulative) / (next - cumulative) : 0.0;
+            return c[i].mean + (c[i + 1].mean - c[i].mean) * fraction;
+        }
+        cumulative = next;
+    }
+    double remaining = digest->count - cumulative;
+    double fraction = remaining > 0.0 ? (target - cumulative) / remaining : 1.0;
+    return c[n - 1].mean + (digest->max - c[n - 1].mean) * fraction;
+}
+
+static void ResetDigest(TDigest *digest) {
+    digest->count = 0.0;
+    digest->min = DBL_MAX;
+    digest->max = -DBL_MAX;
+    digest->centroidCount = 0;
+    digest->bufferCount = 0;
+}
+
+FleetSketch *CreateFleetSketch(void) {
+    FleetSketch *sketch = (FleetSketch *)calloc(1, sizeof(FleetSketch));
+    if (!sketch) return NULL;
+    for (int i = 0; i < FLEET_HLL_COUNT; i++) {
+        snprintf(sketch->distinct[i].name, SKETCH_NAME_SIZE, "%s", hllNames[i]);
+    }
+    for (int i = 0; i < FLEET_CMS_COUNT; i++) {
+        snprintf(sketch->frequencies[i].name, SKETCH_NAME_SIZE, "%s", cmsNames[i]);
+    }
+    for (int i = 0; i < FLEET_DIGEST_COUNT; i++) {
+        snprintf(sketch->metrics[i].name, SKETCH_NAME_SIZE, "%s", digestNames[i]);
+        ResetDigest(&sketch->metrics[i]);
+    }
+    sketch->sources = 1;
+    return sketch;
+}
+
+static size_t TrimLine(char *line) {
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+        line[--length] = '\0';
+    }
+    return length;
+}
+
+// Function to read one value from a "name value" features file
+static bool ReadFeatureValue(const TCHAR *fileName, const char *name, double *value) {
+    FILE *file = _tfopen(fileName, _T("r"));
+    if (!file) return false;
+    char line[256], key[128];
+    double parsed;
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%127s %lf", key, &parsed) == 2 && strcmp(key, name) == 0) {
+            *value = parsed;
+            found = true;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+// Function to fold one captured process folder (modules, strings, features) into the sketch
+void AddProcessToFleetSketch(FleetSketch *sketch, const TCHAR *processFolder, const TCHAR *processName) {
+    TCHAR fileName[MAX_PATH];
+    char line[SKETCH_LINE_SIZE];
+    char name[MAX_PATH * 3];
+    double value;
+
+    // Process image, case-folded so "Notepad.exe" and "notepad.exe" agree across hosts
+#ifdef UNICODE
+    WideCharToMultiByte(CP_UTF8, 0, processName, -1, name, sizeof(name), NULL, NULL);
+#else
+    snprintf(name, sizeof(name), "%s", processName);
+#endif
+    for (char *p = name; *p; p++) *p = (char)tolower((unsigned char)*p);
+    HyperLogLogAdd(&sketch->distinct[FLEET_HLL_PROCESSES], name, strlen(name));
+    CountMinAdd(&sketch->frequencies[FLEET_CMS_PROCESSES], name, strlen(name), 1);
+    sketch->processes++;
+
+    // Modules by file name: one count per process that loads them
+    uint64_t moduleCount = 0;
+    _stprintf(fileName, _T("%s\\windbg_output_modules.txt"), processFolder);
+    FILE *modules = _tfopen(fileName, _T("rb"));
+    if (modules) {
+        while (fgets(line, sizeof(line), modules)) {
+            // Module records are "path<TAB>sha256<TAB>xxh64<TAB>size"; older listings hold the path alone
+            char *hashes = strchr(line, '\t');
+            if (hashes) *hashes = '\0';
+            size_t length = TrimLine(line);
+            if (length == 0) continue;
+            char *base = line + length;
+            while (base > line && base[-1] != '\\' && base[-1] != '/') base--;
+            for (char *p = base; *p; p++) *p = (char)tolower((unsigned char)*p);
+            HyperLogLogAdd(&sketch->distinct[FLEET_HLL_MODULES], base, strlen(base));
+            CountMinAdd(&sketch->frequencies[FLEET_CMS_MODULES], base, strlen(base), 1);
+            moduleCount++;
+        }
+        fclose(modules);
+        DigestAdd(&sketch->metrics[FLEET_DIGEST_MODULE_COUNT], (double)moduleCount, 1.0);
+    }
+
+    // Strings as written by the extractor: "<address> <a|u> <text>"
+    uint64_t stringCount = 0;
+    _stprintf(fileName, _T("%s\\windbg_output_strings.txt"), processFolder);
+    FILE *strings = _tfopen(fileName, _T("rb"));
+    if (strings) {
+        while (fgets(line, sizeof(line), strings)) {
+            size_t length = TrimLine(line);
+            if (length < 20 || line[16] != ' ' || line[18] != ' ') continue;
+            CountMinAdd(&sketch->frequencies[FLEET_CMS_STRINGS], line + 19, length - 19, 1);
+            stringCount++;
+        }
+        fclose(strings);
+        DigestAdd(&sketch->metrics[FLEET_DIGEST_STRING_COUNT], (double)stringCount, 1.0);
+    }
+
+    _stprintf(fileName, _T("%s\\windbg_output_memory.features"), processFolder);
+    if (ReadFeatureValue(fileName, "mem_bytes", &value)) {
+        DigestAdd(&sketch->metrics[FLEET_DIGEST_MEMORY_BYTES], value, 1.0);
+    }
+    if (ReadFeatureValue(fileName, "mem_entropy_mean", &value)) {
+        DigestAdd(&sketch->metrics[FLEET_DIGEST_ENTROPY_MEAN], value, 1.0);
+    }
+    _stprintf(fileName, _T("%s\\windbg_output_opcodes.features"), processFolder);
+    if (ReadFeatureValue(fileName, "op_exec_bytes", &value)) {
+        DigestAdd(&sketch->metrics[FLEET_DIGEST_EXEC_BYTES], value, 1.0);
+    }
+}
+
+static int CompareTopK(const void *a, const void *b) {
+    uint64_t ea = ((const TopKEntry *)a)->estimate;
+    uint64_t eb = ((const TopKEntry *)b)->estimate;
+    return (ea < eb) - (ea > eb);
+}
+
+// Function to merge two count-min tables and re-rank the union of both candidate lists
+static void MergeCountMin(CountMinTopK *into, const CountMinTopK *from) {
+    TopKEntry candidates[2 * SKETCH_TOPK];
+    uint32_t candidateCount = 0;
+
+    for (int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        for (int column = 0; column < SKETCH_CMS_WIDTH; column++) {
+            uint32_t *counter = &into->counters[row][column];
+            uint32_t add = from->counters[row][column];
+            *counter = (*counter > UINT32_MAX - add) ? UINT32_MAX : *counter + add;
+        }
+    }
+    into->total += from->total;
+
+    const CountMinTopK *sources[2] = { into, from };
+    for (int s = 0; s < 2; s++) {
+        for (uint32_t i = 0; i < sources[s]->topCount; i++) {
+            bool seen = false;
+            for (uint32_t j = 0; j < candidateCount && !seen; j++) {
+                seen = candidates[j].hash == sources[s]->top[i].hash;
+            }
+            if (!seen) candidates[candidateCount++] = sources[s]->top[i];
+        }
+    }
+    for (uint32_t i = 0; i < candidateCount; i++) {
+        candidates[i].estimate = CountMinEstimateHash(into, candidates[i].hash);
+    }
+    qsort(candidates, candidateCount, sizeof(TopKEntry), CompareTopK);
+    into->topCount = candidateCount < SKETCH_TOPK ? candidateCount : SKETCH_TOPK;
+    memcpy(into->top, candidates, into->topCount * sizeof(TopKEntry));
+}
+
+static void MergeDigest(TDigest *into, const TDigest *from) {
+    double min = into->min < from->min ? into->min : from->min;
+    double max = into->max > from->max ? into->max : from->max;
+    for (uint32_t i = 0; i < from->centroidCount; i++) {
+        DigestAdd(into, from->centroids[i].mean, from->centroids[i].weight);
+    }
+    for (uint32_t i = 0; i < from->bufferCount; i++) {
+        DigestAdd(into, from->buffer[i].mean, from->buffer[i].weight);
+    }
+    into->min = min;
+    into->max = max;
+}
+
+// Function to fold one sketch into another; both have the same layout, as LoadFleetSketch rejects any other
+void MergeFleetSketch(FleetSketch *into, const FleetSketch *from) {
+    for (int i = 0; i < FLEET_HLL_COUNT; i++) {
+        for (uint32_t r = 0; r < SKETCH_HLL_REGISTERS; r++) {
+            if (from->distinct[i].registers[r] > into->distinct[i].registers[r]) {
+                into->distinct[i].registers[r] = from->distinct[i].registers[r];
+            }
+        }
+    }
+    for (int i = 0; i < FLEET_CMS_COUNT; i++) {
+        MergeCountMin(&into->frequencies[i], &from->frequencies[i]);
+    }
+    for (int i = 0; i < FLEET_DIGEST_COUNT; i++) {
+        MergeDigest(&into->metrics[i], &from->metrics[i]);
+    }
+    into->sources += from->sources;
+    into->processes += from->processes;
+}
+
+// Little-endian byte buffer; doubles are stored as their IEEE-754 bit patterns
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    size_t position;
+    bool failed;
+} SketchBuffer;
+
+static void PutBytes(SketchBuffer *buffer, const void *data, size_t size) {
+    if (buffer->failed) return;
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 65536;
+        while (capacity < buffer->size + size) capacity *= 2;
+        uint8_t *grown = (uint8_t *)realloc(buffer->data, capacity);
+        if (!grown) {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static void PutUint(SketchBuffer *buffer, uint64_t value, int bytes) {
+    uint8_t encoded[8];
+    for (int i = 0; i < bytes; i++) {
+        encoded[i] = (uint8_t)(value >> (8 * i));
+    }
+    PutBytes(buffer, encoded, (size_t)bytes);
+}
+
+static void PutDouble(SketchBuffer *buffer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    PutUint(buffer, bits, 8);
+}
+
+static const uint8_t *GetBytes(SketchBuffer *buffer, size_t size) {
+    if (buffer->failed || buffer->position + size > buffer->size) {
+        buffer->failed = true;
+        return NULL;
+    }
+    const uint8_t *data = buffer->data + buffer->position;
+    buffer->position += size;
+    return data;
+}
+
+static uint64_t GetUint(SketchBuffer *buffer, int bytes) {
+    const uint8_t *encoded = GetBytes(buffer, (size_t)bytes);
+    uint64_t value = 0;
+    for (int i = 0; encoded && i < bytes; i++) {
+        value |= (uint64_t)encoded[i] << (8 * i);
+    }
+    return value;
+}
+
+static double GetDouble(SketchBuffer *buffer) {
+    uint64_t bits = GetUint(buffer, 8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Sections carry their own length so readers can skip types they do not know
+static size_t BeginSection(SketchBuffer *buffer, uint32_t type, const char *name) {
+    char paddedName[SKETCH_NAME_SIZE] = { 0 };
+    snprintf(paddedName, sizeof(paddedName), "%s", name);
+    PutUint(buffer, type, 4);
+    PutBytes(buffer, paddedName, SKETCH_NAME_SIZE);
+    PutUint(buffer, 0, 8);
+    return buffer->size;
+}
+
+static void EndSection(SketchBuffer *buffer, size_t payloadStart) {
+    if (buffer->failed) return;
+    uint64_t payloadSize = buffer->size - payloadStart;
+    for (int i = 0; i < 8; i++) {
+        buffer->data[payloadStart - 8 + i] = (uint8_t)(payloadSize >> (8 * i));
+    }
+}
+
+bool SaveFleetSketch(FleetSketch *sketch, const TCHAR *fileName) {
+    SketchBuffer buffer = { 0 };
+    PutBytes(&buffer, FLEET_SKETCH_MAGIC, 4);
+    PutUint(&buffer, FLEET_SKETCH_VERSION, 4);
+    PutUint(&buffer, sketch->sources, 4);
+    PutUint(&buffer, sketch->processes, 4);
+    PutUint(&buffer, FLEET_HLL_COUNT + FLEET_CMS_COUNT + FLEET_DIGEST_COUNT, 4);
+
+    for (int i = 0; i < FLEET_HLL_COUNT; i++) {
+        size_t start = BeginSection(&buffer, SKETCH_SECTION_HLL, sketch->distinct[i].name);
+        PutUint(&buffer, SKETCH_HLL_PRECISION, 1);
+        PutBytes(&buffer, sketch->distinct[i].registers, SKETCH_HLL_REGISTERS);
+        EndSection(&buffer, start);
+    }
+    for (int i = 0; i < FLEET_CMS_COUNT; i++) {
+        const CountMinTopK *cms = &sketch->frequencies[i];
+        size_t start = BeginSection(&buffer, SKETCH_SECTION_CMS, cms->name);
+        PutUint(&buffer, SKETCH_CMS_DEPTH, 4);
+        PutUint(&buffer, SKETCH_CMS_WIDTH, 4);
+        PutUint(&buffer, cms->total, 8);
+        for (int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+            for (int column = 0; column < SKETCH_CMS_WIDTH; column++) {
+                PutUint(&buffer, cms->counters[row][column], 4);
+            }
+        }
+        PutUint(&buffer, cms->topCount, 4);
+        for (uint32_t k = 0; k < cms->topCount; k++) {
+            size_t length = strlen(cms->top[k].key);
+            PutUint(&buffer, cms->top[k].hash, 8);
+            PutUint(&buffer, cms->top[k].estimate, 8);
+            PutUint(&buffer, length, 2);
+            PutBytes(&buffer, cms->top[k].key, length);
+        }
+        EndSection(&buffer, start);
+    }
+    for (int i = 0; i < FLEET_DIGEST_COUNT; i++) {
+        TDigest *digest = &sketch->metrics[i];
+        DigestCompress(digest);
+        size_t start = BeginSection(&buffer, SKETCH_SECTION_DIGEST, digest->name);
+        PutDouble(&buffer, SKETCH_DIGEST_COMPRESSION);
+        PutDouble(&buffer, digest->count);
+        PutDouble(&buffer, digest->min);
+        PutDouble(&buffer, digest->max);
+        PutUint(&buffer, digest->centroidCount, 4);
+        for (uint32_t c = 0; c < digest->centroidCount; c++) {
+            PutDouble(&buffer, digest->centroids[c].mean);
+            PutDouble(&buffer, digest->centroids[c].weight);
+        }
+        EndSection(&buffer, start);
+    }
+
+    // Write beside the target and swap, so a reader never sees half a sketch
+    TCHAR temporaryName[MAX_PATH + 8];
+    _stprintf(temporaryName, _T("%s.tmp"), fileName);
+    FILE *file = buffer.failed ? NULL : _tfopen(temporaryName, _T("wb"));
+    bool ok = file && fwrite(buffer.data, 1, buffer.size, file) == buffer.size;
+    if (file) ok = (fclose(file) == 0) && ok;
+    free(buffer.data);
+    return ok && MoveFileEx(temporaryName, fileName, MOVEFILE_REPLACE_EXISTING);
+}
+
+static bool LoadCountMin(SketchBuffer *section, CountMinTopK *cms) {
+    if (GetUint(section, 4) != SKETCH_CMS_DEPTH || GetUint(section, 4) != SKETCH_CMS_WIDTH) return false;
+    cms->total = GetUint(section, 8);
+    for (int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        for (int column = 0; column < SKETCH_CMS_WIDTH; column++) {
+            cms->counters[row][column] = (uint32_t)GetUint(section, 4);
+        }
+    }
+    uint32_t topCount = (uint32_t)GetUint(section, 4);
+    if (topCount > SKETCH_TOPK) return false;
+    cms->topCount = topCount;
+    for (uint32_t k = 0; k < topCount && !section->failed; k++) {
+        cms->top[k].hash = GetUint(section, 8);
+        cms->top[k].estimate = GetUint(section, 8);
+        size_t length = (size_t)GetUint(section, 2);
+        const uint8_t *key = GetBytes(section, length);
+        if (!key || length >= SKETCH_TOPK_KEY_SIZE) return false;
+        memcpy(cms->top[k].key, key, length);
+        cms->top[k].key[length] = '\0';
+    }
+    return !section->failed;
+}
+
+static bool LoadDigest(SketchBuffer *section, TDigest *digest) {
+    GetDouble(section);     // Compression of the writer; centroids are re-merged at ours
+    double count = GetDouble(section);
+    double min = GetDouble(section);
+    double max = GetDouble(section);
+    uint32_t centroidCount = (uint32_t)GetUint(section, 4);
+    ResetDigest(digest);
+    for (uint32_t c = 0; c < centroidCount && !section->failed; c++) {
+        double mean = GetDouble(section);
+        double weight = GetDouble(section);
+        DigestAdd(digest, mean, weight);
+    }
+    if (digest->count > 0.0) {
+        digest->min = min;
+        digest->max = max;
+    }
+    (void)count;
+    return !section->failed;
+}
+
+// Function to read a sketch file into a sketch from CreateFleetSketch; unknown sections are skipped
+bool LoadFleetSketch(FleetSketch *sketch, const TCHAR *fileName) {
+    FILE *file = _tfopen(fileName, _T("rb"));
+    if (!file) return false;
+    SketchBuffer buffer = { 0 };
+    uint8_t chunk[65536];
+    size_t bytes;
+    while ((bytes = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        PutBytes(&buffer, chunk, bytes);
+    }
+    fclose(file);
+
+    const uint8_t *magic = GetBytes(&buffer, 4);
+    bool ok = magic && memcmp(magic, FLEET_SKETCH_MAGIC, 4) == 0 && GetUint(&buffer, 4) == FLEET_SKETCH_VERSION;
+    if (ok) {
+        sketch->sources = (uint32_t)GetUint(&buffer, 4);
+        sketch->processes = (uint32_t)GetUint(&buffer, 4);
+        uint32_t sectionCount = (uint32_t)GetUint(&buffer, 4);
+
+        for (uint32_t s = 0; ok && s < sectionCount; s++) {
+            uint32_t type = (uint32_t)GetUint(&buffer, 4);
+            const uint8_t *rawName = GetBytes(&buffer, SKETCH_NAME_SIZE);
+            uint64_t payloadSize = GetUint(&buffer, 8);
+            const uint8_t *payload = GetBytes(&buffer, (size_t)payloadSize);
+            if (!rawName || !payload) {
+                ok = false;
+                break;
+            }
+            char name[SKETCH_NAME_SIZE + 1];
+            memcpy(name, rawName, SKETCH_NAME_SIZE);
+            name[SKETCH_NAME_SIZE] = '\0';
+            SketchBuffer section = { (uint8_t *)payload, (size_t)payloadSize, 0, 0, false };
+
+            for (int i = 0; type == SKETCH_SECTION_HLL && i < FLEET_HLL_COUNT; i++) {
+                if (strcmp(name, sketch->distinct[i].name) != 0) continue;
+                const uint8_t *registers = GetUint(&section, 1) == SKETCH_HLL_PRECISION ? GetBytes(&section, SKETCH_HLL_REGISTERS) : NULL;
+                if (!registers) ok = false;
+                else memcpy(sketch->distinct[i].registers, registers, SKETCH_HLL_REGISTERS);
+            }
+            for (int i = 0; type == SKETCH_SECTION_CMS && i < FLEET_CMS_COUNT; i++) {
+                if (strcmp(name, sketch->frequencies[i].name) == 0) ok = LoadCountMin(&section, &sketch->frequencies[i]);
+            }
+            for (int i = 0; type == SKETCH_SECTION_DIGEST && i < FLEET_DIGEST_COUNT; i++) {
+                if (strcmp(name, sketch->metrics[i].name) == 0) ok = LoadDigest(&section, &sketch->metrics[i]);
+            }
+        }
+    }
+    free(buffer.data);
+    return ok && !buffer.failed;
+}
+
+// Function to print estimates with their error bounds
+void PrintFleetSketch(FleetSketch *sketch, uint32_t topCount) {
+    const double hllError = 1.04 / sqrt((double)SKETCH_HLL_REGISTERS);
+    const double cmsEpsilon = exp(1.0) / SKETCH_CMS_WIDTH;
+    const double cmsConfidence = 1.0 - exp(-(double)SKETCH_CMS_DEPTH);
+
+    _tprintf(_T("Fleet sketch: %u runs, %u processes\n"), sketch->sources, sketch->processes);
+    for (int i = 0; i < FLEET_HLL_COUNT; i++) {
+        _tprintf(_T("%hs: ~%.0f (standard error %.2f%%)\n"), sketch->distinct[i].name,
+                 HyperLogLogEstimate(&sketch->distinct[i]), hllError * 100.0);
+    }
+    for (int i = 0; i < FLEET_CMS_COUNT; i++) {
+        CountMinTopK *cms = &sketch->frequencies[i];
+        qsort(cms->top, cms->topCount, sizeof(TopKEntry), CompareTopK);
+        _tprintf(_T("Top %hs (%llu total; counts over by at most %.0f with %.1f%% confidence):\n"), cms->name,
+                 (unsigned long long)cms->total, cmsEpsilon * (double)cms->total, cmsConfidence * 100.0);
+        for (uint32_t k = 0; k < cms->topCount && k < topCount; k++) {
+            _tprintf(_T("  %10llu  %hs\n"), (unsigned long long)cms->top[k].estimate, cms->top[k].key);
+        }
+    }
+    for (int i = 0; i < FLEET_DIGEST_COUNT; i++) {
+        TDigest *digest = &sketch->metrics[i];
+        if (digest->count <= 0.0) continue;
+        _tprintf(_T("%hs: n=%.0f min=%.6g p50=%.6g p90=%.6g p99=%.6g max=%.6g\n"), digest->name, digest->count,
+                 digest->min, DigestQuantile(digest, 0.5), DigestQuantile(digest, 0.9), DigestQuantile(digest, 0.99), digest->max);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef FLEET_SKETCH_H
+#define FLEET_SKETCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+
+#define FLEET_SKETCH_EXTENSION _T(".sketch")
+#define SKETCH_NAME_SIZE 32
+
+// HyperLogLog: 2^14 registers, standard error 1.04 / sqrt(16384) = 0.81%
+#define SKETCH_HLL_PRECISION 14
+#define SKETCH_HLL_REGISTERS (1 << SKETCH_HLL_PRECISION)
+
+// Count-min: overestimate <= e / width * total with probability 1 - e^-depth (0.07% of total, 98.2%)
+#define SKETCH_CMS_DEPTH 4
+#define SKETCH_CMS_WIDTH 4096
+#define SKETCH_TOPK 64
+#define SKETCH_TOPK_KEY_SIZE 128
+
+// t-digest: about compression centroids, tightest at the tails
+#define SKETCH_DIGEST_COMPRESSION 100.0
+#define SKETCH_DIGEST_CENTROIDS 256
+#define SKETCH_DIGEST_BUFFER 512
+
+typedef struct {
+    char name[SKETCH_NAME_SIZE];
+    uint8_t registers[SKETCH_HLL_REGISTERS];
+} HyperLogLog;
+
+typedef struct {
+    uint64_t hash;
+    uint64_t estimate;
+    char key[SKETCH_TOPK_KEY_SIZE];
+} TopKEntry;
+
+typedef struct {
+    char name[SKETCH_NAME_SIZE];
+    uint64_t total;
+    uint32_t counters[SKETCH_CMS_DEPTH][SKETCH_CMS_WIDTH];
+    TopKEntry top[SKETCH_TOPK];
+    uint32_t topCount;
+} CountMinTopK;
+
+typedef struct {
+    double mean;
+    double weight;
+} Centroid;
+
+typedef struct {
+    char name[SKETCH_NAME_SIZE];
+    double count;
+    double min;
+    double max;
+    Centroid centroids[SKETCH_DIGEST_CENTROIDS];
+    uint32_t centroidCount;
+    Centroid buffer[SKETCH_DIGEST_BUFFER];      // Unmerged points, folded in by DigestCompress
+    uint32_t bufferCount;
+} TDigest;
+
+enum { FLEET_HLL_MODULES, FLEET_HLL_PROCESSES, FLEET_HLL_COUNT };
+enum { FLEET_CMS_STRINGS, FLEET_CMS_MODULES, FLEET_CMS_PROCESSES, FLEET_CMS_COUNT };
+enum { FLEET_DIGEST_MEMORY_BYTES, FLEET_DIGEST_ENTROPY_MEAN, FLEET_DIGEST_EXEC_BYTES,
+       FLEET_DIGEST_MODULE_COUNT, FLEET_DIGEST_STRING_COUNT, FLEET_DIGEST_COUNT };
+
+// Per-run summary of captured processes. Merged distinct counts and count-min tables equal those of summarising
+// both runs together; the top-K lists and t-digest centroids can differ, but stay within their error bounds
+typedef struct {
+    uint32_t sources;                           // Runs merged into this sketch
+    uint32_t processes;
+    HyperLogLog distinct[FLEET_HLL_COUNT];
+    CountMinTopK frequencies[FLEET_CMS_COUNT];
+    TDigest metrics[FLEET_DIGEST_COUNT];
+} FleetSketch;
+
+uint64_t SketchHash(const void *data, size_t length);
+void HyperLogLogAdd(HyperLogLog *hll, const void *data, size_t length);
+double HyperLogLogEstimate(const HyperLogLog *hll);
+void CountMinAdd(CountMinTopK *cms, const char *key, size_t length, uint32_t count);
+uint64_t CountMinEstimate(const CountMinTopK *cms, const char *key, size_t length);
+void DigestAdd(TDigest *digest, double value, double weight);
+void DigestCompress(TDigest *digest);
+double DigestQuantile(TDigest *digest, double q);
+
+FleetSketch *CreateFleetSketch(void);
+void AddProcessToFleetSketch(FleetSketch *sketch, const TCHAR *processFolder, const TCHAR *processName);
+void MergeFleetSketch(FleetSketch *into, const FleetSketch *from);
+bool SaveFleetSketch(FleetSketch *sketch, const TCHAR *fileName);
+bool LoadFleetSketch(FleetSketch *sketch, const TCHAR *fileName);
+void PrintFleetSketch(FleetSketch *sketch, uint32_t topCount);
+
+#endif
@@ -9,6 +9,15 @@
 #include <ctype.h>
 #include <time.h>
 #include <commctrl.h>
+#include "Chunk_Store.h"
+#include "Memory_Entropy.h"
+#include "Text_Encoding.h"
+#include "Opcode_Features.h"
+#include "Sweep_Metrics.h"
+#include "Fleet_Sketch.h"
+#include "Capture_Pipeline.h"
+#include "Module_Identity.h"
+#include "Capture_Budget.h"
 
 #pragma comment(lib, "Gdiplus.lib")
 #pragma comment(lib, "Psapi.lib")
@@ -21,9 +30,15 @@
 #define INTERVAL_MS 5000  // 5 seconds interval
 #define BASE_OUTPUT_FOLDER _T("windbg_outputs")
 #define COPY_TIMEOUT_SECONDS 30  // 30 seconds timeout for copy-paste operations
+#define SHUTDOWN_TIMEOUT_MS 60000  // Time allowed for queued captures to finish when the window closes
 
 ULONG_PTR gdiplusToken;
-bool scanningActive = false;
+volatile LONG scanningActive = FALSE;     // Set by the GUI thread, read by the scanning thread
+volatile LONG shutdownRequested = FALSE;
+HANDLE shutdownEvent;                     // Wakes the scanning loop early on shutdown
+ChunkStore chunkStore;  // Shared chunk pool for every memory dump in this sweep
+CapturePipeline capturePipeline;
+ModuleIdentityCache moduleIdentityCache;  // Image hashes by (path, size, write time, file ID), kept across runs
 
 // Function declarations
 void CaptureWinDbgText(HWND hwnd, const TCHAR *outputFolder, bool *quitDetected);
@@ -33,8 +48,11 @@ void InitGDIPlus();
 void CleanupGDIPlus();
 BOOL CALLBACK EnumWindowsProc(HWND hwnd, LPARAM lParam);
 void CaptureTextFromAllWindows(DWORD pid, const TCHAR *outputFolder, bool *quitDetected);
-void CaptureTextFromMemory(DWORD pid, const TCHAR *outputFileName);
-void CaptureModules(DWORD pid, const TCHAR *outputFileName);
+void CaptureTextFromMemory(DWORD pid, CapturePipeline *pipeline, CaptureJob *job);
+bool CaptureMemoryPiece(HANDLE hProcess, CapturePipeline *pipeline, CaptureJob *job, const CaptureSpan *span,
+                        uint64_t base, uint64_t size, bool *gap);
+void GetRegionModuleName(HANDLE hProcess, LPVOID address, char *moduleName, size_t moduleNameSize);
+void CaptureModules(DWORD pid, ModuleIdentityCache *identityCache, const TCHAR *outputFileName);
 bool GetProcessNameByPID(DWORD pid, TCHAR *processName, DWORD processNameSize);
 void TerminateWinDbgProcess(DWORD pid);
 void MoveCursorAndCopy(HWND hwnd, bool *timedOut);
@@ -44,6 +62,8 @@ void HandleErrorPopups();
 void PromptUserToClickOK();
 void StartScanning(HWND hwnd);
 void StopScanning(HWND hwnd);
+bool IsScanningActive(void);
+bool IsShutdownRequested(void);
 
 // GUI Function Declarations
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -60,14 +80,20 @@ void CleanupGDIPlus() {
 
 void CaptureWinDbgText(HWND hwnd, const TCHAR *outputFolder, bool *quitDetected) {
     bool timedOut = false;
+    MetricTimer copyTimer = BeginMetricTimer();
     MoveCursorAndCopy(hwnd, &timedOut);
+    EndMetricTimer(copyTimer, "copy_ui");
     if (timedOut) {
+        AddMetricCounter("copy_timeouts", 1);
         _tprintf(_T("Copy-paste operation timed out. Moving to next application...\n"));
         return;
     }
     TCHAR outputFileName[BUFFER_SIZE];
     _stprintf(outputFileName, _T("%s\\windbg_output_clipboard.txt"), outputFolder);
-    if (SaveClipboardTextToFile(outputFileName, quitDetected)) {
+    MetricTimer saveTimer = BeginMetricTimer();
+    bool quit = SaveClipboardTextToFile(outputFileName, quitDetected);
+    EndMetricTimer(saveTimer, "clipboard_save");
+    if (quit) {
         _tprintf(_T("Detected '=== Quitting ===' in clipboard text. Moving to next application...\n"));
     }
 }
@@ -124,9 +150,12 @@ bool SaveClipboardTextToFile(const TCHAR *outputFileName, bool *quitDetected) {
         if (hClipboardData) {
             WCHAR *pchData = (WCHAR*)GlobalLock(hClipboardData);
             if (pchData) {
-                FILE *outputFile = _tfopen(outputFileName, _T("w"));
+                FILE *outputFile = _tfopen(outputFileName, _T("wb"));
                 if (outputFile) {
-                    _ftprintf(outputFile, _T("%ls\n"), pchData);
+                    // Transcripts are always written as UTF-8
+                    WriteUtf16AsUtf8(outputFile, (const uint16_t*)pchData, wcslen(pchData));
+                    fputs("\r\n", outputFile);
+                    AddMetricCounter("clipboard_bytes_captured", (uint64_t)_ftelli64(outputFile));
                     if (wcsstr(pchData, L"=== Quitting ===") != NULL) {  // Use wcsstr for wide characters
                         foundQuit = true;
                         *quitDetected = true;
@@ -175,7 +204,7 @@ void CaptureTextFromAllWindows(DWORD pid, const TCHAR *outputFolder, bool *quitD
     HWND hwnd = FindWinDbgWindow();
     if (hwnd) {
         bool complete = false;
-        while (!complete && scanningActive) {
+        while (!complete && IsScanningActive()) {
             CaptureWinDbgText(hwnd, outputFolder, quitDetected);
             complete = *quitDetected;
             if (!complete) {
@@ -188,61 +217,132 @@ void CaptureTextFromAllWindows(DWORD pid, const TCHAR *outputFolder, bool *quitD
     }
 }
 
-// Function to read memory of a process and transcribe text
-void CaptureTextFromMemory(DWORD pid, const TCHAR *outputFileName) {
+// Function to read one piece of a span into pooled blocks; the stages see the piece as a region of its own.
+// False if its first block cannot be read, in which case nothing was submitted.
+bool CaptureMemoryPiece(HANDLE hProcess, CapturePipeline *pipeline, CaptureJob *job, const CaptureSpan *span,
+                        uint64_t base, uint64_t size, bool *gap) {
+    // Read a block at a time; the stages stream it, so no piece-sized buffer is needed
+    SIZE_T offset = 0;
+    while (offset < size) {
+        CaptureBlock *block = AcquireCaptureBlock(pipeline);
+        SIZE_T length = (SIZE_T)(size - offset);
+        if (length > PIPELINE_BLOCK_SIZE) length = PIPELINE_BLOCK_SIZE;
+        SIZE_T bytesRead = 0;
+        if (!ReadProcessMemory(hProcess, (LPCVOID)(SIZE_T)(base + offset), block->data, length, &bytesRead) ||
+            bytesRead < length) {
+            if (offset == 0) {
+                ReleaseCaptureBlock(pipeline, block);
+                return false;
+            }
+            // Pages vanished mid-piece; keep the declared size so every stage sees a whole region
+            memset(block->data + bytesRead, 0, length - bytesRead);
+            AddMetricCounter("memory_read_gaps", 1);
+            *gap = true;
+        }
+
+        block->regionBase = base;
+        block->regionSize = size;
+        block->protect = span->protect;
+        block->type = span->type;
+        block->executable = span->executable;
+        block->regionStart = offset == 0;
+        block->regionEnd = offset + length == size;
+        block->length = length;
+        if (block->regionStart && span->executable) {
+            GetRegionModuleName(hProcess, (LPVOID)(SIZE_T)base, block->moduleName, sizeof(block->moduleName));
+        }
+        AddMetricCounter("memory_bytes_captured", length);
+        SubmitCaptureBlock(pipeline, job, block);
+        offset += length;
+    }
+    return true;
+}
+
+// Function to capture a process's memory within the byte and time budget, most telling spans first
+// (stacks, code around instruction pointers, small heaps, module globals), and record what was left out
+void CaptureTextFromMemory(DWORD pid, CapturePipeline *pipeline, CaptureJob *job) {
     HANDLE hProcess = OpenProcess(PROCESS_VM_READ | PROCESS_QUERY_INFORMATION, FALSE, pid);
     if (hProcess == NULL) {
         _tprintf(_T("Failed to open process %d\n"), pid);
         return;
     }
 
-    SYSTEM_INFO sysInfo;
-    GetSystemInfo(&sysInfo);
-    MEMORY_BASIC_INFORMATION memInfo;
-
-    LPVOID addr = sysInfo.lpMinimumApplicationAddress;
-    FILE *outputFile = _tfopen(outputFileName, _T("w"));
+    // Planning counts against the deadline too
+    CapturePlan plan;
+    StartCaptureBudget(&plan, CAPTURE_BYTE_BUDGET, CAPTURE_TIME_BUDGET_MS);
+    if (!BuildCapturePlan(&plan, hProcess, pid)) {
+        _tprintf(_T("Failed to plan memory capture for process %d\n"), pid);
+        FreeCapturePlan(&plan);
+        CloseHandle(hProcess);
+        return;
+    }
 
-    while (addr < sysInfo.lpMaximumApplicationAddress) {
-        if (VirtualQueryEx(hProcess, addr, &memInfo, sizeof(memInfo)) == sizeof(memInfo)) {
-            if (memInfo.State == MEM_COMMIT && (memInfo.Type == MEM_MAPPED || memInfo.Type == MEM_PRIVATE)) {
-                char *buffer = (char*)malloc(memInfo.RegionSize);
-                SIZE_T bytesRead;
-                if (ReadProcessMemory(hProcess, addr, buffer, memInfo.RegionSize, &bytesRead)) {
-                    fwrite(buffer, 1, bytesRead, outputFile);
-                }
-                free(buffer);
+    uint64_t sampledSpans = 0;
+    bool deadlineHit = false;
+    for (size_t i = 0; i < plan.spanCount; i++) {
+        CaptureSpan *span = &plan.spans[i];
+        uint32_t pieceCount = AllotCaptureSpan(&plan, span);
+        for (uint32_t piece = 0; piece < pieceCount; piece++) {
+            if (CaptureDeadlinePassed(&plan)) {
+                StopCaptureSpan(span, CAPTURE_STOP_DEADLINE);
+                break;
             }
-            addr = (LPVOID)((SIZE_T)addr + memInfo.RegionSize);
-        } else {
-            addr = (LPVOID)((SIZE_T)addr + 0x1000);  // Move to next page
+            if (IsShutdownRequested()) {
+                StopCaptureSpan(span, CAPTURE_STOP_SHUTDOWN);
+                break;
+            }
+            uint64_t length = CapturePieceLength(span, piece);
+            if (length == 0) break;
+            bool gap = false;
+            if (!CaptureMemoryPiece(hProcess, pipeline, job, span, span->base + CapturePieceOffset(span, piece), length, &gap)) {
+                StopCaptureSpan(span, CAPTURE_STOP_UNREADABLE);
+                break;
+            }
+            RecordCapturedPiece(&plan, span, length, gap);
         }
+        FinishCaptureSpan(span);
+        if (span->capturedBytes > 0) AddMetricCounter("memory_regions_captured", 1);
+        if (span->outcome == CAPTURE_SAMPLED) sampledSpans++;
+        if (span->stopReason == CAPTURE_STOP_DEADLINE) deadlineHit = true;
+    }
+
+    TCHAR manifestFileName[PIPELINE_PATH_SIZE + 64];
+    _stprintf(manifestFileName, _T("%s\\%s"), job->outputFolder, CAPTURE_MANIFEST_FILE);
+    if (!WriteCaptureManifest(&plan, manifestFileName)) {
+        _tprintf(_T("Failed to write %s\n"), manifestFileName);
+    }
+    AddMetricCounter("memory_bytes_skipped", plan.plannedBytes - plan.bytesUsed);
+    AddMetricCounter("memory_regions_sampled", sampledSpans);
+    if (deadlineHit) {
+        _tprintf(_T("Memory capture of process %d reached its %d ms deadline\n"), pid, CAPTURE_TIME_BUDGET_MS);
+        AddMetricCounter("memory_capture_deadlines", 1);
     }
 
-    fclose(outputFile);
+    FreeCapturePlan(&plan);
     CloseHandle(hProcess);
+}
 
-    // Transcribe memory content to readable text
-    FILE *memFile = _tfopen(outputFileName, _T("r"));
-    FILE *transcribedFile = _tfopen(_T("transcribed_memory_output.txt"), _T("w"));
-    if (memFile && transcribedFile) {
-        char buffer[BUFFER_SIZE];
-        while (fgets(buffer, BUFFER_SIZE, memFile)) {
-            for (int i = 0; buffer[i] != '\0'; i++) {
-                if (isprint(buffer[i])) {
-                    fputc(buffer[i], transcribedFile);
-                } else {
-                    fputc('.', transcribedFile);
-                }
-            }
-        }
-        fclose(memFile);
-        fclose(transcribedFile);
+// Function to name the file mapped at an address as UTF-8, "-" for anonymous memory
+void GetRegionModuleName(HANDLE hProcess, LPVOID address, char *moduleName, size_t moduleNameSize) {
+    WCHAR mappedFileName[MAX_PATH];
+    char fileNameUtf8[MAX_PATH * UTF8_MAX_PER_UTF16 + 1];
+    if (GetMappedFileNameW(hProcess, address, mappedFileName, MAX_PATH) == 0) {
+        snprintf(moduleName, moduleNameSize, "-");
+        return;
     }
+
+    // Device paths such as \Device\HarddiskVolume3\Windows\System32\ntdll.dll; keep the file name
+    const WCHAR *fileName = PathFindFileNameW(mappedFileName);
+    size_t bytes = Utf16ToUtf8((const uint16_t *)fileName, wcslen(fileName), (uint8_t *)fileNameUtf8);
+    fileNameUtf8[bytes] = '\0';
+    for (size_t i = 0; i < bytes; i++) {
+        if (fileNameUtf8[i] == ' ') fileNameUtf8[i] = '_';   // Keep the region line space-separated
+    }
+    snprintf(moduleName, moduleNameSize, "%s", fileNameUtf8);
 }
 
-// Function to capture loaded modules of a process
-void CaptureModules(DWORD pid, const TCHAR *outputFileName) {
+// Function to capture loaded modules of a process, with the hashes that identify each image
+void CaptureModules(DWORD pid, ModuleIdentityCache *identityCache, const TCHAR *outputFileName) {
     HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
     if (hProcess == NULL) {
         _tprintf(_T("Failed to open process %d\n"), pid);
@@ -251,19 +351,32 @@ void CaptureModules(DWORD pid, const TCHAR *outputFileName) {
 
     HMODULE hMods[1024];
     DWORD cbNeeded;
-    FILE *outputFile = _tfopen(outputFileName, _T("w"));
-
-    if (EnumProcessModules(hProcess, hMods, sizeof(hMods), &cbNeeded)) {
-        for (unsigned int i = 0; i < (cbNeeded / sizeof(HMODULE)); i++) {
-            TCHAR szModName[MAX_PATH];
-
-            if (GetModuleFileNameEx(hProcess, hMods[i], szModName, sizeof(szModName) / sizeof(TCHAR))) {
-                _ftprintf(outputFile, _T("%s\n"), szModName);
+    FILE *outputFile = _tfopen(outputFileName, _T("wb"));
+    ModuleIdentity *modules = (ModuleIdentity *)malloc(sizeof(hMods) / sizeof(HMODULE) * sizeof(ModuleIdentity));
+    size_t moduleCount = 0;
+
+    if (outputFile && modules && EnumProcessModules(hProcess, hMods, sizeof(hMods), &cbNeeded)) {
+        DWORD count = cbNeeded / sizeof(HMODULE);
+        if (count > sizeof(hMods) / sizeof(HMODULE)) count = sizeof(hMods) / sizeof(HMODULE);
+        for (unsigned int i = 0; i < count; i++) {
+            // Wide API so non-ANSI module paths survive into the UTF-8 listing
+            ModuleIdentity *module = &modules[moduleCount];
+            DWORD length = GetModuleFileNameExW(hProcess, hMods[i], module->path, MAX_PATH);
+            if (length) {
+                module->pathLength = length;
+                moduleCount++;
             }
         }
+
+        // Each distinct image is hashed once; unchanged images come from the cache
+        IdentifyModules(identityCache, modules, moduleCount);
+        for (size_t i = 0; i < moduleCount; i++) {
+            WriteModuleIdentity(outputFile, &modules[i]);
+        }
     }
 
-    fclose(outputFile);
+    free(modules);
+    if (outputFile) fclose(outputFile);
     CloseHandle(hProcess);
 }
 
@@ -328,18 +441,28 @@ void PromptUserToClickOK() {
 
 // Function to start scanning
 void StartScanning(HWND hwnd) {
-    scanningActive = true;
+    InterlockedExchange(&scanningActive, TRUE);
     EnableWindow(GetDlgItem(hwnd, 1), FALSE);  // Disable the "Start Scanning" button
     EnableWindow(GetDlgItem(hwnd, 2), TRUE);   // Enable the "Stop Scanning" button
 }
 
 // Function to stop scanning
 void StopScanning(HWND hwnd) {
-    scanningActive = false;
+    InterlockedExchange(&scanningActive, FALSE);
     EnableWindow(GetDlgItem(hwnd, 1), TRUE);  // Enable the "Start Scanning" button
     EnableWindow(GetDlgItem(hwnd, 2), FALSE); // Disable the "Stop Scanning" button
 }
 
+// Function to read the scanning flag set by the GUI thread
+bool IsScanningActive(void) {
+    return InterlockedCompareExchange(&scanningActive, FALSE, FALSE) != FALSE;
+}
+
+// Function to check whether the GUI has closed and the scanning loop should wind down
+bool IsShutdownRequested(void) {
+    return InterlockedCompareExchange(&shutdownRequested, FALSE, FALSE) != FALSE;
+}
+
 // Function to create GUI controls
 void AddControls(HWND hwnd) {
     CreateWindowW(L"Button", L"Start Scanning", WS_VISIBLE | WS_CHILD, 50, 50, 150, 50, hwnd, (HMENU)1, NULL, NULL);
@@ -410,58 +533,134 @@ void ScanningLoop() {
     PathAppend(baseOutputPath, BASE_OUTPUT_FOLDER);
     CreateDirectory(baseOutputPath, NULL);
 
-    while (true) {
-        if (scanningActive) {
+    TCHAR chunkStorePath[MAX_PATH];
+    _stprintf(chunkStorePath, _T("%s\\%s"), baseOutputPath, CHUNK_STORE_FOLDER);
+    CreateDirectory(chunkStorePath, NULL);
+    if (!OpenChunkStore(&chunkStore, chunkStorePath)) {
+        _tprintf(_T("Failed to open chunk store at %s\n"), chunkStorePath);
+        return;
+    }
+
+    TCHAR moduleCacheFileName[MAX_PATH];
+    _stprintf(moduleCacheFileName, _T("%s\\%s"), baseOutputPath, MODULE_IDENTITY_CACHE_FILE);
+    if (!OpenModuleIdentityCache(&moduleIdentityCache, moduleCacheFileName)) {
+        _tprintf(_T("Failed to open module identity cache at %s; module hashes will not be kept\n"), moduleCacheFileName);
+    }
+
+    InitMetrics("locate_code");
+    ULONGLONG lastMetricsExport = GetTickCount64();
+
+    // One sketch per run, named by host and start time so runs from many machines merge without clashing
+    FleetSketch *fleetSketch = CreateFleetSketch();
+    TCHAR fleetSketchFileName[MAX_PATH];
+    TCHAR computerName[MAX_COMPUTERNAME_LENGTH + 1];
+    DWORD computerNameSize = MAX_COMPUTERNAME_LENGTH + 1;
+    SYSTEMTIME runStart;
+    if (!GetComputerName(computerName, &computerNameSize)) {
+        _tcscpy(computerName, _T("host"));
+    }
+    GetLocalTime(&runStart);
+    _stprintf(fleetSketchFileName, _T("%s\\fleet_%s_%04d%02d%02d_%02d%02d%02d%s"), baseOutputPath, computerName,
+              runStart.wYear, runStart.wMonth, runStart.wDay, runStart.wHour, runStart.wMinute, runStart.wSecond,
+              FLEET_SKETCH_EXTENSION);
+
+    // Parsing, feature extraction and persistence of one process overlap the capture of the next
+    if (!StartCapturePipeline(&capturePipeline, &chunkStore, fleetSketch, fleetSketchFileName)) {
+        _tprintf(_T("Failed to start the capture pipeline\n"));
+        free(fleetSketch);
+        CloseModuleIdentityCache(&moduleIdentityCache);
+        CloseChunkStore(&chunkStore);
+        return;
+    }
+
+    while (!IsShutdownRequested()) {
+        if (IsScanningActive()) {
+            MetricTimer findTimer = BeginMetricTimer();
             HWND hwnd = FindWinDbgWindow();
+            EndMetricTimer(findTimer, "find_window");
             if (hwnd) {
                 DWORD pid;
                 GetWindowThreadProcessId(hwnd, &pid);
 
+                // A target that cannot be named is skipped, but the loop still waits before the next scan
                 TCHAR processName[BUFFER_SIZE];
                 if (!GetProcessNameByPID(pid, processName, sizeof(processName))) {
                     _tprintf(_T("Failed to get process name for PID %d\n"), pid);
-                    continue;
-                }
-
-                // Create output folder for each process
-                TCHAR outputFolder[BUFFER_SIZE];
-                _stprintf(outputFolder, _T("%s\\%d_%s"), baseOutputPath, pid, processName);
-                CreateDirectory(outputFolder, NULL);
-
-                _tprintf(_T("Found WinDbg window for process %s (PID: %d). Capturing text from main window, popups, and memory...\n"), processName, pid);
-
-                bool quitDetected = false;
-
-                CaptureTextFromAllWindows(pid, outputFolder, &quitDetected);
+                } else {
+                    // Create output folder for each process
+                    TCHAR outputFolder[BUFFER_SIZE];
+                    _stprintf(outputFolder, _T("%s\\%d_%s"), baseOutputPath, pid, processName);
+                    CreateDirectory(outputFolder, NULL);
+
+                    _tprintf(_T("Found WinDbg window for process %s (PID: %d). Capturing text from main window, popups, and memory...\n"), processName, pid);
+
+                    bool quitDetected = false;
+                    MetricTimer windowsTimer = BeginMetricTimer();
+                    CaptureTextFromAllWindows(pid, outputFolder, &quitDetected);
+                    EndMetricTimer(windowsTimer, "capture_windows");
+
+                    CaptureJob *job = BeginCaptureJob(&capturePipeline, pid, processName, outputFolder, quitDetected);
+                    if (job) {
+                        MetricTimer memoryTimer = BeginMetricTimer();
+                        CaptureTextFromMemory(pid, &capturePipeline, job);
+                        EndMetricTimer(memoryTimer, "capture_memory");
+                    }
 
-                TCHAR memoryOutputFileName[BUFFER_SIZE];
-                _stprintf(memoryOutputFileName, _T("%s\\windbg_output_memory.txt"), outputFolder);
-                CaptureTextFromMemory(pid, memoryOutputFileName);
+                    TCHAR modulesOutputFileName[BUFFER_SIZE];
+                    _stprintf(modulesOutputFileName, _T("%s\\windbg_output_modules.txt"), outputFolder);
+                    MetricTimer modulesTimer = BeginMetricTimer();
+                    CaptureModules(pid, &moduleIdentityCache, modulesOutputFileName);
+                    EndMetricTimer(modulesTimer, "capture_modules");
 
-                TCHAR modulesOutputFileName[BUFFER_SIZE];
-                _stprintf(modulesOutputFileName, _T("%s\\windbg_output_modules.txt"), outputFolder);
-                CaptureModules(pid, modulesOutputFileName);
+                    // The stages finish this process in the background while the next one is captured
+                    if (job) {
+                        EndCaptureJob(&capturePipeline, job);
+                    }
 
-                if (quitDetected) {
-                    TerminateWinDbgProcess(pid);
+                    if (quitDetected) {
+                        TerminateWinDbgProcess(pid);
+                    }
                 }
             } else {
                 _tprintf(_T("WinDbg window not found. Retrying...\n"));
             }
         }
-        Sleep(INTERVAL_MS);
+        if (GetTickCount64() - lastMetricsExport >= METRICS_EXPORT_INTERVAL_MS) {
+            ExportMetrics(baseOutputPath);
+            lastMetricsExport = GetTickCount64();
+        }
+        WaitForSingleObject(shutdownEvent, INTERVAL_MS);
     }
 
+    StopCapturePipeline(&capturePipeline);
+    ExportMetrics(baseOutputPath);
+    free(fleetSketch);
+    CloseModuleIdentityCache(&moduleIdentityCache);
+    CloseChunkStore(&chunkStore);
     CleanupGDIPlus();
 }
 
 int main(void) {
+    shutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
     // Create a separate thread for the scanning loop
-    CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)ScanningLoop, NULL, 0, NULL);
+    HANDLE scanningThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)ScanningLoop, NULL, 0, NULL);
 
     // Run the GUI
     HINSTANCE hInstance = GetModuleHandle(NULL);
     wWinMain(hInstance, NULL, NULL, SW_SHOWNORMAL);
 
+    // Let the scanning loop drain the pipeline, export metrics and close the chunk store
+    InterlockedExchange(&scanningActive, FALSE);
+    InterlockedExchange(&shutdownRequested, TRUE);
+    SetEvent(shutdownEvent);
+    if (scanningThread) {
+        if (WaitForSingleObject(scanningThread, SHUTDOWN_TIMEOUT_MS) == WAIT_TIMEOUT) {
+            _tprintf(_T("Scanning thread did not stop within %d seconds\n"), SHUTDOWN_TIMEOUT_MS / 1000);
+        }
+        CloseHandle(scanningThread);
+    }
+    CloseHandle(shutdownEvent);
+
     return 0;
 }
@@ -0,0 +1,270 @@
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Memory_Entropy.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ENTROPY_USE_SSE2 1
+#endif
+
+#define HISTOGRAM_BLOCK_SIZE 32768  // Keeps the merged 16-bit lane counts below 65536
+
+#define PAGE_EXECUTE_ANY (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)
+#define PAGE_EXECUTE_WRITABLE (PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)
+
+static float countLog2Table[ENTROPY_PAGE_SIZE + 1];  // c * log2(c) for every count a page bin can reach
+static bool countLog2TableReady = false;
+
+static void InitCountLog2Table(void) {
+    countLog2Table[0] = 0.0f;
+    for (int c = 1; c <= ENTROPY_PAGE_SIZE; c++) {
+        countLog2Table[c] = (float)(c * log2((double)c));
+    }
+    countLog2TableReady = true;
+}
+
+// Function to fold four 16-bit sub-histograms into a 32-bit histogram
+static void MergeSubHistograms(uint16_t sub[4][256], uint32_t histogram[256]) {
+#ifdef ENTROPY_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < 256; i += 8) {
+        __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_load_si128((const __m128i *)&sub[0][i]),
+                                                  _mm_load_si128((const __m128i *)&sub[1][i])),
+                                    _mm_add_epi16(_mm_load_si128((const __m128i *)&sub[2][i]),
+                                                  _mm_load_si128((const __m128i *)&sub[3][i])));
+        __m128i low = _mm_loadu_si128((const __m128i *)&histogram[i]);
+        __m128i high = _mm_loadu_si128((const __m128i *)&histogram[i + 4]);
+        _mm_storeu_si128((__m128i *)&histogram[i], _mm_add_epi32(low, _mm_unpacklo_epi16(sum, zero)));
+        _mm_storeu_si128((__m128i *)&histogram[i + 4], _mm_add_epi32(high, _mm_unpackhi_epi16(sum, zero)));
+    }
+#else
+    for (int i = 0; i < 256; i++) {
+        histogram[i] += (uint32_t)sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
+    }
+#endif
+}
+
+// Function to add the byte counts of data into histogram. Four interleaved
+// sub-histograms keep consecutive increments from stalling on the same counter.
+void ByteHistogram(const uint8_t *data, size_t size, uint32_t histogram[256]) {
+#ifdef _MSC_VER
+    __declspec(align(16)) uint16_t sub[4][256];
+#else
+    uint16_t sub[4][256] __attribute__((aligned(16)));
+#endif
+
+    while (size > 0) {
+        size_t block = size < HISTOGRAM_BLOCK_SIZE ? size : HISTOGRAM_BLOCK_SIZE;
+        const uint8_t *p = data;
+        const uint8_t *end = data + block;
+        memset(sub, 0, sizeof(sub));
+
+        for (; p + 8 <= end; p += 8) {
+            uint64_t word;
+            memcpy(&word, p, sizeof(word));
+            sub[0][word & 0xff]++;
+            sub[1][(word >> 8) & 0xff]++;
+            sub[2][(word >> 16) & 0xff]++;
+            sub[3][(word >> 24) & 0xff]++;
+            sub[0][(word >> 32) & 0xff]++;
+            sub[1][(word >> 40) & 0xff]++;
+            sub[2][(word >> 48) & 0xff]++;
+            sub[3][word >> 56]++;
+        }
+        for (; p < end; p++) {
+            sub[0][*p]++;
+        }
+
+        MergeSubHistograms(sub, histogram);
+        data += block;
+        size -= block;
+    }
+}
+
+// Function to compute Shannon entropy in bits per byte: log2(N) - sum(c * log2(c)) / N
+double HistogramEntropy(const uint32_t histogram[256], uint64_t total) {
+    if (total == 0) return 0.0;
+    if (!countLog2TableReady) InitCountLog2Table();
+
+    double sum = 0.0;
+    for (int i = 0; i < 256; i++) {
+        uint32_t c = histogram[i];
+        sum += (c <= ENTROPY_PAGE_SIZE) ? (double)countLog2Table[c] : c * log2((double)c);
+    }
+    double entropy = log2((double)total) - sum / (double)total;
+    return entropy < 0.0 ? 0.0 : entropy;
+}
+
+static uint32_t PrintableCount(const uint32_t histogram[256]) {
+    uint32_t count = histogram['\t'] + histogram['\n'] + histogram['\r'];
+    for (int i = 0x20; i < 0x7f; i++) {
+        count += histogram[i];
+    }
+    return count;
+}
+
+// Function to score the page just completed and fold it into the region and process summaries
+static void FinishEntropyPage(EntropyMapWriter *writer) {
+    EntropySummary *summary = &writer->summary;
+    double entropy = HistogramEntropy(writer->pageHistogram, writer->pageFill);
+    bool executable = (writer->regionProtect & PAGE_EXECUTE_ANY) != 0;
+
+    summary->pageCount++;
+    summary->entropySum += entropy;
+    summary->entropySquareSum += entropy * entropy;
+    if (entropy > summary->maxEntropy) summary->maxEntropy = entropy;
+    // A page of all 256 byte values reaches exactly 8.0 bits; it shares the top bucket and map character
+    int bucket = entropy >= 8.0 ? 7 : (int)entropy;
+    summary->entropyBuckets[bucket]++;
+
+    char mapChar = (char)('0' + bucket);
+    if (writer->pageHistogram[0] == writer->pageFill) {
+        summary->zeroPages++;
+        mapChar = '_';
+    }
+    if (entropy >= ENTROPY_HIGH_THRESHOLD) {
+        summary->highEntropyPages++;
+        if (executable) summary->executableHighEntropyPages++;
+    }
+    if (PrintableCount(writer->pageHistogram) >= ENTROPY_TEXT_THRESHOLD * writer->pageFill) {
+        summary->textPages++;
+    }
+    if (executable) {
+        summary->executablePages++;
+        if (writer->regionProtect & PAGE_EXECUTE_WRITABLE) summary->writableExecutablePages++;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        summary->byteHistogram[i] += writer->pageHistogram[i];
+    }
+
+    if (writer->regionMap && writer->regionPages < writer->regionMapPages) {
+        writer->regionMap[writer->regionPages] = mapChar;
+    }
+    writer->regionPages++;
+    writer->regionEntropySum += entropy;
+    if (entropy > writer->regionMaxEntropy) writer->regionMaxEntropy = entropy;
+
+    memset(writer->pageHistogram, 0, sizeof(writer->pageHistogram));
+    writer->pageFill = 0;
+}
+
+bool BeginEntropyMap(EntropyMapWriter *writer, const TCHAR *mapFileName) {
+    memset(writer, 0, sizeof(*writer));
+    if (!countLog2TableReady) InitCountLog2Table();
+    writer->mapFile = _tfopen(mapFileName, _T("w"));
+    if (!writer->mapFile) return false;
+    fprintf(writer->mapFile, "# base size protect type pages mean_entropy max_entropy map('_'=zero page, digit=whole bits of entropy)\n");
+    return true;
+}
+
+void BeginEntropyRegion(EntropyMapWriter *writer, uint64_t baseAddress, uint64_t regionSize, uint32_t protect, uint32_t type) {
+    if (writer->regionOpen) EndEntropyRegion(writer);
+    uint64_t pages = (regionSize + ENTROPY_PAGE_SIZE - 1) / ENTROPY_PAGE_SIZE;
+    writer->regionBase = baseAddress;
+    writer->regionSize = regionSize;
+    writer->regionProtect = protect;
+    writer->regionType = type;
+    writer->regionPages = 0;
+    writer->regionEntropySum = 0.0;
+    writer->regionMaxEntropy = 0.0;
+    writer->regionMapPages = pages;
+    writer->regionMap = (pages <= ENTROPY_MAP_MAX_PAGES) ? (char *)malloc((size_t)pages + 1) : NULL;
+    writer->regionOpen = true;
+}
+
+// Function to stream region bytes; pages may be split across calls
+void AppendEntropyData(EntropyMapWriter *writer, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    writer->summary.bytes += size;
+    while (size > 0) {
+        size_t take = ENTROPY_PAGE_SIZE - writer->pageFill;
+        if (take > size) take = size;
+        ByteHistogram(bytes, take, writer->pageHistogram);
+        writer->pageFill += (uint32_t)take;
+        bytes += take;
+        size -= take;
+        if (writer->pageFill == ENTROPY_PAGE_SIZE) {
+            FinishEntropyPage(writer);
+        }
+    }
+}
+
+void EndEntropyRegion(EntropyMapWriter *writer) {
+    if (!writer->regionOpen) return;
+    if (writer->pageFill > 0) {
+        FinishEntropyPage(writer);
+    }
+
+    // Terminate the map after the pages that actually arrived
+    if (writer->regionMap) {
+        writer->regionMap[writer->regionPages < writer->regionMapPages ? writer->regionPages : writer->regionMapPages] = '\0';
+    }
+    double mean = writer->regionPages ? writer->regionEntropySum / (double)writer->regionPages : 0.0;
+    fprintf(writer->mapFile, "%016llx %016llx %08x %08x %llu %.2f %.2f %s\n",
+            (unsigned long long)writer->regionBase, (unsigned long long)writer->regionSize,
+            writer->regionProtect, writer->regionType, (unsigned long long)writer->regionPages,
+            mean, writer->regionMaxEntropy, writer->regionMap ? writer->regionMap : "-");
+
+    free(writer->regionMap);
+    writer->regionMap = NULL;
+    writer->regionOpen = false;
+}
+
+void EndEntropyMap(EntropyMapWriter *writer) {
+    if (writer->regionOpen) EndEntropyRegion(writer);
+    if (writer->mapFile) {
+        fclose(writer->mapFile);
+        writer->mapFile = NULL;
+    }
+}
+
+static double Ratio(uint64_t part, uint64_t whole) {
+    return whole ? (double)part / (double)whole : 0.0;
+}
+
+// Function to write the process summary as "name value" lines for the classifier
+bool WriteEntropyFeatures(const EntropySummary *summary, const TCHAR *featuresFileName) {
+    FILE *featuresFile = _tfopen(featuresFileName, _T("w"));
+    if (!featuresFile) return false;
+
+    uint64_t pages = summary->pageCount;
+    double mean = pages ? summary->entropySum / (double)pages : 0.0;
+    double variance = pages ? summary->entropySquareSum / (double)pages - mean * mean : 0.0;
+    uint32_t byteHistogram[256];
+    uint64_t total = 0;
+    for (int i = 0; i < 256; i++) {
+        total += summary->byteHistogram[i];
+    }
+    // Rescale so the 32-bit entropy helper sees the same distribution
+    for (int i = 0; i < 256; i++) {
+        byteHistogram[i] = total > UINT32_MAX ? (uint32_t)(summary->byteHistogram[i] * ((double)UINT32_MAX / (double)total))
+                                               : (uint32_t)summary->byteHistogram[i];
+    }
+    uint64_t scaledTotal = 0;
+    for (int i = 0; i < 256; i++) {
+        scaledTotal += byteHistogram[i];
+    }
+
+    fprintf(featuresFile, "mem_bytes %llu\n", (unsigned long long)summary->bytes);
+    fprintf(featuresFile, "mem_pages %llu\n", (unsigned long long)pages);
+    fprintf(featuresFile, "mem_zero_page_ratio %.6f\n", Ratio(summary->zeroPages, pages));
+    fprintf(featuresFile, "mem_text_page_ratio %.6f\n", Ratio(summary->textPages, pages));
+    fprintf(featuresFile, "mem_high_entropy_ratio %.6f\n", Ratio(summary->highEntropyPages, pages));
+    fprintf(featuresFile, "mem_entropy_mean %.6f\n", mean);
+    fprintf(featuresFile, "mem_entropy_stddev %.6f\n", variance > 0.0 ? sqrt(variance) : 0.0);
+    fprintf(featuresFile, "mem_entropy_max %.6f\n", summary->maxEntropy);
+    fprintf(featuresFile, "mem_byte_entropy %.6f\n", HistogramEntropy(byteHistogram, scaledTotal));
+    fprintf(featuresFile, "mem_exec_pages %llu\n", (unsigned long long)summary->executablePages);
+    fprintf(featuresFile, "mem_exec_high_entropy_ratio %.6f\n",
+            Ratio(summary->executableHighEntropyPages, summary->executablePages));
+    fprintf(featuresFile, "mem_rwx_pages %llu\n", (unsigned long long)summary->writableExecutablePages);
+    for (int i = 0; i < 8; i++) {
+        fprintf(featuresFile, "mem_entropy_bucket_%d %.6f\n", i, Ratio(summary->entropyBuckets[i], pages));
+    }
+
+    fclose(featuresFile);
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef MEMORY_ENTROPY_H
+#define MEMORY_ENTROPY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+
+#define ENTROPY_PAGE_SIZE 4096
+#define ENTROPY_HIGH_THRESHOLD 7.2   // Packed, compressed or encrypted data
+#define ENTROPY_TEXT_THRESHOLD 0.85  // Share of printable bytes for a page to count as text
+#define ENTROPY_MAP_MAX_PAGES 65536  // Longer regions are summarised without a per-page map
+
+// Aggregate memory-shape features for one process
+typedef struct {
+    uint64_t bytes;
+    uint64_t pageCount;
+    uint64_t zeroPages;
+    uint64_t highEntropyPages;
+    uint64_t textPages;
+    uint64_t executablePages;
+    uint64_t executableHighEntropyPages;
+    uint64_t writableExecutablePages;
+    uint64_t entropyBuckets[8];     // Pages per whole bit of entropy
+    double entropySum;
+    double entropySquareSum;
+    double maxEntropy;
+    uint64_t byteHistogram[256];    // Whole-process byte distribution
+} EntropySummary;
+
+// Streams region bytes page by page and writes one entropy map line per region
+typedef struct {
+    FILE *mapFile;
+    EntropySummary summary;
+    uint32_t pageHistogram[256];
+    uint32_t pageFill;
+    uint64_t regionBase;
+    uint64_t regionSize;
+    uint32_t regionProtect;
+    uint32_t regionType;
+    uint64_t regionPages;
+    double regionEntropySum;
+    double regionMaxEntropy;
+    char *regionMap;
+    uint64_t regionMapPages;
+    bool regionOpen;
+} EntropyMapWriter;
+
+void ByteHistogram(const uint8_t *data, size_t size, uint32_t histogram[256]);
+double HistogramEntropy(const uint32_t histogram[256], uint64_t total);
+
+bool BeginEntropyMap(EntropyMapWriter *writer, const TCHAR *mapFileName);
+void BeginEntropyRegion(EntropyMapWriter *writer, uint64_t baseAddress, uint64_t regionSize, uint32_t protect, uint32_t type);
+void AppendEntropyData(EntropyMapWriter *writer, const void *data, size_t size);
+void EndEntropyRegion(EntropyMapWriter *writer);
+void EndEntropyMap(EntropyMapWriter *writer);
+bool WriteEntropyFeatures(const EntropySummary *summary, const TCHAR *featuresFileName);
+
+#endif
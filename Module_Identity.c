@@ -0,0 +1,424 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "Module_Identity.h"
+#include "Sweep_Metrics.h"
+
+#define CACHE_LINE_SIZE (MODULE_PATH_UTF8_SIZE + 256)
+
+// One image being hashed in one lane of a hashing thread
+typedef struct {
+    ModuleIdentity *module;
+    HANDLE file;
+    Sha256Context sha;
+    Xxh64Context fast;
+    uint8_t *buffer;          // Read-ahead of MODULE_HASH_READ_SIZE plus a partial block carried over
+    size_t offset;            // First byte not yet given to SHA-256
+    size_t length;
+    bool atEnd;
+} HashLane;
+
+// Cache misses shared by the hashing threads; each claims the next one with an atomic increment
+typedef struct {
+    ModuleIdentity **pending;
+    size_t count;
+    volatile LONG next;
+} HashQueue;
+
+typedef struct {
+    HashQueue *queue;
+    uint64_t bytesHashed;
+} HashWorker;
+
+// FNV-1a over the lowercased path: Windows paths are case-insensitive
+static uint64_t PathHash(const char *path) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        hash ^= (uint64_t)tolower(*p);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void LowercasePath(const char *path, char *lowered, size_t size) {
+    size_t i = 0;
+    for (; path[i] && i + 1 < size; i++) lowered[i] = (char)tolower((unsigned char)path[i]);
+    lowered[i] = '\0';
+}
+
+static ModuleCacheEntry *FindCacheEntry(ModuleIdentityCache *cache, const char *loweredPath) {
+    if (cache->slotCount == 0) return NULL;
+    size_t mask = cache->slotCount - 1;
+    for (size_t slot = PathHash(loweredPath) & mask; cache->slots[slot]; slot = (slot + 1) & mask) {
+        ModuleCacheEntry *entry = &cache->entries[cache->slots[slot] - 1];
+        if (strcmp(entry->path, loweredPath) == 0) return entry;
+    }
+    return NULL;
+}
+
+// Function to double the slot table and rehash every entry
+static bool GrowCacheSlots(ModuleIdentityCache *cache) {
+    size_t slotCount = cache->slotCount ? cache->slotCount * 2 : 1024;
+    uint32_t *slots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+    if (!slots) return false;
+    for (size_t i = 0; i < cache->entryCount; i++) {
+        size_t slot = PathHash(cache->entries[i].path) & (slotCount - 1);
+        while (slots[slot]) slot = (slot + 1) & (slotCount - 1);
+        slots[slot] = (uint32_t)(i + 1);
+    }
+    free(cache->slots);
+    cache->slots = slots;
+    cache->slotCount = slotCount;
+    return true;
+}
+
+// Function to add or replace the cached hashes of a path; a replaced record becomes stale in the file
+static bool StoreCacheEntry(ModuleIdentityCache *cache, const ModuleCacheEntry *record) {
+    ModuleCacheEntry *entry = FindCacheEntry(cache, record->path);
+    if (entry) {
+        char *path = entry->path;
+        *entry = *record;
+        entry->path = path;
+        cache->staleRecords++;
+        return true;
+    }
+
+    if ((cache->entryCount + 1) * 2 > cache->slotCount && !GrowCacheSlots(cache)) return false;
+    if (cache->entryCount == cache->entryCapacity) {
+        size_t capacity = cache->entryCapacity ? cache->entryCapacity * 2 : 256;
+        ModuleCacheEntry *entries = (ModuleCacheEntry *)realloc(cache->entries, capacity * sizeof(ModuleCacheEntry));
+        if (!entries) return false;
+        cache->entries = entries;
+        cache->entryCapacity = capacity;
+    }
+    entry = &cache->entries[cache->entryCount];
+    *entry = *record;
+    entry->path = _strdup(record->path);
+    if (!entry->path) return false;
+
+    size_t slot = PathHash(entry->path) & (cache->slotCount - 1);
+    while (cache->slots[slot]) slot = (slot + 1) & (cache->slotCount - 1);
+    cache->slots[slot] = (uint32_t)(++cache->entryCount);
+    return true;
+}
+
+static void WriteCacheRecord(FILE *file, const ModuleCacheEntry *entry) {
+    char shaHex[SHA256_HEX_SIZE];
+    DigestToHex(entry->sha256, SHA256_DIGEST_SIZE, shaHex);
+    fprintf(file, "%s\t%016llx\t%llu\t%llu\t%08x\t%016llx\t%s\n", shaHex, (unsigned long long)entry->fastHash,
+            (unsigned long long)entry->fileSize, (unsigned long long)entry->lastWriteTime, entry->volumeSerial,
+            (unsigned long long)entry->fileIndex, entry->path);
+}
+
+// Function to parse one cache record; a torn or malformed line is rejected
+static bool ParseCacheRecord(char *line, ModuleCacheEntry *entry) {
+    char shaHex[SHA256_HEX_SIZE];
+    unsigned long long fastHash, fileSize, lastWriteTime, fileIndex;
+    unsigned int volumeSerial;
+    int pathStart = 0;
+    if (sscanf(line, "%64[0-9a-f]\t%llx\t%llu\t%llu\t%x\t%llx\t%n", shaHex, &fastHash, &fileSize, &lastWriteTime,
+               &volumeSerial, &fileIndex, &pathStart) != 6 || pathStart == 0) {
+        return false;
+    }
+    size_t length = strlen(line);
+    if (length == 0 || line[length - 1] != '\n') return false;
+    line[--length] = '\0';
+    if ((size_t)pathStart >= length || !HexToDigest(shaHex, entry->sha256, SHA256_DIGEST_SIZE)) return false;
+
+    entry->path = line + pathStart;
+    entry->fastHash = fastHash;
+    entry->fileSize = fileSize;
+    entry->lastWriteTime = lastWriteTime;
+    entry->volumeSerial = volumeSerial;
+    entry->fileIndex = fileIndex;
+    return true;
+}
+
+// Function to rewrite the cache with one record per path, then swap it in
+static bool CompactModuleIdentityCache(ModuleIdentityCache *cache) {
+    TCHAR temporaryName[MAX_PATH + 8];
+    _stprintf(temporaryName, _T("%s.tmp"), cache->fileName);
+    FILE *file = _tfopen(temporaryName, _T("wb"));
+    if (!file) return false;
+    fprintf(file, "%s\n", MODULE_IDENTITY_HEADER);
+    for (size_t i = 0; i < cache->entryCount; i++) {
+        WriteCacheRecord(file, &cache->entries[i]);
+    }
+    if (fclose(file) != 0) return false;
+    if (cache->file) {
+        fclose(cache->file);
+        cache->file = NULL;
+    }
+    cache->staleRecords = 0;
+    return MoveFileEx(temporaryName, cache->fileName, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+// Function to load the cache and keep the file open for appending; a missing or foreign file starts empty
+bool OpenModuleIdentityCache(ModuleIdentityCache *cache, const TCHAR *fileName) {
+    memset(cache, 0, sizeof(*cache));
+    _tcsncpy(cache->fileName, fileName, MAX_PATH - 1);
+
+    bool torn = false;
+    FILE *existing = _tfopen(fileName, _T("rb"));
+    if (existing) {
+        char line[CACHE_LINE_SIZE];
+        torn = !fgets(line, sizeof(line), existing) || strncmp(line, MODULE_IDENTITY_HEADER, strlen(MODULE_IDENTITY_HEADER)) != 0;
+        ModuleCacheEntry record;
+        while (!torn && fgets(line, sizeof(line), existing)) {
+            // Records are appended one line at a time; anything after a torn line is dropped
+            torn = !ParseCacheRecord(line, &record) || !StoreCacheEntry(cache, &record);
+        }
+        fclose(existing);
+    }
+
+    // A torn tail or a foreign file is replaced by the records that did load
+    if ((!existing || torn || cache->staleRecords > cache->entryCount) && !CompactModuleIdentityCache(cache)) {
+        return false;
+    }
+    cache->file = _tfopen(fileName, _T("ab"));
+    return cache->file != NULL;
+}
+
+void CloseModuleIdentityCache(ModuleIdentityCache *cache) {
+    if (cache->file && cache->staleRecords > cache->entryCount) {
+        CompactModuleIdentityCache(cache);
+    }
+    if (cache->file) fclose(cache->file);
+    for (size_t i = 0; i < cache->entryCount; i++) free(cache->entries[i].path);
+    free(cache->entries);
+    free(cache->slots);
+    memset(cache, 0, sizeof(*cache));
+}
+
+// Function to read the size, write time and file ID that key the cache
+static bool StatModuleImage(ModuleIdentity *module) {
+    HANDLE file = CreateFileW(module->path, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    BY_HANDLE_FILE_INFORMATION info;
+    bool ok = GetFileInformationByHandle(file, &info) != 0;
+    CloseHandle(file);
+    if (!ok) return false;
+
+    module->fileSize = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    module->lastWriteTime = ((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+    module->volumeSerial = info.dwVolumeSerialNumber;
+    module->fileIndex = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    return true;
+}
+
+static ModuleIdentity *ClaimModule(HashQueue *queue) {
+    LONG index = InterlockedIncrement(&queue->next) - 1;
+    return (size_t)index < queue->count ? queue->pending[index] : NULL;
+}
+
+// Function to put the next pending image into an idle lane; false when none is left
+static bool FillLane(HashLane *lane, HashQueue *queue) {
+    ModuleIdentity *module;
+    while ((module = ClaimModule(queue)) != NULL) {
+        lane->file = CreateFileW(module->path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                 NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (lane->file == INVALID_HANDLE_VALUE) continue;
+        lane->module = module;
+        lane->offset = 0;
+        lane->length = 0;
+        lane->atEnd = false;
+        Sha256Init(&lane->sha);
+        Xxh64Init(&lane->fast, 0);
+        return true;
+    }
+    return false;
+}
+
+static void FinishLane(HashLane *lane, bool complete) {
+    if (complete) {
+        Sha256Final(&lane->sha, lane->module->sha256);
+        lane->module->fastHash = Xxh64Final(&lane->fast);
+        lane->module->identified = true;
+    }
+    CloseHandle(lane->file);
+    lane->module = NULL;
+}
+
+// Function to make sure a lane holds at least one whole SHA-256 block: it reads more when it runs
+// short, and finishes its image with the last partial block and takes the next one when the file ends.
+// False when the lane has nothing left to hash.
+static bool PrepareLane(HashLane *lane, HashWorker *worker, bool *queueEmpty) {
+    while (true) {
+        if (!lane->module) {
+            if (*queueEmpty) return false;
+            if (!FillLane(lane, worker->queue)) {
+                *queueEmpty = true;
+                return false;
+            }
+        }
+
+        size_t remaining = lane->length - lane->offset;
+        if (remaining >= SHA256_BLOCK_SIZE) return true;
+        if (lane->atEnd) {
+            Sha256Update(&lane->sha, lane->buffer + lane->offset, remaining);
+            FinishLane(lane, true);
+            continue;
+        }
+
+        // Carry the partial block to the front so the lane's contexts only ever see whole blocks
+        memmove(lane->buffer, lane->buffer + lane->offset, remaining);
+        lane->offset = 0;
+        lane->length = remaining;
+        DWORD bytesRead = 0;
+        if (!ReadFile(lane->file, lane->buffer + lane->length, MODULE_HASH_READ_SIZE, &bytesRead, NULL)) {
+            FinishLane(lane, false);
+            continue;
+        }
+        Xxh64Update(&lane->fast, lane->buffer + lane->length, bytesRead);
+        worker->bytesHashed += bytesRead;
+        lane->length += bytesRead;
+        if (bytesRead < MODULE_HASH_READ_SIZE) lane->atEnd = true;
+    }
+}
+
+// Function to hash pending images four at a time. Each lane buffers its own image; every round the
+// longest run of whole blocks that all live lanes hold goes through one multi-buffer SHA-256 transform,
+// and only the lanes that ran short read again, so images of different sizes still share transforms
+static DWORD WINAPI HashThread(LPVOID parameter) {
+    HashWorker *worker = (HashWorker *)parameter;
+    const size_t laneBufferSize = MODULE_HASH_READ_SIZE + SHA256_BLOCK_SIZE;
+    uint8_t *buffers = (uint8_t *)malloc((size_t)SHA256_LANES * laneBufferSize);
+    if (!buffers) return 1;
+
+    HashLane lanes[SHA256_LANES];
+    memset(lanes, 0, sizeof(lanes));
+    for (int i = 0; i < SHA256_LANES; i++) lanes[i].buffer = buffers + (size_t)i * laneBufferSize;
+
+    bool queueEmpty = false;
+    while (true) {
+        Sha256Context *contexts[SHA256_LANES];
+        const uint8_t *data[SHA256_LANES];
+        size_t common = SIZE_MAX;
+        int live = 0;
+
+        for (int i = 0; i < SHA256_LANES; i++) {
+            HashLane *lane = &lanes[i];
+            contexts[i] = NULL;
+            data[i] = NULL;
+            if (!PrepareLane(lane, worker, &queueEmpty)) continue;
+            size_t blocks = (lane->length - lane->offset) & ~(size_t)(SHA256_BLOCK_SIZE - 1);
+            if (blocks < common) common = blocks;
+            contexts[i] = &lane->sha;
+            data[i] = lane->buffer + lane->offset;
+            live++;
+        }
+        if (live == 0) break;
+
+        Sha256UpdateLanes(contexts, data, common);
+        for (int i = 0; i < SHA256_LANES; i++) {
+            if (contexts[i]) lanes[i].offset += common;
+        }
+    }
+
+    free(buffers);
+    return 0;
+}
+
+// Function to hash the cache misses on up to one thread per processor
+static uint64_t HashPendingModules(ModuleIdentity **pending, size_t count) {
+    HashQueue queue = { pending, count, 0 };
+    HashWorker workers[MODULE_HASH_MAX_THREADS];
+    HANDLE threads[MODULE_HASH_MAX_THREADS];
+
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    size_t threadCount = (count + SHA256_LANES - 1) / SHA256_LANES;
+    if (threadCount > sysInfo.dwNumberOfProcessors) threadCount = sysInfo.dwNumberOfProcessors;
+    if (threadCount > MODULE_HASH_MAX_THREADS) threadCount = MODULE_HASH_MAX_THREADS;
+    if (threadCount == 0) threadCount = 1;
+
+    DWORD started = 0;
+    for (size_t i = 0; i < threadCount; i++) {
+        workers[i].queue = &queue;
+        workers[i].bytesHashed = 0;
+        if (i == 0) continue;  // The calling thread is the first worker
+        threads[started] = CreateThread(NULL, 0, HashThread, &workers[i], 0, NULL);
+        if (threads[started]) started++;
+    }
+    HashThread(&workers[0]);
+    if (started) WaitForMultipleObjects(started, threads, TRUE, INFINITE);
+
+    uint64_t bytesHashed = 0;
+    for (DWORD i = 0; i < started; i++) CloseHandle(threads[i]);
+    for (size_t i = 0; i < threadCount; i++) bytesHashed += workers[i].bytesHashed;
+    return bytesHashed;
+}
+
+// Function to fill in the identity of each module: from the cache when the image is unchanged,
+// otherwise by hashing it, after which the cache is updated on disk
+void IdentifyModules(ModuleIdentityCache *cache, ModuleIdentity *modules, size_t count) {
+    ModuleIdentity **pending = (ModuleIdentity **)malloc((count + 1) * sizeof(ModuleIdentity *));
+    if (!pending) return;
+    size_t pendingCount = 0;
+    uint64_t hits = 0;
+    char loweredPath[MODULE_PATH_UTF8_SIZE];
+
+    for (size_t i = 0; i < count; i++) {
+        ModuleIdentity *module = &modules[i];
+        size_t bytes = Utf16ToUtf8((const uint16_t *)module->path, module->pathLength, (uint8_t *)module->pathUtf8);
+        module->pathUtf8[bytes] = '\0';
+        module->identified = false;
+        module->cached = false;
+        if (!StatModuleImage(module)) continue;
+
+        LowercasePath(module->pathUtf8, loweredPath, sizeof(loweredPath));
+        const ModuleCacheEntry *entry = cache ? FindCacheEntry(cache, loweredPath) : NULL;
+        if (entry && entry->fileSize == module->fileSize && entry->lastWriteTime == module->lastWriteTime &&
+            entry->volumeSerial == module->volumeSerial && entry->fileIndex == module->fileIndex) {
+            memcpy(module->sha256, entry->sha256, SHA256_DIGEST_SIZE);
+            module->fastHash = entry->fastHash;
+            module->identified = true;
+            module->cached = true;
+            hits++;
+        } else {
+            pending[pendingCount++] = module;
+        }
+    }
+
+    uint64_t bytesHashed = pendingCount ? HashPendingModules(pending, pendingCount) : 0;
+
+    if (cache) {
+        for (size_t i = 0; i < pendingCount; i++) {
+            const ModuleIdentity *module = pending[i];
+            if (!module->identified) continue;
+            ModuleCacheEntry record;
+            LowercasePath(module->pathUtf8, loweredPath, sizeof(loweredPath));
+            record.path = loweredPath;
+            record.fileSize = module->fileSize;
+            record.lastWriteTime = module->lastWriteTime;
+            record.volumeSerial = module->volumeSerial;
+            record.fileIndex = module->fileIndex;
+            memcpy(record.sha256, module->sha256, SHA256_DIGEST_SIZE);
+            record.fastHash = module->fastHash;
+            if (StoreCacheEntry(cache, &record) && cache->file) WriteCacheRecord(cache->file, &record);
+        }
+        if (cache->file) fflush(cache->file);
+        cache->hits += hits;
+        cache->misses += pendingCount;
+        cache->bytesHashed += bytesHashed;
+    }
+
+    AddMetricCounter("module_cache_hits", hits);
+    AddMetricCounter("module_cache_misses", pendingCount);
+    AddMetricCounter("module_bytes_hashed", bytesHashed);
+    free(pending);
+}
+
+// Function to write one module record: path, SHA-256, XXH64 and size, tab-separated ("-" when unreadable)
+void WriteModuleIdentity(FILE *file, const ModuleIdentity *module) {
+    fputs(module->pathUtf8, file);
+    if (module->identified) {
+        char shaHex[SHA256_HEX_SIZE];
+        DigestToHex(module->sha256, SHA256_DIGEST_SIZE, shaHex);
+        fprintf(file, "\t%s\t%016llx\t%llu\r\n", shaHex, (unsigned long long)module->fastHash,
+                (unsigned long long)module->fileSize);
+    } else {
+        fputs("\t-\t-\t-\r\n", file);
+    }
+}
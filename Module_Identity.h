@@ -0,0 +1,65 @@
+#ifndef MODULE_IDENTITY_H
+#define MODULE_IDENTITY_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+#include "Content_Hash.h"
+#include "Text_Encoding.h"
+
+#define MODULE_IDENTITY_CACHE_FILE _T("module_identity.cache")
+#define MODULE_IDENTITY_HEADER "MODULE_IDENTITY 1"
+#define MODULE_PATH_UTF8_SIZE (MAX_PATH * UTF8_MAX_PER_UTF16 + 1)
+#define MODULE_HASH_READ_SIZE (1024 * 1024)    // Bytes read per lane per step; a multiple of the SHA-256 block
+#define MODULE_HASH_MAX_THREADS 8
+
+// One module image; the caller fills path and pathLength, IdentifyModules fills the rest
+typedef struct {
+    WCHAR path[MAX_PATH];
+    size_t pathLength;
+    char pathUtf8[MODULE_PATH_UTF8_SIZE];
+    uint64_t fileSize;
+    uint64_t lastWriteTime;             // FILETIME
+    uint32_t volumeSerial;
+    uint64_t fileIndex;                 // With volumeSerial, identifies the file across renames
+    uint8_t sha256[SHA256_DIGEST_SIZE];
+    uint64_t fastHash;                  // XXH64, seed 0
+    bool identified;                    // False when the image could not be opened or read
+    bool cached;                        // Hashes came from the cache
+} ModuleIdentity;
+
+// Cached hashes of one image file at one (size, write time, file ID)
+typedef struct {
+    char *path;
+    uint64_t fileSize;
+    uint64_t lastWriteTime;
+    uint32_t volumeSerial;
+    uint64_t fileIndex;
+    uint8_t sha256[SHA256_DIGEST_SIZE];
+    uint64_t fastHash;
+} ModuleCacheEntry;
+
+// Persistent (path, size, write time, file ID) -> hashes map, appended to as images are hashed.
+// Used by one thread at a time; the hashing threads never touch it.
+typedef struct {
+    TCHAR fileName[MAX_PATH];
+    FILE *file;
+    ModuleCacheEntry *entries;
+    size_t entryCount;
+    size_t entryCapacity;
+    uint32_t *slots;                    // Open-addressing table of entry index + 1 (0 = empty), keyed by path
+    size_t slotCount;
+    size_t staleRecords;                // Superseded records in the file, dropped by the next compaction
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bytesHashed;
+} ModuleIdentityCache;
+
+bool OpenModuleIdentityCache(ModuleIdentityCache *cache, const TCHAR *fileName);
+void CloseModuleIdentityCache(ModuleIdentityCache *cache);
+void IdentifyModules(ModuleIdentityCache *cache, ModuleIdentity *modules, size_t count);
+void WriteModuleIdentity(FILE *file, const ModuleIdentity *module);
+
+#endif
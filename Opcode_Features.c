@@ -0,0 +1,361 @@
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Opcode_Features.h"
+
+// Operand layout codes for the opcode tables
+#define OP_NONE     '.'     // No ModRM, no immediate
+#define OP_MODRM    'm'     // ModRM
+#define OP_IMM8     'b'     // imm8 or rel8
+#define OP_IMMZ     'z'     // imm16/32 by operand size
+#define OP_MODRM8   'M'     // ModRM + imm8
+#define OP_MODRMZ   'Z'     // ModRM + imm16/32
+#define OP_IMM16    'w'     // imm16
+#define OP_REL32    'r'     // rel32
+#define OP_MOFFS    'a'     // 64-bit absolute address, 32-bit with 0x67
+#define OP_ENTER    'e'     // imm16 + imm8
+#define OP_MOVIMM   'o'     // imm32, imm64 with REX.W
+#define OP_GROUP3   'g'     // ModRM, immediate only for TEST (reg 0 and 1)
+#define OP_PREFIX   'p'     // Prefix or escape, handled by the decoder
+#define OP_INVALID  'x'     // Not valid in 64-bit mode
+
+// One-byte opcode map in 64-bit mode, sixteen opcodes per row
+static const char oneByteMap[257] =
+    "mmmmbzxxmmmmbzxp"      // 00
+    "mmmmbzxxmmmmbzxx"      // 10
+    "mmmmbzpxmmmmbzpx"      // 20
+    "mmmmbzpxmmmmbzpx"      // 30
+    "pppppppppppppppp"      // 40 REX
+    "................"      // 50
+    "xxpmppppzZbM...."      // 60
+    "bbbbbbbbbbbbbbbb"      // 70
+    "MZxMmmmmmmmmmmmm"      // 80
+    "..........x....."      // 90
+    "aaaa....bz......"      // A0
+    "bbbbbbbboooooooo"      // B0
+    "MMw.ppMZe.w..bx."      // C0
+    "mmmmxxx.mmmmmmmm"      // D0
+    "bbbbbbbbrrxb...."      // E0
+    "p.pp..gg......mm";     // F0
+
+// Two-byte (0F) opcode map
+static const char twoByteMap[257] =
+    "mmmmx.....x.xm.M"      // 00
+    "mmmmmmmmmmmmmmmm"      // 10
+    "mmmmxxxxmmmmmmmm"      // 20
+    "......x.pxpxxxxx"      // 30
+    "mmmmmmmmmmmmmmmm"      // 40
+    "mmmmmmmmmmmmmmmm"      // 50
+    "mmmmmmmmmmmmmmmm"      // 60
+    "MMMMmmm.mmxxmmmm"      // 70
+    "rrrrrrrrrrrrrrrr"      // 80
+    "mmmmmmmmmmmmmmmm"      // 90
+    "...mMmxx...mMmmm"      // A0
+    "mmmmmmmmmmMmmmmm"      // B0
+    "mmMmMMMm........"      // C0
+    "mmmmmmmmmmmmmmmm"      // D0
+    "mmmmmmmmmmmmmmmm"      // E0
+    "mmmmmmmmmmmmmmmm";     // F0
+
+// Function to measure ModRM, SIB and displacement; returns 0 when the bytes run out
+static size_t ModRmLength(const uint8_t *p, size_t available) {
+    if (available < 1) return 0;
+    uint8_t mod = p[0] >> 6;
+    uint8_t rm = p[0] & 7;
+    size_t length = 1;
+
+    if (mod == 3) return 1;
+    if (rm == 4) {
+        if (available < 2) return 0;
+        length = 2;
+        if (mod == 0 && (p[1] & 7) == 5) length += 4;
+    } else if (mod == 0 && rm == 5) {
+        length += 4;                // RIP-relative
+    }
+    if (mod == 1) length += 1;
+    else if (mod == 2) length += 4;
+    return length <= available ? length : 0;
+}
+
+// Function to decode the length of one x86-64 instruction and its opcode key.
+// Returns 0 when the instruction continues past the available bytes; undecodable bytes
+// are reported as a one-byte instruction with OPCODE_KEY_INVALID so the sweep resynchronises.
+size_t DecodeInstruction(const uint8_t *code, size_t available, uint16_t *opcodeKey) {
+    size_t limit = available < OPCODE_MAX_LENGTH ? available : OPCODE_MAX_LENGTH;
+    size_t i = 0;
+    bool operandSize16 = false;
+    bool addressSize32 = false;
+    bool rexW = false;
+
+    // Legacy prefixes, then at most one REX immediately before the opcode
+    for (;;) {
+        if (i >= limit) goto truncated;
+        uint8_t b = code[i];
+        if (b == 0x66) operandSize16 = true;
+        else if (b == 0x67) addressSize32 = true;
+        else if (b != 0xF0 && b != 0xF2 && b != 0xF3 && b != 0x2E && b != 0x36 &&
+                 b != 0x3E && b != 0x26 && b != 0x64 && b != 0x65) break;
+        i++;
+    }
+    if ((code[i] & 0xF0) == 0x40) {
+        rexW = (code[i] & 0x08) != 0;
+        i++;
+        if (i >= limit) goto truncated;
+    }
+
+    uint8_t opcode = code[i];
+    size_t immediate = 0;
+    size_t immz = operandSize16 ? 2 : 4;
+
+    // VEX (C4/C5) and EVEX (62) are always vector prefixes in 64-bit mode
+    if (opcode == 0xC4 || opcode == 0xC5 || opcode == 0x62) {
+        size_t payload = opcode == 0xC5 ? 1 : (opcode == 0xC4 ? 2 : 3);
+        if (i + payload + 1 >= limit) goto truncated;
+        unsigned map = opcode == 0xC5 ? 1 : (code[i + 1] & (opcode == 0xC4 ? 0x1F : 0x07));
+        uint8_t vectorOpcode = code[i + payload + 1];
+        if (map < 1 || map > 3 || (opcode == 0x62 && (code[i + 2] & 0x04) == 0)) goto invalid;
+        i += payload + 2;
+
+        if (!(map == 1 && vectorOpcode == 0x77)) {          // VZEROUPPER/VZEROALL have no ModRM
+            size_t modRm = ModRmLength(code + i, limit - i);
+            if (modRm == 0) goto truncated;
+            i += modRm;
+        }
+        if (map == 3 || (map == 1 && twoByteMap[vectorOpcode] == OP_MODRM8)) immediate = 1;
+        if (i + immediate > limit) goto truncated;
+
+        *opcodeKey = (uint16_t)((opcode == 0x62 ? OPCODE_KEY_EVEX : OPCODE_KEY_VEX) + (map - 1) * OPCODE_MAP_SIZE + vectorOpcode);
+        return i + immediate;
+    }
+
+    char layout = oneByteMap[opcode];
+    unsigned key = opcode;
+    i++;
+
+    if (opcode == 0x0F) {
+        if (i >= limit) goto truncated;
+        uint8_t second = code[i++];
+        if (second == 0x38 || second == 0x3A) {
+            if (i >= limit) goto truncated;
+            key = (second == 0x38 ? 2 : 3) * OPCODE_MAP_SIZE + code[i++];
+            layout = second == 0x38 ? OP_MODRM : OP_MODRM8;
+        } else {
+            key = OPCODE_MAP_SIZE + second;
+            layout = twoByteMap[second];
+        }
+    }
+
+    switch (layout) {
+    case OP_NONE:                                       break;
+    case OP_IMM8:    immediate = 1;                     break;
+    case OP_IMMZ:    immediate = immz;                  break;
+    case OP_IMM16:   immediate = 2;                     break;
+    case OP_REL32:   immediate = 4;                     break;
+    case OP_ENTER:   immediate = 3;                     break;
+    case OP_MOFFS:   immediate = addressSize32 ? 4 : 8; break;
+    case OP_MOVIMM:  immediate = rexW ? 8 : immz;       break;
+    case OP_MODRM:
+    case OP_MODRM8:
+    case OP_MODRMZ:
+    case OP_GROUP3: {
+        if (i >= limit) goto truncated;
+        uint8_t reg = (code[i] >> 3) & 7;
+        size_t modRm = ModRmLength(code + i, limit - i);
+        if (modRm == 0) goto truncated;
+        i += modRm;
+        if (layout == OP_MODRM8) immediate = 1;
+        else if (layout == OP_MODRMZ) immediate = immz;
+        else if (layout == OP_GROUP3 && reg < 2) immediate = opcode == 0xF6 ? 1 : immz;
+        break;
+    }
+    default:
+        goto invalid;                                   // OP_INVALID, or a prefix where an opcode belongs
+    }
+
+    if (i + immediate > limit) goto truncated;
+    *opcodeKey = (uint16_t)key;
+    return i + immediate;
+
+truncated:
+    // Running out of bytes only matters when more may follow; a 15-byte window is simply invalid
+    if (available < OPCODE_MAX_LENGTH) return 0;
+invalid:
+    *opcodeKey = OPCODE_KEY_INVALID;
+    return 1;
+}
+
+// Function to name an opcode key for feature output, e.g. "0f05", "v1_58", "e2_a8"
+void FormatOpcodeKey(uint16_t opcodeKey, char *name, size_t nameSize) {
+    static const char *legacyPrefixes[] = { "", "0f", "0f38", "0f3a" };
+    unsigned low = opcodeKey % OPCODE_MAP_SIZE;
+
+    if (opcodeKey >= OPCODE_KEY_INVALID) {
+        snprintf(name, nameSize, "invalid");
+    } else if (opcodeKey >= OPCODE_KEY_EVEX) {
+        snprintf(name, nameSize, "e%u_%02x", (opcodeKey - OPCODE_KEY_EVEX) / OPCODE_MAP_SIZE + 1, low);
+    } else if (opcodeKey >= OPCODE_KEY_VEX) {
+        snprintf(name, nameSize, "v%u_%02x", (opcodeKey - OPCODE_KEY_VEX) / OPCODE_MAP_SIZE + 1, low);
+    } else {
+        snprintf(name, nameSize, "%s%02x", legacyPrefixes[opcodeKey / OPCODE_MAP_SIZE], low);
+    }
+}
+
+static uint32_t NgramBucket(uint32_t a, uint32_t b, uint32_t c) {
+    uint32_t h = (a * OPCODE_KEY_COUNT + b) * OPCODE_KEY_COUNT + c;
+    h *= 0x9E3779B1u;
+    return (h ^ (h >> 15)) & (OPCODE_NGRAM_BUCKETS - 1);
+}
+
+static void RecordOpcode(OpcodeFeatureWriter *writer, uint16_t key) {
+    OpcodeHistogram *region = &writer->region;
+    region->instructions++;
+    region->unigrams[key]++;
+    if (writer->historyLength >= 1) {
+        region->bigrams[NgramBucket(0, writer->history[1], key)]++;
+    }
+    if (writer->historyLength >= 2) {
+        region->trigrams[NgramBucket(writer->history[0] + 1, writer->history[1], key)]++;
+    }
+    writer->history[0] = writer->history[1];
+    writer->history[1] = key;
+    if (writer->historyLength < 2) writer->historyLength++;
+}
+
+bool BeginOpcodeFeatures(OpcodeFeatureWriter *writer, const TCHAR *regionFileName) {
+    memset(writer, 0, sizeof(*writer));
+    writer->regionFile = _tfopen(regionFileName, _T("w"));
+    if (!writer->regionFile) return false;
+    fprintf(writer->regionFile, "# region base size protect type module instructions invalid; "
+                                "then sparse 'uni', 'bi' and 'tri' lines of index:count\n");
+    return true;
+}
+
+void BeginOpcodeRegion(OpcodeFeatureWriter *writer, uint64_t baseAddress, uint64_t regionSize, uint32_t protect, uint32_t type, const char *moduleName) {
+    if (writer->regionOpen) EndOpcodeRegion(writer);
+    memset(&writer->region, 0, sizeof(writer->region));
+    writer->regionBase = baseAddress;
+    writer->regionSize = regionSize;
+    writer->regionProtect = protect;
+    writer->regionType = type;
+    snprintf(writer->moduleName, sizeof(writer->moduleName), "%s", (moduleName && moduleName[0]) ? moduleName : "-");
+    writer->historyLength = 0;
+    writer->carrySize = 0;
+    writer->regionOpen = true;
+}
+
+// Function to sweep region bytes; an instruction split across calls is joined through the carry buffer
+void AppendOpcodeData(OpcodeFeatureWriter *writer, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    size_t offset = 0;
+    uint16_t key;
+
+    writer->region.bytes += size;
+
+    if (writer->carrySize > 0) {
+        uint8_t joined[3 * OPCODE_MAX_LENGTH];
+        size_t take = sizeof(joined) - writer->carrySize;
+        if (take > size) take = size;
+        memcpy(joined, writer->carry, writer->carrySize);
+        memcpy(joined + writer->carrySize, bytes, take);
+        size_t joinedSize = writer->carrySize + take;
+
+        size_t position = 0;
+        while (position < writer->carrySize) {
+            size_t length = DecodeInstruction(joined + position, joinedSize - position, &key);
+            if (length == 0) {
+                // Still incomplete: everything appended so far stays in the carry
+                writer->carrySize = joinedSize - position;
+                memmove(writer->carry, joined + position, writer->carrySize);
+                return;
+            }
+            RecordOpcode(writer, key);
+            position += length;
+        }
+        offset = position - writer->carrySize;
+        writer->carrySize = 0;
+    }
+
+    while (offset < size) {
+        size_t length = DecodeInstruction(bytes + offset, size - offset, &key);
+        if (length == 0) {
+            writer->carrySize = size - offset;
+            memcpy(writer->carry, bytes + offset, writer->carrySize);
+            break;
+        }
+        RecordOpcode(writer, key);
+        offset += length;
+    }
+}
+
+static void WriteSparseCounts(FILE *file, const char *label, const uint32_t *counts, size_t count) {
+    fputs(label, file);
+    for (size_t i = 0; i < count; i++) {
+        if (counts[i]) fprintf(file, " %u:%u", (unsigned)i, counts[i]);
+    }
+    fputc('\n', file);
+}
+
+void EndOpcodeRegion(OpcodeFeatureWriter *writer) {
+    if (!writer->regionOpen) return;
+    OpcodeHistogram *region = &writer->region;
+    OpcodeHistogram *total = &writer->total;
+
+    // Bytes cut off at the end of the region cannot form an instruction
+    if (writer->carrySize > 0) {
+        RecordOpcode(writer, OPCODE_KEY_INVALID);
+        writer->carrySize = 0;
+    }
+
+    fprintf(writer->regionFile, "region %016llx %016llx %08x %08x %s %llu %u\n",
+            (unsigned long long)writer->regionBase, (unsigned long long)writer->regionSize,
+            writer->regionProtect, writer->regionType, writer->moduleName,
+            (unsigned long long)region->instructions, region->unigrams[OPCODE_KEY_INVALID]);
+    WriteSparseCounts(writer->regionFile, "uni", region->unigrams, OPCODE_KEY_COUNT);
+    WriteSparseCounts(writer->regionFile, "bi", region->bigrams, OPCODE_NGRAM_BUCKETS);
+    WriteSparseCounts(writer->regionFile, "tri", region->trigrams, OPCODE_NGRAM_BUCKETS);
+
+    total->bytes += region->bytes;
+    total->instructions += region->instructions;
+    for (size_t i = 0; i < OPCODE_KEY_COUNT; i++) {
+        total->unigrams[i] += region->unigrams[i];
+    }
+    for (size_t i = 0; i < OPCODE_NGRAM_BUCKETS; i++) {
+        total->bigrams[i] += region->bigrams[i];
+        total->trigrams[i] += region->trigrams[i];
+    }
+    writer->regionOpen = false;
+}
+
+void EndOpcodeFeatures(OpcodeFeatureWriter *writer) {
+    if (writer->regionOpen) EndOpcodeRegion(writer);
+    if (writer->regionFile) {
+        fclose(writer->regionFile);
+        writer->regionFile = NULL;
+    }
+}
+
+// Function to write process-wide opcode frequencies as sparse "name value" lines for the classifier
+bool WriteOpcodeFeatures(const OpcodeHistogram *total, const TCHAR *featuresFileName) {
+    FILE *featuresFile = _tfopen(featuresFileName, _T("w"));
+    if (!featuresFile) return false;
+
+    double instructions = total->instructions ? (double)total->instructions : 1.0;
+    char name[32];
+
+    fprintf(featuresFile, "op_exec_bytes %llu\n", (unsigned long long)total->bytes);
+    fprintf(featuresFile, "op_instructions %llu\n", (unsigned long long)total->instructions);
+    for (uint16_t key = 0; key < OPCODE_KEY_COUNT; key++) {
+        if (!total->unigrams[key]) continue;
+        FormatOpcodeKey(key, name, sizeof(name));
+        fprintf(featuresFile, "op_%s %.6f\n", name, total->unigrams[key] / instructions);
+    }
+    for (int i = 0; i < OPCODE_NGRAM_BUCKETS; i++) {
+        if (total->bigrams[i]) fprintf(featuresFile, "op2_%d %.6f\n", i, total->bigrams[i] / instructions);
+    }
+    for (int i = 0; i < OPCODE_NGRAM_BUCKETS; i++) {
+        if (total->trigrams[i]) fprintf(featuresFile, "op3_%d %.6f\n", i, total->trigrams[i] / instructions);
+    }
+
+    fclose(featuresFile);
+    return true;
+}
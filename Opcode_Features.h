@@ -0,0 +1,54 @@
+#ifndef OPCODE_FEATURES_H
+#define OPCODE_FEATURES_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+
+// Opcode keys: legacy maps (one-byte, 0F, 0F38, 0F3A), VEX maps 1-3, EVEX maps 1-3, then invalid
+#define OPCODE_MAP_SIZE 256
+#define OPCODE_KEY_VEX (4 * OPCODE_MAP_SIZE)
+#define OPCODE_KEY_EVEX (7 * OPCODE_MAP_SIZE)
+#define OPCODE_KEY_INVALID (10 * OPCODE_MAP_SIZE)
+#define OPCODE_KEY_COUNT (OPCODE_KEY_INVALID + 1)
+#define OPCODE_NGRAM_BUCKETS 4096   // Hashed bigram and trigram features
+#define OPCODE_MAX_LENGTH 15
+#define OPCODE_MODULE_NAME_SIZE 260
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t instructions;
+    uint32_t unigrams[OPCODE_KEY_COUNT];
+    uint32_t bigrams[OPCODE_NGRAM_BUCKETS];
+    uint32_t trigrams[OPCODE_NGRAM_BUCKETS];
+} OpcodeHistogram;
+
+// Linear-sweep decoder over executable regions; writes sparse per-region vectors and a process summary
+typedef struct {
+    FILE *regionFile;
+    OpcodeHistogram region;
+    OpcodeHistogram total;
+    uint64_t regionBase;
+    uint64_t regionSize;
+    uint32_t regionProtect;
+    uint32_t regionType;
+    char moduleName[OPCODE_MODULE_NAME_SIZE];
+    uint16_t history[2];
+    int historyLength;
+    uint8_t carry[2 * OPCODE_MAX_LENGTH];   // Instruction bytes split across appends
+    size_t carrySize;
+    bool regionOpen;
+} OpcodeFeatureWriter;
+
+size_t DecodeInstruction(const uint8_t *code, size_t available, uint16_t *opcodeKey);
+void FormatOpcodeKey(uint16_t opcodeKey, char *name, size_t nameSize);
+
+bool BeginOpcodeFeatures(OpcodeFeatureWriter *writer, const TCHAR *regionFileName);
+void BeginOpcodeRegion(OpcodeFeatureWriter *writer, uint64_t baseAddress, uint64_t regionSize, uint32_t protect, uint32_t type, const char *moduleName);
+void AppendOpcodeData(OpcodeFeatureWriter *writer, const void *data, size_t size);
+void EndOpcodeRegion(OpcodeFeatureWriter *writer);
+void EndOpcodeFeatures(OpcodeFeatureWriter *writer);
+bool WriteOpcodeFeatures(const OpcodeHistogram *total, const TCHAR *featuresFileName);
+
+#endif
@@ -7,6 +7,9 @@
 #include <sddl.h>
 #include <aclapi.h>
 #include <time.h>
+#include "Text_Encoding.h"
+#include "Sweep_Journal.h"
+#include "Sweep_Metrics.h"
 
 #pragma comment(lib, "psapi.lib")
 #pragma comment(lib, "shlwapi.lib")
@@ -26,8 +29,9 @@ void LogErrorAndExit(const TCHAR *message);
 void LogError(const TCHAR *message, DWORD pid, const TCHAR *processFolder);
 void LogDebug(const TCHAR *message, DWORD pid, const TCHAR *processFolder);
 void LogSummary(const TCHAR *message);
-bool GetAllProcessIDs(DWORD *processIDs, DWORD arraySize, DWORD *bytesReturned);
+bool GetAllProcessIDs(DWORD **processIDs, DWORD *processCount);
 bool GetProcessNameByPID(DWORD pid, TCHAR *processName, DWORD processNameSize);
+uint64_t GetProcessCreationTime(DWORD pid);
 void CreateDirectoryIfNotExists(LPCTSTR path);
 HWND FindWinDbgWindow(void);
 void CaptureWinDbgText(HWND hwnd, const TCHAR *outputFileName);
@@ -78,14 +82,33 @@ void LogSummary(const TCHAR *message) {
     _tprintf(_T("SUMMARY: %s\n"), message);
 }
 
-// Function to retrieve all running process IDs
-bool GetAllProcessIDs(DWORD *processIDs, DWORD arraySize, DWORD *bytesReturned) {
-    if (!EnumProcesses(processIDs, arraySize, bytesReturned)) {
-        LogError(_T("EnumProcesses failed"), 0, _T("."));
-        return false;
+// Function to retrieve all running process IDs; the caller frees the list
+bool GetAllProcessIDs(DWORD **processIDs, DWORD *processCount) {
+    // EnumProcesses cannot report the size it needs: grow until the list no longer fills the buffer
+    DWORD capacity = 1024;
+    DWORD bytesReturned = 0;
+    *processIDs = NULL;
+    while (true) {
+        DWORD *grown = (DWORD *)realloc(*processIDs, capacity * sizeof(DWORD));
+        if (!grown) {
+            LogError(_T("Failed to allocate the process list"), 0, _T("."));
+            break;
+        }
+        *processIDs = grown;
+        if (!EnumProcesses(*processIDs, capacity * sizeof(DWORD), &bytesReturned)) {
+            LogError(_T("EnumProcesses failed"), 0, _T("."));
+            break;
+        }
+        if (bytesReturned < capacity * sizeof(DWORD)) {
+            *processCount = bytesReturned / sizeof(DWORD);
+            LogDebug(_T("Retrieved all process IDs."), 0, _T("."));
+            return true;
+        }
+        capacity *= 2;
     }
-    LogDebug(_T("Retrieved all process IDs."), 0, _T("."));
-    return true;
+    free(*processIDs);
+    *processIDs = NULL;
+    return false;
 }
 
 // Function to get process name by PID
@@ -108,6 +131,20 @@ bool GetProcessNameByPID(DWORD pid, TCHAR *processName, DWORD processNameSize) {
     return true;
 }
 
+// Function to get a process's creation time; with the PID it identifies the process across PID reuse
+uint64_t GetProcessCreationTime(DWORD pid) {
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    uint64_t result = 0;
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (hProcess) {
+        if (GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime)) {
+            result = ((uint64_t)creationTime.dwHighDateTime << 32) | creationTime.dwLowDateTime;
+        }
+        CloseHandle(hProcess);
+    }
+    return result;
+}
+
 // Function to create a directory if it doesn't exist
 void CreateDirectoryIfNotExists(LPCTSTR path) {
     if (!CreateDirectory(path, NULL)) {
@@ -178,13 +215,15 @@ void MoveCursorAndCopy(HWND hwnd) {
 // Function to save the clipboard text to a file
 void SaveClipboardTextToFile(const TCHAR *outputFileName) {
     if (OpenClipboard(NULL)) {
-        HANDLE hClipboardData = GetClipboardData(CF_TEXT);
+        HANDLE hClipboardData = GetClipboardData(CF_UNICODETEXT);
         if (hClipboardData) {
-            char *pchData = (char*)GlobalLock(hClipboardData);
+            WCHAR *pchData = (WCHAR*)GlobalLock(hClipboardData);
             if (pchData) {
-                FILE *outputFile = _tfopen(outputFileName, _T("w"));
+                FILE *outputFile = _tfopen(outputFileName, _T("wb"));
                 if (outputFile) {
-                    _ftprintf(outputFile, _T("%hs"), pchData);
+                    // Transcripts are always written as UTF-8
+                    WriteUtf16AsUtf8(outputFile, (const uint16_t*)pchData, wcslen(pchData));
+                    AddMetricCounter("bytes_captured", (uint64_t)_ftelli64(outputFile));
                     fclose(outputFile);
                 }
                 GlobalUnlock(hClipboardData);
@@ -223,7 +262,7 @@ void TerminateWinDbgProcess(DWORD pid) {
     }
 }
 
-// Function to run WinDbg with a script and capture its output
+// Function to run WinDbg with a script and capture its output; false if it could not attach
 bool RunWinDbg(LPCTSTR windbgPath, DWORD pid, LPCTSTR commandsScriptPath, LPCTSTR outputFileName, const TCHAR *processFolder) {
     TCHAR commandLine[BUFFER_SIZE];
     STARTUPINFO si;
@@ -259,6 +298,7 @@ bool RunWinDbg(LPCTSTR windbgPath, DWORD pid, LPCTSTR commandsScriptPath, LPCTST
     ZeroMemory(&pi, sizeof(pi));
 
     // Create WinDbg process
+    MetricTimer debuggerTimer = BeginMetricTimer();
     if (!CreateProcess(NULL, commandLine, NULL, NULL, TRUE, CREATE_NO_WINDOW | DETACHED_PROCESS, NULL, NULL, &si, &pi)) {
         LogError(_T("CreateProcess failed"), pid, processFolder);
         CloseHandle(hOutputFile);
@@ -269,10 +309,15 @@ bool RunWinDbg(LPCTSTR windbgPath, DWORD pid, LPCTSTR commandsScriptPath, LPCTST
 
     // Wait for the WinDbg process to finish or timeout
     DWORD waitResult = WaitForSingleObject(pi.hProcess, WINDBG_TIMEOUT_MS);
+
+    // WinDbg puts up an error dialog when it cannot attach; look for it before the debugger is closed
+    bool attachFailed = FindWindow(NULL, _T("Error")) != NULL;
     if (waitResult == WAIT_TIMEOUT) {
         LogDebug(_T("WinDbg process timed out, terminating."), pid, processFolder);
+        AddMetricCounter("windbg_timeouts", 1);
         TerminateProcess(pi.hProcess, 0);
     }
+    EndMetricTimer(debuggerTimer, "debugger_run");
 
     // Check the exit code of the WinDbg process
     DWORD exitCode;
@@ -280,6 +325,13 @@ bool RunWinDbg(LPCTSTR windbgPath, DWORD pid, LPCTSTR commandsScriptPath, LPCTST
         LogDebug(_T("WinDbg process still active, terminating."), pid, processFolder);
         TerminateProcess(pi.hProcess, 0);
     }
+    if (attachFailed) {
+        LogError(_T("WinDbg could not attach"), pid, processFolder);
+        CloseHandle(pi.hProcess);
+        CloseHandle(pi.hThread);
+        CloseHandle(hOutputFile);
+        return false;
+    }
 
     // Ensure the WinDbg window is in the foreground
     HWND hwnd = FindWinDbgWindow();
@@ -288,11 +340,15 @@ bool RunWinDbg(LPCTSTR windbgPath, DWORD pid, LPCTSTR commandsScriptPath, LPCTST
         Sleep(1000);  // Wait for the window to be in the foreground
 
         // Move the cursor, select all text, and copy it
+        MetricTimer copyTimer = BeginMetricTimer();
         MoveCursorAndCopy(hwnd);
         Sleep(1000);  // Wait for the copy operation
+        EndMetricTimer(copyTimer, "copy_ui");
 
         // Save the copied text from the clipboard to a file
+        MetricTimer saveTimer = BeginMetricTimer();
         SaveClipboardTextToFile(outputFileName);
+        EndMetricTimer(saveTimer, "clipboard_save");
     } else {
         LogError(_T("Failed to find WinDbg window"), pid, processFolder);
     }
@@ -377,33 +433,33 @@ bool IsRunAsAdmin() {
 void CreateWinDbgCommandsScript() {
     FILE *commandsFile = _tfopen(COMMANDS_SCRIPT_PATH, _T("w"));
     if (commandsFile) {
-        _ftprintf(commandsFile, _T(".echo === Processor Information ===\n!cpuinfo\n"));
-        _ftprintf(commandsFile, _T(".echo === System Information ===\nvertarget\n"));
-        _ftprintf(commandsFile, _T(".echo === Register States ===\nr\n"));
-        _ftprintf(commandsFile, _T(".echo === Disassemble Code (EIP) for 32-bit ===\nu eip\n"));
-        _ftprintf(commandsFile, _T(".echo === Disassemble Code (RIP) for 64-bit ===\nu rip\n"));
-        _ftprintf(commandsFile, _T(".echo === Memory Information ===\n!address -summary\n"));
-        _ftprintf(commandsFile, _T(".echo === Virtual Memory Layout ===\n!vm\n"));
-        _ftprintf(commandsFile, _T(".echo === Loaded Modules ===\nlm\n"));
-        _ftprintf(commandsFile, _T(".echo === Dump Memory Contents (EIP) for 32-bit ===\ndd eip\n"));
-        _ftprintf(commandsFile, _T(".echo === Dump Memory Contents (RIP) for 64-bit ===\ndd rip\n"));
-        _ftprintf(commandsFile, _T(".echo === List Threads ===\n~*\n"));
-        _ftprintf(commandsFile, _T(".echo === Thread Information ===\n!thread\n"));
-        _ftprintf(commandsFile, _T(".echo === Stack Traces ===\nkp\n"));
-        _ftprintf(commandsFile, _T(".echo === Kernel Structures ===\n!process 0 0\n!session\n"));
-        _ftprintf(commandsFile, _T(".echo === Handle Table ===\n!handle 0 0\n"));
-        _ftprintf(commandsFile, _T(".echo === Object Information ===\n!object\n"));
-        _ftprintf(commandsFile, _T(".echo === Page Table Entries ===\n!pte\n"));
-        _ftprintf(commandsFile, _T(".echo === Kernel Memory Information ===\n!memusage\n"));
-        _ftprintf(commandsFile, _T(".echo === Kernel Debugging Structures ===\n!kd\n"));
-        _ftprintf(commandsFile, _T(".echo === Kernel Modules ===\n!lm\n"));
-        _ftprintf(commandsFile, _T(".echo === Loaded Drivers ===\nlm t n\n"));
-        _ftprintf(commandsFile, _T(".echo === Dump Driver Object ===\n!object \\Driver\\\n"));
-        _ftprintf(commandsFile, _T(".echo === Loaded Images ===\n!imgscan\n"));
-        _ftprintf(commandsFile, _T(".echo === Loaded Paged Pools ===\n!poolused /t\n"));
-        _ftprintf(commandsFile, _T(".echo === Heap Summary ===\n!heap -s\n"));
-        _ftprintf(commandsFile, _T(".echo === Memory Information (Full) ===\n!memusage 7\n"));
-        _ftprintf(commandsFile, _T(".echo === Quitting ===\n.quit\n"));
+        _ftprintf(commandsFile, _T(".echo === Processor Information ===\n.echotime\n!cpuinfo\n"));
+        _ftprintf(commandsFile, _T(".echo === System Information ===\n.echotime\nvertarget\n"));
+        _ftprintf(commandsFile, _T(".echo === Register States ===\n.echotime\nr\n"));
+        _ftprintf(commandsFile, _T(".echo === Disassemble Code (EIP) for 32-bit ===\n.echotime\nu eip\n"));
+        _ftprintf(commandsFile, _T(".echo === Disassemble Code (RIP) for 64-bit ===\n.echotime\nu rip\n"));
+        _ftprintf(commandsFile, _T(".echo === Memory Information ===\n.echotime\n!address -summary\n"));
+        _ftprintf(commandsFile, _T(".echo === Virtual Memory Layout ===\n.echotime\n!vm\n"));
+        _ftprintf(commandsFile, _T(".echo === Loaded Modules ===\n.echotime\nlm\n"));
+        _ftprintf(commandsFile, _T(".echo === Dump Memory Contents (EIP) for 32-bit ===\n.echotime\ndd eip\n"));
+        _ftprintf(commandsFile, _T(".echo === Dump Memory Contents (RIP) for 64-bit ===\n.echotime\ndd rip\n"));
+        _ftprintf(commandsFile, _T(".echo === List Threads ===\n.echotime\n~*\n"));
+        _ftprintf(commandsFile, _T(".echo === Thread Information ===\n.echotime\n!thread\n"));
+        _ftprintf(commandsFile, _T(".echo === Stack Traces ===\n.echotime\nkp\n"));
+        _ftprintf(commandsFile, _T(".echo === Kernel Structures ===\n.echotime\n!process 0 0\n!session\n"));
+        _ftprintf(commandsFile, _T(".echo === Handle Table ===\n.echotime\n!handle 0 0\n"));
+        _ftprintf(commandsFile, _T(".echo === Object Information ===\n.echotime\n!object\n"));
+        _ftprintf(commandsFile, _T(".echo === Page Table Entries ===\n.echotime\n!pte\n"));
+        _ftprintf(commandsFile, _T(".echo === Kernel Memory Information ===\n.echotime\n!memusage\n"));
+        _ftprintf(commandsFile, _T(".echo === Kernel Debugging Structures ===\n.echotime\n!kd\n"));
+        _ftprintf(commandsFile, _T(".echo === Kernel Modules ===\n.echotime\n!lm\n"));
+        _ftprintf(commandsFile, _T(".echo === Loaded Drivers ===\n.echotime\nlm t n\n"));
+        _ftprintf(commandsFile, _T(".echo === Dump Driver Object ===\n.echotime\n!object \\Driver\\\n"));
+        _ftprintf(commandsFile, _T(".echo === Loaded Images ===\n.echotime\n!imgscan\n"));
+        _ftprintf(commandsFile, _T(".echo === Loaded Paged Pools ===\n.echotime\n!poolused /t\n"));
+        _ftprintf(commandsFile, _T(".echo === Heap Summary ===\n.echotime\n!heap -s\n"));
+        _ftprintf(commandsFile, _T(".echo === Memory Information (Full) ===\n.echotime\n!memusage 7\n"));
+        _ftprintf(commandsFile, _T(".echo === Quitting ===\n.echotime\n.quit\n"));
         fclose(commandsFile);
         LogDebug(_T("WinDbg commands script created."), 0, _T("."));
     } else {
@@ -428,6 +484,9 @@ void CaptureWinDbgOutput(const TCHAR *outputFileName, const TCHAR *processFolder
 }
 
 int main(void) {
+    InitMetrics("process_analyzer");
+    MetricTimer sweepTimer = BeginMetricTimer();
+
     // Check for admin privileges
     if (!IsRunAsAdmin()) {
         LogErrorAndExit(_T("This program requires administrative privileges."));
@@ -439,25 +498,75 @@ int main(void) {
     // Create the WinDbg commands script
     CreateWinDbgCommandsScript();
 
+    // Open the sweep journal; an unfinished sweep resumes where it stopped
+    SweepJournal journal;
+    TCHAR journalFileName[BUFFER_SIZE];
+    TCHAR journalLog[BUFFER_SIZE];
+    _stprintf(journalFileName, _T("%s\\%s"), OUTPUT_FOLDER, SWEEP_JOURNAL_FILE);
+    if (!OpenSweepJournal(&journal, journalFileName)) {
+        LogErrorAndExit(_T("Failed to open sweep journal"));
+    }
+    if (journal.resumed) {
+        _stprintf(journalLog, _T("Resuming sweep: %llu processes journaled, %llu classified, %llu torn bytes discarded"),
+                  (unsigned long long)journal.entryCount, (unsigned long long)CountSweepEntries(&journal, SWEEP_CLASSIFIED),
+                  (unsigned long long)journal.tornBytes);
+        LogSummary(journalLog);
+    }
+
     // Step 1: Get all running process IDs
-    DWORD processIDs[1024], bytesReturned;
-    if (!GetAllProcessIDs(processIDs, sizeof(processIDs), &bytesReturned)) {
+    DWORD *processIDs = NULL;
+    DWORD numProcesses = 0;
+    MetricTimer enumerateTimer = BeginMetricTimer();
+    bool enumerated = GetAllProcessIDs(&processIDs, &numProcesses);
+    EndMetricTimer(enumerateTimer, "enumerate");
+    if (!enumerated) {
+        CloseSweepJournal(&journal);
         return 1;  // Exit if we cannot get process IDs
     }
-    DWORD numProcesses = bytesReturned / sizeof(DWORD);
+
+    // Queue every process not yet journaled with a single durable write
+    uint64_t *creationTimes = (uint64_t *)malloc((numProcesses + 1) * sizeof(uint64_t));
+    if (!creationTimes) {
+        free(processIDs);
+        CloseSweepJournal(&journal);
+        LogErrorAndExit(_T("Failed to allocate creation times"));
+    }
+    for (DWORD i = 0; i < numProcesses; i++) {
+        creationTimes[i] = GetProcessCreationTime(processIDs[i]);
+        if (processIDs[i] != 0 && !FindSweepEntry(&journal, processIDs[i], creationTimes[i])) {
+            RecordSweepState(&journal, processIDs[i], creationTimes[i], SWEEP_QUEUED);
+        }
+    }
+    if (!FlushSweepJournal(&journal)) {
+        LogError(_T("Failed to write sweep journal"), 0, _T("."));
+    }
 
     // Step 2: Run WinDbg for each process
+    ULONGLONG lastMetricsExport = GetTickCount64();
     for (DWORD i = 0; i < numProcesses; i++) {
         DWORD pid = processIDs[i];
         if (pid == 0) continue;  // Skip system idle process
 
-        TCHAR processName[BUFFER_SIZE];
-        if (!GetProcessNameByPID(pid, processName, sizeof(processName))) {
+        // Finished in an earlier run of this sweep
+        SweepEntry *entry = FindSweepEntry(&journal, pid, creationTimes[i]);
+        uint32_t state = entry ? entry->state : SWEEP_QUEUED;
+        uint32_t attempts = entry ? entry->attempts : 0;
+        if (state == SWEEP_CLASSIFIED) {
+            AddMetricCounter("processes_resumed_skipped", 1);
+            continue;
+        }
+
+        MetricTimer processTimer = BeginMetricTimer();
+        MetricTimer openTimer = BeginMetricTimer();
+        TCHAR processName[MAX_PATH];
+        bool named = GetProcessNameByPID(pid, processName, sizeof(processName));
+        EndMetricTimer(openTimer, "open_process");
+        if (!named) {
             LogError(_T("Failed to get process name"), pid, _T("."));
             continue;
         }
 
-        _tprintf(_T("Analyzing process %s (PID: %d)\n"), processName, pid);
+        _tprintf(_T("Analyzing process %s (PID: %d, journal: %s)\n"), processName, pid, SweepStateName(state));
 
         // Create a directory for this process
         TCHAR processFolder[BUFFER_SIZE];
@@ -465,39 +574,71 @@ int main(void) {
         CreateDirectoryIfNotExists(processFolder);
 
         // Create output file path
-        TCHAR outputFileName[BUFFER_SIZE];
+        TCHAR outputFileName[BUFFER_SIZE + MAX_PATH];  // Room for the folder plus the file name
         _stprintf(outputFileName, _T("%s\\windbg_output.txt"), processFolder);
 
-        // Retry mechanism for running WinDbg
-        int retryCount = 0;
-        const int maxRetries = 3;
-        bool success = false;
-        while (retryCount < maxRetries) {
+        // Retry mechanism for running WinDbg; attempts cut short by a crash count against the limit
+        const int maxRetries = SWEEP_MAX_ATTACH_ATTEMPTS;
+        bool success = state == SWEEP_CAPTURED;
+        if (state == SWEEP_ATTACHING) {
+            LogError(_T("Previous run stopped while attached to this process"), pid, processFolder);
+        }
+        while (!success && attempts < (uint32_t)maxRetries) {
+            RecordSweepState(&journal, pid, creationTimes[i], SWEEP_ATTACHING);
+            attempts++;
             if (RunWinDbg(WINDBG_PATH, pid, COMMANDS_SCRIPT_PATH, outputFileName, processFolder)) {
                 success = true;
+                RecordSweepState(&journal, pid, creationTimes[i], SWEEP_CAPTURED);
                 _tprintf(_T("Successfully analyzed process %s (PID: %d)\n"), processName, pid);
+                MetricTimer loggingTimer = BeginMetricTimer();
                 CaptureWinDbgOutput(outputFileName, processFolder);  // Capture and print output
-                break;
+                EndMetricTimer(loggingTimer, "output_logging");
+                RecordDebuggerCommandTimings(outputFileName);
             } else {
-                retryCount++;
+                AddMetricCounter("attach_retries", 1);
                 LogError(_T("Failed to attach to process, retrying..."), pid, processFolder);
-                _tprintf(_T("Retry %d for process %s (PID: %d)\n"), retryCount, processName, pid);
+                _tprintf(_T("Retry %u for process %s (PID: %d)\n"), attempts, processName, pid);
                 HandleErrorPopups(pid);  // Handle error popups
             }
         }
 
         if (!success) {
+            AddMetricCounter("attach_failures", 1);
             LogError(_T("Failed to attach to process after multiple attempts"), pid, processFolder);
             _tprintf(_T("Skipping process %s (PID: %d) after multiple attempts\n"), processName, pid);
         }
 
         // Classify and log the process
+        MetricTimer classifyTimer = BeginMetricTimer();
         ClassifyProcesses(pid, processName, processFolder);
+        EndMetricTimer(classifyTimer, "classify");
+        RecordSweepState(&journal, pid, creationTimes[i], SWEEP_CLASSIFIED);
+        EndMetricTimer(processTimer, "process_total");
+        AddMetricCounter("processes_analyzed", 1);
+
+        // Hours-long sweeps export along the way, not only at the end
+        if (GetTickCount64() - lastMetricsExport >= METRICS_EXPORT_INTERVAL_MS) {
+            ExportMetrics(OUTPUT_FOLDER);
+            lastMetricsExport = GetTickCount64();
+        }
 
         // Ensure WinDbg process has completely finished before moving to the next process
         _tprintf(_T("Analysis for process %s (PID: %d) completed. Moving to the next process.\n"), processName, pid);
     }
 
+    // The sweep is complete: keep one record per process so the next run starts fresh
+    if (!CompactSweepJournal(&journal)) {
+        LogError(_T("Failed to compact sweep journal"), 0, _T("."));
+    }
+    CloseSweepJournal(&journal);
+    free(creationTimes);
+    free(processIDs);
+
+    EndMetricTimer(sweepTimer, "sweep_total");
+    if (!ExportMetrics(OUTPUT_FOLDER)) {
+        LogError(_T("Failed to export sweep metrics"), 0, _T("."));
+    }
+
     _tprintf(_T("Analysis completed for all processes.\n"));
 
     return 0;
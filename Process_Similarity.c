@@ -0,0 +1,793 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "Process_Similarity.h"
+#include "Content_Hash.h"
+
+#define LINE_SIZE 4096
+#define MAX_TOKEN_LENGTH 256
+#define MIN_SECTION_WORD_LENGTH 3
+#define BATCH_PROCESSES 4096
+#define GOLDEN_RATIO_64 0x9E3779B97F4A7C15ULL
+
+// Feature files of one process folder, written by Locate_Code and Process_Analyzer
+static const TCHAR *const featureFiles[] = {
+    _T("windbg_output_modules.txt"),
+    _T("windbg_output_strings.txt"),
+    _T("windbg_output.txt"),
+    _T("windbg_output_clipboard.txt"),
+};
+
+// First slot of each family, plus the end of the last one; every family is a whole number of bands
+static const uint32_t familyFirstSlot[SIMILARITY_FAMILY_COUNT + 1] = {
+    0,
+    SIMILARITY_MODULE_SLOTS,
+    SIMILARITY_MODULE_SLOTS + SIMILARITY_STRING_SLOTS,
+    SIMILARITY_MODULE_SLOTS + SIMILARITY_STRING_SLOTS + SIMILARITY_SECTION_SLOTS,
+};
+
+static uint64_t Mix64(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+static uint32_t SlotFamily(uint32_t slot) {
+    uint32_t family = 0;
+    while (slot >= familyFirstSlot[family + 1]) family++;
+    return family;
+}
+
+static double ElapsedMilliseconds(LARGE_INTEGER start) {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)(now.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+// ---------------------------------------------------------------------------
+// Signatures
+// ---------------------------------------------------------------------------
+
+static void ClearSignature(ProcessSignature *signature) {
+    signature->familyMask = 0;
+    signature->reserved = 0;
+    memset(signature->values, 0xff, sizeof(signature->values));
+}
+
+// Function to fold one token into a family's slots; slot i keeps the minimum of an independent hash
+static void AddSignatureToken(ProcessSignature *signature, uint32_t family, const char *token, size_t length) {
+    Xxh64Context context;
+    Xxh64Init(&context, family);
+    Xxh64Update(&context, token, length);
+    uint64_t tokenHash = Xxh64Final(&context);
+
+    for (uint32_t slot = familyFirstSlot[family]; slot < familyFirstSlot[family + 1]; slot++) {
+        uint32_t value = (uint32_t)(Mix64(tokenHash + (slot + 1) * GOLDEN_RATIO_64) >> 32);
+        if (value < signature->values[slot]) signature->values[slot] = value;
+    }
+    signature->familyMask |= 1u << family;
+}
+
+static void TrimLineEnd(char *line) {
+    size_t length = strlen(line);
+    while (length && (line[length - 1] == '\n' || line[length - 1] == '\r')) line[--length] = '\0';
+}
+
+static FILE *OpenFeatureFile(const TCHAR *processFolder, const TCHAR *fileName) {
+    TCHAR path[MAX_PATH];
+    _stprintf(path, _T("%s\\%s"), processFolder, fileName);
+    return _tfopen(path, _T("rb"));
+}
+
+// Function to add each module's lowercased base name, and base name plus SHA-256 where it was hashed
+static void AddModuleTokens(ProcessSignature *signature, FILE *file) {
+    char line[LINE_SIZE];
+    char token[MAX_TOKEN_LENGTH + SHA256_HEX_SIZE + 2];
+    while (fgets(line, sizeof(line), file)) {
+        TrimLineEnd(line);
+        char *hash = strchr(line, '\t');
+        if (hash) *hash++ = '\0';
+
+        const char *name = line;
+        for (const char *c = line; *c; c++) {
+            if (*c == '\\' || *c == '/') name = c + 1;
+        }
+        size_t length = 0;
+        for (; name[length] && length < MAX_TOKEN_LENGTH; length++) {
+            char c = name[length];
+            token[length] = (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+        }
+        if (length == 0) continue;
+        AddSignatureToken(signature, SIMILARITY_MODULES, token, length);
+
+        // Unreadable images carry "-" instead of a hash
+        if (hash && strlen(hash) >= SHA256_HEX_SIZE - 1 && hash[SHA256_HEX_SIZE - 1] == '\t') {
+            token[length++] = '@';
+            memcpy(token + length, hash, SHA256_HEX_SIZE - 1);
+            AddSignatureToken(signature, SIMILARITY_MODULES, token, length + SHA256_HEX_SIZE - 1);
+        }
+    }
+}
+
+// Function to add the text of every "<address> a|u <text>" line from the memory string extractor
+static void AddStringTokens(ProcessSignature *signature, FILE *file) {
+    char line[LINE_SIZE];
+    while (fgets(line, sizeof(line), file)) {
+        TrimLineEnd(line);
+        const char *text = strchr(line, ' ');
+        if (!text || (text[1] != 'a' && text[1] != 'u') || text[2] != ' ') continue;
+        text += 3;
+        if (*text) AddSignatureToken(signature, SIMILARITY_STRINGS, text, strlen(text));
+    }
+}
+
+static bool IsWordCharacter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || c == '!' || c == '.' || c == '@' || c == '$' || c == '?' || c == ':' || (unsigned char)c >= 0x80;
+}
+
+// Addresses, counters and register values differ between any two captures; only words with a non-hex letter count
+static bool IsStableWord(const char *word, size_t length) {
+    if (length < MIN_SECTION_WORD_LENGTH || length > MAX_TOKEN_LENGTH) return false;
+    for (size_t i = 0; i < length; i++) {
+        char c = word[i];
+        if ((c >= 'g' && c <= 'z') || (c >= 'G' && c <= 'Z') || (unsigned char)c >= 0x80) return true;
+    }
+    return false;
+}
+
+// Function to add "<section>|<word>" tokens from a transcript split by "=== Section ===" headers
+static void AddSectionTokens(ProcessSignature *signature, FILE *file) {
+    char line[LINE_SIZE];
+    char token[LINE_SIZE + MAX_TOKEN_LENGTH + 2];
+    size_t sectionLength = 0;
+    while (fgets(line, sizeof(line), file)) {
+        TrimLineEnd(line);
+        const char *header = strstr(line, "=== ");
+        const char *headerEnd = header ? strstr(header + 4, " ===") : NULL;
+        if (headerEnd) {
+            sectionLength = (size_t)(headerEnd - (header + 4));
+            memcpy(token, header + 4, sectionLength);
+            token[sectionLength++] = '|';
+            continue;
+        }
+        // Time stamps are the same in every section of every capture taken at once
+        if (sectionLength == 0 || strstr(line, " time:")) continue;
+
+        for (const char *c = line; *c;) {
+            while (*c && !IsWordCharacter(*c)) c++;
+            const char *word = c;
+            while (*c && IsWordCharacter(*c)) c++;
+            size_t length = (size_t)(c - word);
+            while (length && (word[length - 1] == ':' || word[length - 1] == '.')) length--;
+            if (!IsStableWord(word, length)) continue;
+            memcpy(token + sectionLength, word, length);
+            AddSignatureToken(signature, SIMILARITY_SECTIONS, token, sectionLength + length);
+        }
+    }
+}
+
+// Function to build the MinHash signature of one captured process folder; false if it holds no features
+bool BuildProcessSignature(const TCHAR *processFolder, ProcessSignature *signature) {
+    ClearSignature(signature);
+
+    FILE *file = OpenFeatureFile(processFolder, featureFiles[0]);
+    if (file) {
+        AddModuleTokens(signature, file);
+        fclose(file);
+    }
+    file = OpenFeatureFile(processFolder, featureFiles[1]);
+    if (file) {
+        AddStringTokens(signature, file);
+        fclose(file);
+    }
+    // Process_Analyzer saves the transcript as windbg_output.txt, Locate_Code as windbg_output_clipboard.txt
+    file = OpenFeatureFile(processFolder, featureFiles[2]);
+    if (!file) file = OpenFeatureFile(processFolder, featureFiles[3]);
+    if (file) {
+        AddSectionTokens(signature, file);
+        fclose(file);
+    }
+    return signature->familyMask != 0;
+}
+
+// Function to find the newest write time of a folder's feature files; false if it has none
+bool ProcessFeaturesModified(const TCHAR *processFolder, uint64_t *modified) {
+    bool found = false;
+    *modified = 0;
+    for (size_t i = 0; i < sizeof(featureFiles) / sizeof(featureFiles[0]); i++) {
+        TCHAR path[MAX_PATH];
+        WIN32_FIND_DATA findData;
+        _stprintf(path, _T("%s\\%s"), processFolder, featureFiles[i]);
+        HANDLE hFind = FindFirstFile(path, &findData);
+        if (hFind == INVALID_HANDLE_VALUE) continue;
+        FindClose(hFind);
+        uint64_t written = ((uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime;
+        if (written > *modified) *modified = written;
+        found = true;
+    }
+    return found;
+}
+
+// Function to estimate Jaccard similarity as the share of equal slots, over the families both processes have
+double EstimateSimilarity(const ProcessSignature *a, const ProcessSignature *b) {
+    uint32_t shared = a->familyMask & b->familyMask;
+    uint32_t matches = 0, slots = 0;
+    for (uint32_t family = 0; family < SIMILARITY_FAMILY_COUNT; family++) {
+        if (!(shared & (1u << family))) continue;
+        for (uint32_t slot = familyFirstSlot[family]; slot < familyFirstSlot[family + 1]; slot++) {
+            matches += a->values[slot] == b->values[slot];
+        }
+        slots += familyFirstSlot[family + 1] - familyFirstSlot[family];
+    }
+    return slots ? (double)matches / (double)slots : 0.0;
+}
+
+// Function to hash a band's rows into its bucket key; false when the band's family is empty
+static bool BandKey(const ProcessSignature *signature, uint32_t band, uint32_t *key) {
+    uint32_t slot = band * SIMILARITY_BAND_ROWS;
+    if (!(signature->familyMask & (1u << SlotFamily(slot)))) return false;
+    uint64_t hash = Mix64(band + 1);
+    for (uint32_t row = 0; row < SIMILARITY_BAND_ROWS; row++) {
+        hash = Mix64(hash ^ signature->values[slot + row]);
+    }
+    *key = (uint32_t)(hash >> 32);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Process table
+// ---------------------------------------------------------------------------
+
+static uint32_t HashPath(const TCHAR *path) {
+    uint32_t hash = 2166136261u;
+    for (; *path; path++) {
+        hash = (hash ^ (uint32_t)_totlower(*path)) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t *FindPathSlot(const SimilarityIndex *index, const TCHAR *path) {
+    uint32_t mask = index->pathSlotCount - 1;
+    for (uint32_t slot = HashPath(path) & mask;; slot = (slot + 1) & mask) {
+        uint32_t entry = index->pathSlots[slot];
+        if (entry == 0 || _tcsicmp(index->processes[entry - 1].path, path) == 0) {
+            return &index->pathSlots[slot];
+        }
+    }
+}
+
+static bool GrowPathSlots(SimilarityIndex *index) {
+    uint32_t slotCount = index->pathSlotCount ? index->pathSlotCount * 2 : 4096;
+    uint32_t *slots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+    if (!slots) return false;
+    free(index->pathSlots);
+    index->pathSlots = slots;
+    index->pathSlotCount = slotCount;
+    for (uint32_t id = 0; id < index->processCount; id++) {
+        if (index->processes[id].live) {
+            *FindPathSlot(index, index->processes[id].path) = id + 1;
+        }
+    }
+    return true;
+}
+
+// Function to make room for process IDs below count; unused IDs stay zeroed (not known, not live)
+static bool ReserveProcesses(SimilarityIndex *index, uint32_t count) {
+    if (count > index->processCapacity) {
+        uint32_t capacity = index->processCapacity ? index->processCapacity : 1024;
+        while (capacity < count) capacity *= 2;
+        IndexedProcess *processes = (IndexedProcess *)realloc(index->processes, capacity * sizeof(IndexedProcess));
+        if (!processes) return false;
+        memset(processes + index->processCapacity, 0, (capacity - index->processCapacity) * sizeof(IndexedProcess));
+        index->processes = processes;
+        index->processCapacity = capacity;
+    }
+    if (count > index->processCount) index->processCount = count;
+    return true;
+}
+
+// Function to register a process folder under an ID, retiring any older entry for the same path
+static bool SetProcess(SimilarityIndex *index, uint32_t id, const TCHAR *path, uint64_t modified) {
+    if (!ReserveProcesses(index, id + 1)) return false;
+    if (index->processCount * 2 > index->pathSlotCount && !GrowPathSlots(index)) return false;
+
+    IndexedProcess *process = &index->processes[id];
+    _tcsncpy(process->path, path, MAX_PATH - 1);
+    process->path[MAX_PATH - 1] = _T('\0');
+    process->modified = modified;
+    process->known = true;
+    process->live = true;
+
+    uint32_t *slot = FindPathSlot(index, process->path);
+    if (*slot != 0 && *slot != id + 1) {
+        index->processes[*slot - 1].live = false;
+    }
+    *slot = id + 1;
+    return true;
+}
+
+const IndexedProcess *FindIndexedProcess(const SimilarityIndex *index, const TCHAR *path, uint32_t *process) {
+    if (index->pathSlotCount == 0) return NULL;
+    uint32_t slot = *FindPathSlot(index, path);
+    if (slot == 0) return NULL;
+    if (process) *process = slot - 1;
+    return &index->processes[slot - 1];
+}
+
+static bool LoadProcesses(SimilarityIndex *index) {
+    if (!GrowPathSlots(index)) return false;
+
+    TCHAR processesFileName[MAX_PATH];
+    _stprintf(processesFileName, _T("%s\\%s"), index->folder, SIMILARITY_PROCESSES_FILE);
+    FILE *processesFile = _tfopen(processesFileName, _T("r"));
+    if (!processesFile) return true;
+
+    TCHAR line[MAX_PATH + 64];
+    while (_fgetts(line, MAX_PATH + 64, processesFile)) {
+        unsigned int id;
+        unsigned long long modified;
+        TCHAR path[MAX_PATH];
+        if (_stscanf(line, _T("%u %llu %259[^\r\n]"), &id, &modified, path) == 3) {
+            if (!SetProcess(index, id, path, modified)) {
+                fclose(processesFile);
+                return false;
+            }
+        }
+    }
+    fclose(processesFile);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Mapped files
+// ---------------------------------------------------------------------------
+
+static const uint8_t *MapReadOnly(const TCHAR *path, HANDLE *hFile, HANDLE *hMapping, uint64_t *size) {
+    *hMapping = NULL;
+    *hFile = CreateFile(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (*hFile == INVALID_HANDLE_VALUE) return NULL;
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(*hFile, &fileSize);
+    *size = (uint64_t)fileSize.QuadPart;
+    if (*size == 0) return NULL;
+    *hMapping = CreateFileMapping(*hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    return *hMapping ? (const uint8_t *)MapViewOfFile(*hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+}
+
+static void Unmap(const uint8_t **base, HANDLE *hMapping, HANDLE *hFile) {
+    if (*base) UnmapViewOfFile(*base);
+    if (*hMapping) CloseHandle(*hMapping);
+    if (*hFile != INVALID_HANDLE_VALUE && *hFile != NULL) CloseHandle(*hFile);
+    *base = NULL;
+    *hMapping = NULL;
+    *hFile = NULL;
+}
+
+static bool MapBandSegment(BandSegment *segment, const TCHAR *path) {
+    uint64_t size = 0;
+    memset(segment, 0, sizeof(*segment));
+    _tcsncpy(segment->path, path, MAX_PATH - 1);
+    segment->base = MapReadOnly(path, &segment->hFile, &segment->hMapping, &size);
+    if (!segment->base || size < sizeof(BandSegmentHeader)) return false;
+
+    segment->header = (const BandSegmentHeader *)segment->base;
+    segment->entries = (const BandEntry *)(segment->base + sizeof(BandSegmentHeader));
+    return segment->header->magic == SIMILARITY_BAND_MAGIC && segment->header->version == SIMILARITY_VERSION &&
+           sizeof(BandSegmentHeader) + (uint64_t)segment->header->bandStart[SIMILARITY_BAND_COUNT] * sizeof(BandEntry) == size;
+}
+
+static int CompareBandSegments(const void *a, const void *b) {
+    uint32_t left = ((const BandSegment *)a)->header->firstProcess;
+    uint32_t right = ((const BandSegment *)b)->header->firstProcess;
+    return (left > right) - (left < right);
+}
+
+// Function to map every valid band segment, ordered by the processes they cover
+static size_t LoadBandSegments(const TCHAR *indexFolder, BandSegment **segments) {
+    TCHAR pattern[MAX_PATH];
+    WIN32_FIND_DATA findData;
+    size_t count = 0, capacity = 0;
+    *segments = NULL;
+
+    _stprintf(pattern, _T("%s\\%s"), indexFolder, SIMILARITY_BAND_PATTERN);
+    HANDLE hFind = FindFirstFile(pattern, &findData);
+    if (hFind == INVALID_HANDLE_VALUE) return 0;
+    do {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            BandSegment *grown = (BandSegment *)realloc(*segments, capacity * sizeof(BandSegment));
+            if (!grown) break;
+            *segments = grown;
+        }
+        TCHAR path[MAX_PATH];
+        _stprintf(path, _T("%s\\%s"), indexFolder, findData.cFileName);
+        BandSegment *segment = &(*segments)[count];
+        if (MapBandSegment(segment, path)) {
+            count++;
+        } else {
+            _tprintf(_T("Ignoring damaged band segment %s\n"), path);
+            Unmap(&segment->base, &segment->hMapping, &segment->hFile);
+        }
+    } while (FindNextFile(hFind, &findData));
+    FindClose(hFind);
+
+    if (count > 1) qsort(*segments, count, sizeof(BandSegment), CompareBandSegments);
+    return count;
+}
+
+static void UnloadBandSegments(BandSegment *segments, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        Unmap(&segments[i].base, &segments[i].hMapping, &segments[i].hFile);
+    }
+    free(segments);
+}
+
+// Function to open an index read-only; a missing index opens empty
+bool OpenSimilarityIndex(SimilarityIndex *index, const TCHAR *indexFolder) {
+    memset(index, 0, sizeof(*index));
+    _tcsncpy(index->folder, indexFolder, MAX_PATH - 1);
+    if (!LoadProcesses(index)) {
+        _tprintf(_T("Failed to load %s\\%s\n"), indexFolder, SIMILARITY_PROCESSES_FILE);
+        CloseSimilarityIndex(index);
+        return false;
+    }
+
+    TCHAR signaturesFileName[MAX_PATH];
+    uint64_t size = 0;
+    _stprintf(signaturesFileName, _T("%s\\%s"), indexFolder, SIMILARITY_SIGNATURES_FILE);
+    index->signatureBase = MapReadOnly(signaturesFileName, &index->hSignatureFile, &index->hSignatureMapping, &size);
+    const SignatureFileHeader *header = (const SignatureFileHeader *)index->signatureBase;
+    if (header && size >= sizeof(*header) && header->magic == SIMILARITY_SIGNATURE_MAGIC &&
+        header->version == SIMILARITY_VERSION && header->recordSize == sizeof(ProcessSignature)) {
+        index->signatures = (const ProcessSignature *)(index->signatureBase + sizeof(*header));
+        // A record cut short by an interrupted add is not counted; the next add overwrites it
+        index->signatureCount = (uint32_t)((size - sizeof(*header)) / sizeof(ProcessSignature));
+    } else if (index->signatureBase) {
+        _tprintf(_T("Ignoring damaged %s\n"), signaturesFileName);
+    }
+
+    index->segmentCount = LoadBandSegments(indexFolder, &index->segments);
+    return true;
+}
+
+void CloseSimilarityIndex(SimilarityIndex *index) {
+    Unmap(&index->signatureBase, &index->hSignatureMapping, &index->hSignatureFile);
+    UnloadBandSegments(index->segments, index->segmentCount);
+    free(index->processes);
+    free(index->pathSlots);
+    memset(index, 0, sizeof(*index));
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+// Function to find the first entry of a band whose key is not below key
+static uint32_t LowerBound(const BandSegment *segment, uint32_t band, uint32_t key) {
+    uint32_t low = segment->header->bandStart[band], high = segment->header->bandStart[band + 1];
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (segment->entries[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Function to keep the k best results sorted by descending similarity
+static size_t InsertResult(SimilarProcess *results, size_t count, size_t k, uint32_t process, double similarity) {
+    if (count == k && similarity <= results[k - 1].similarity) return count;
+    size_t position = count < k ? count++ : k - 1;
+    while (position > 0 && results[position - 1].similarity < similarity) {
+        results[position] = results[position - 1];
+        position--;
+    }
+    results[position].process = process;
+    results[position].similarity = similarity;
+    return count;
+}
+
+// Function to find the k indexed processes most similar to a signature among those sharing an LSH bucket.
+// Only live processes are returned, and never excludeProcess (pass UINT32_MAX to keep all).
+size_t QuerySimilarProcesses(const SimilarityIndex *index, const ProcessSignature *signature, uint32_t excludeProcess,
+                             SimilarProcess *results, size_t k, size_t *candidateCount) {
+    size_t count = 0;
+    if (candidateCount) *candidateCount = 0;
+    if (k == 0 || index->signatureCount == 0) return 0;
+
+    // One bit per process: a candidate from several bands or segments is scored once
+    uint8_t *seen = (uint8_t *)calloc((index->signatureCount + 7) / 8, 1);
+    if (!seen) return 0;
+
+    for (uint32_t band = 0; band < SIMILARITY_BAND_COUNT; band++) {
+        uint32_t key;
+        if (!BandKey(signature, band, &key)) continue;
+        for (size_t s = 0; s < index->segmentCount; s++) {
+            const BandSegment *segment = &index->segments[s];
+            uint32_t end = segment->header->bandStart[band + 1];
+            for (uint32_t e = LowerBound(segment, band, key); e < end && segment->entries[e].key == key; e++) {
+                uint32_t id = segment->entries[e].process;
+                if (id >= index->signatureCount || (seen[id >> 3] & (1u << (id & 7)))) continue;
+                seen[id >> 3] |= (uint8_t)(1u << (id & 7));
+                if (id == excludeProcess || id >= index->processCount || !index->processes[id].live) continue;
+                if (candidateCount) (*candidateCount)++;
+                count = InsertResult(results, count, k, id, EstimateSimilarity(signature, &index->signatures[id]));
+            }
+        }
+    }
+    free(seen);
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Index building
+// ---------------------------------------------------------------------------
+
+bool AddToSimilarityBatch(SimilarityBatch *batch, const TCHAR *path, uint64_t modified, const ProcessSignature *signature) {
+    if (batch->count == batch->capacity) {
+        size_t capacity = batch->capacity ? batch->capacity * 2 : 256;
+        TCHAR (*paths)[MAX_PATH] = (TCHAR (*)[MAX_PATH])realloc(batch->paths, capacity * sizeof(*paths));
+        if (paths) batch->paths = paths;
+        uint64_t *times = (uint64_t *)realloc(batch->modified, capacity * sizeof(uint64_t));
+        if (times) batch->modified = times;
+        ProcessSignature *signatures = (ProcessSignature *)realloc(batch->signatures, capacity * sizeof(ProcessSignature));
+        if (signatures) batch->signatures = signatures;
+        if (!paths || !times || !signatures) return false;
+        batch->capacity = capacity;
+    }
+    _tcsncpy(batch->paths[batch->count], path, MAX_PATH - 1);
+    batch->paths[batch->count][MAX_PATH - 1] = _T('\0');
+    batch->modified[batch->count] = modified;
+    batch->signatures[batch->count] = *signature;
+    batch->count++;
+    return true;
+}
+
+void FreeSimilarityBatch(SimilarityBatch *batch) {
+    free(batch->paths);
+    free(batch->modified);
+    free(batch->signatures);
+    memset(batch, 0, sizeof(*batch));
+}
+
+static int CompareBandEntries(const void *a, const void *b) {
+    const BandEntry *left = (const BandEntry *)a;
+    const BandEntry *right = (const BandEntry *)b;
+    if (left->key != right->key) return (left->key > right->key) - (left->key < right->key);
+    return (left->process > right->process) - (left->process < right->process);
+}
+
+// Function to write a band segment through a temporary file; bandStart must already hold the band offsets
+static bool WriteBandSegmentFile(const TCHAR *folder, BandSegmentHeader *header, const BandEntry *entries) {
+    TCHAR segmentFileName[MAX_PATH];
+    TCHAR temporaryFileName[MAX_PATH];
+    _stprintf(segmentFileName, _T("%s\\bands_%010u.lsh"), folder, header->firstProcess);
+    _stprintf(temporaryFileName, _T("%s.tmp"), segmentFileName);
+
+    FILE *segmentFile = _tfopen(temporaryFileName, _T("wb"));
+    if (!segmentFile) return false;
+    header->magic = SIMILARITY_BAND_MAGIC;
+    header->version = SIMILARITY_VERSION;
+
+    size_t entryCount = header->bandStart[SIMILARITY_BAND_COUNT];
+    bool ok = fwrite(header, sizeof(*header), 1, segmentFile) == 1 &&
+              fwrite(entries, sizeof(BandEntry), entryCount, segmentFile) == entryCount;
+    ok = (fclose(segmentFile) == 0) && ok;
+
+    // The rename publishes the segment; readers never see a partial file
+    return ok && MoveFileEx(temporaryFileName, segmentFileName, MOVEFILE_REPLACE_EXISTING);
+}
+
+// Function to append signatures at IDs firstProcess.., writing empty records over any gap
+static bool AppendSignatures(const TCHAR *indexFolder, uint32_t signatureCount, uint32_t firstProcess,
+                             const ProcessSignature *signatures, size_t count) {
+    TCHAR signaturesFileName[MAX_PATH];
+    _stprintf(signaturesFileName, _T("%s\\%s"), indexFolder, SIMILARITY_SIGNATURES_FILE);
+    FILE *signaturesFile = _tfopen(signaturesFileName, signatureCount ? _T("r+b") : _T("wb"));
+    if (!signaturesFile) return false;
+
+    SignatureFileHeader header = { SIMILARITY_SIGNATURE_MAGIC, SIMILARITY_VERSION, SIMILARITY_HASH_COUNT, sizeof(ProcessSignature) };
+    bool ok = fwrite(&header, sizeof(header), 1, signaturesFile) == 1 &&
+              _fseeki64(signaturesFile, sizeof(header) + (int64_t)signatureCount * sizeof(ProcessSignature), SEEK_SET) == 0;
+    ProcessSignature empty;
+    ClearSignature(&empty);
+    for (uint32_t id = signatureCount; ok && id < firstProcess; id++) {
+        ok = fwrite(&empty, sizeof(empty), 1, signaturesFile) == 1;
+    }
+    ok = ok && fwrite(signatures, sizeof(ProcessSignature), count, signaturesFile) == count;
+    return (fclose(signaturesFile) == 0) && ok;
+}
+
+// Function to make a batch searchable: signatures first, then its band segment, then the processes.txt lines
+// that publish it. An interrupted commit leaves only records no process line points at.
+bool CommitSimilarityBatch(const TCHAR *indexFolder, SimilarityBatch *batch) {
+    if (batch->count == 0) return true;
+    CreateDirectory(indexFolder, NULL);
+
+    SimilarityIndex index;
+    if (!OpenSimilarityIndex(&index, indexFolder)) return false;
+    uint32_t signatureCount = index.signatureCount;
+    uint32_t firstProcess = index.processCount > signatureCount ? index.processCount : signatureCount;
+    for (size_t i = 0; i < index.segmentCount; i++) {
+        if (index.segments[i].header->lastProcess >= firstProcess) firstProcess = index.segments[i].header->lastProcess + 1;
+    }
+    CloseSimilarityIndex(&index);
+
+    BandEntry *entries = (BandEntry *)malloc(batch->count * SIMILARITY_BAND_COUNT * sizeof(BandEntry));
+    if (!entries) return false;
+    BandSegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    header.firstProcess = firstProcess;
+    header.lastProcess = firstProcess + (uint32_t)batch->count - 1;
+    uint32_t entryCount = 0;
+    for (uint32_t band = 0; band < SIMILARITY_BAND_COUNT; band++) {
+        header.bandStart[band] = entryCount;
+        for (size_t i = 0; i < batch->count; i++) {
+            if (BandKey(&batch->signatures[i], band, &entries[entryCount].key)) {
+                entries[entryCount++].process = firstProcess + (uint32_t)i;
+            }
+        }
+        qsort(entries + header.bandStart[band], entryCount - header.bandStart[band], sizeof(BandEntry), CompareBandEntries);
+    }
+    header.bandStart[SIMILARITY_BAND_COUNT] = entryCount;
+
+    bool ok = AppendSignatures(indexFolder, signatureCount, firstProcess, batch->signatures, batch->count) &&
+              WriteBandSegmentFile(indexFolder, &header, entries);
+    free(entries);
+
+    TCHAR processesFileName[MAX_PATH];
+    _stprintf(processesFileName, _T("%s\\%s"), indexFolder, SIMILARITY_PROCESSES_FILE);
+    FILE *processesFile = ok ? _tfopen(processesFileName, _T("a")) : NULL;
+    if (!processesFile) return false;
+    for (size_t i = 0; i < batch->count; i++) {
+        _ftprintf(processesFile, _T("%u %llu %s\n"), firstProcess + (uint32_t)i,
+                  (unsigned long long)batch->modified[i], batch->paths[i]);
+    }
+    ok = fclose(processesFile) == 0;
+    batch->count = 0;
+    return ok;
+}
+
+typedef struct {
+    const TCHAR *indexFolder;
+    SimilarityIndex index;
+    SimilarityBatch batch;
+    uint32_t addedProcesses;
+    uint32_t skippedProcesses;
+} SimilarityBuilder;
+
+// Function to sign every process folder under a folder that is new or changed since the last run
+static bool AddFolder(SimilarityBuilder *builder, const TCHAR *folder) {
+    uint64_t modified;
+    if (ProcessFeaturesModified(folder, &modified)) {
+        const IndexedProcess *existing = FindIndexedProcess(&builder->index, folder, NULL);
+        if (existing && existing->modified == modified) {
+            builder->skippedProcesses++;
+            return true;
+        }
+        ProcessSignature signature;
+        if (!BuildProcessSignature(folder, &signature)) return true;
+        if (!AddToSimilarityBatch(&builder->batch, folder, modified, &signature)) return false;
+        builder->addedProcesses++;
+        return builder->batch.count < BATCH_PROCESSES || CommitSimilarityBatch(builder->indexFolder, &builder->batch);
+    }
+
+    TCHAR pattern[MAX_PATH];
+    WIN32_FIND_DATA findData;
+    bool ok = true;
+    _stprintf(pattern, _T("%s\\*"), folder);
+    HANDLE hFind = FindFirstFile(pattern, &findData);
+    if (hFind == INVALID_HANDLE_VALUE) return true;
+    do {
+        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) continue;
+        if (_tcscmp(findData.cFileName, _T(".")) == 0 || _tcscmp(findData.cFileName, _T("..")) == 0) continue;
+        TCHAR path[MAX_PATH];
+        _stprintf(path, _T("%s\\%s"), folder, findData.cFileName);
+        ok = AddFolder(builder, path);
+    } while (ok && FindNextFile(hFind, &findData));
+    FindClose(hFind);
+    return ok;
+}
+
+bool AddFolderToSimilarityIndex(const TCHAR *indexFolder, const TCHAR *rootFolder) {
+    SimilarityBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.indexFolder = indexFolder;
+
+    LARGE_INTEGER startTime;
+    QueryPerformanceCounter(&startTime);
+
+    CreateDirectory(indexFolder, NULL);
+    if (!OpenSimilarityIndex(&builder.index, indexFolder)) return false;
+    bool ok = AddFolder(&builder, rootFolder) && CommitSimilarityBatch(indexFolder, &builder.batch);
+
+    _tprintf(_T("Signed %u new or changed processes, skipped %u unchanged, in %.0f ms\n"),
+             builder.addedProcesses, builder.skippedProcesses, ElapsedMilliseconds(startTime));
+
+    FreeSimilarityBatch(&builder.batch);
+    CloseSimilarityIndex(&builder.index);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Compaction
+// ---------------------------------------------------------------------------
+
+// Function to merge all band segments into one, dropping processes superseded by newer captures.
+// Their signature records stay in signatures.bin, since IDs are record positions.
+bool CompactSimilarityIndex(const TCHAR *indexFolder) {
+    SimilarityIndex index;
+    if (!OpenSimilarityIndex(&index, indexFolder)) return false;
+    if (index.segmentCount < 2) {
+        _tprintf(_T("Nothing to compact (%u band segments)\n"), (unsigned)index.segmentCount);
+        CloseSimilarityIndex(&index);
+        return true;
+    }
+
+    size_t entryCapacity = 0;
+    for (size_t i = 0; i < index.segmentCount; i++) {
+        entryCapacity += index.segments[i].header->bandStart[SIMILARITY_BAND_COUNT];
+    }
+    BandEntry *entries = (BandEntry *)malloc((entryCapacity + 1) * sizeof(BandEntry));
+    TCHAR (*oldPaths)[MAX_PATH] = (TCHAR (*)[MAX_PATH])malloc(index.segmentCount * sizeof(*oldPaths));
+    bool ok = entries && oldPaths;
+
+    BandSegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    header.firstProcess = index.segments[0].header->firstProcess;
+    header.lastProcess = index.segments[index.segmentCount - 1].header->lastProcess;
+    uint32_t entryCount = 0;
+    for (uint32_t band = 0; ok && band < SIMILARITY_BAND_COUNT; band++) {
+        header.bandStart[band] = entryCount;
+        for (size_t i = 0; i < index.segmentCount; i++) {
+            const BandSegment *segment = &index.segments[i];
+            for (uint32_t e = segment->header->bandStart[band]; e < segment->header->bandStart[band + 1]; e++) {
+                uint32_t id = segment->entries[e].process;
+                if (id < index.processCount && index.processes[id].live) entries[entryCount++] = segment->entries[e];
+            }
+        }
+        qsort(entries + header.bandStart[band], entryCount - header.bandStart[band], sizeof(BandEntry), CompareBandEntries);
+    }
+    header.bandStart[SIMILARITY_BAND_COUNT] = entryCount;
+
+    // Old segments must be unmapped before the merged one replaces them
+    size_t segmentCount = index.segmentCount;
+    for (size_t i = 0; ok && i < segmentCount; i++) {
+        _tcscpy(oldPaths[i], index.segments[i].path);
+    }
+    CloseSimilarityIndex(&index);
+
+    TCHAR mergedFolder[MAX_PATH];
+    _stprintf(mergedFolder, _T("%s\\compacting"), indexFolder);
+    CreateDirectory(mergedFolder, NULL);
+    ok = ok && WriteBandSegmentFile(mergedFolder, &header, entries);
+    if (ok) {
+        // The merged segment replaces the oldest one first; leftovers after a crash only duplicate entries
+        TCHAR mergedFile[MAX_PATH];
+        TCHAR finalFile[MAX_PATH];
+        _stprintf(mergedFile, _T("%s\\bands_%010u.lsh"), mergedFolder, header.firstProcess);
+        _stprintf(finalFile, _T("%s\\bands_%010u.lsh"), indexFolder, header.firstProcess);
+        ok = MoveFileEx(mergedFile, finalFile, MOVEFILE_REPLACE_EXISTING);
+        for (size_t i = 0; ok && i < segmentCount; i++) {
+            if (_tcsicmp(oldPaths[i], finalFile) != 0) DeleteFile(oldPaths[i]);
+        }
+    }
+    RemoveDirectory(mergedFolder);
+
+    _tprintf(_T("Compacted %u band segments into one (%u bucket entries)\n"), (unsigned)segmentCount, entryCount);
+
+    free(oldPaths);
+    free(entries);
+    return ok;
+}
@@ -0,0 +1,123 @@
+#ifndef PROCESS_SIMILARITY_H
+#define PROCESS_SIMILARITY_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+
+#define SIMILARITY_HASH_COUNT 128
+#define SIMILARITY_BAND_ROWS 4
+#define SIMILARITY_BAND_COUNT (SIMILARITY_HASH_COUNT / SIMILARITY_BAND_ROWS)
+#define SIMILARITY_DEFAULT_INDEX_FOLDER _T("similarity_index")
+#define SIMILARITY_PROCESSES_FILE _T("processes.txt")
+#define SIMILARITY_SIGNATURES_FILE _T("signatures.bin")
+#define SIMILARITY_BAND_PATTERN _T("bands_*.lsh")
+#define SIMILARITY_SIGNATURE_MAGIC 0x4753484D  // "MHSG"
+#define SIMILARITY_BAND_MAGIC 0x4248534C       // "LSHB"
+#define SIMILARITY_VERSION 1
+
+// Feature families, each with its own slots of the signature; a band never spans two families
+enum {
+    SIMILARITY_MODULES,                 // Module base names, and name plus SHA-256 where known
+    SIMILARITY_STRINGS,                 // Strings extracted from captured memory
+    SIMILARITY_SECTIONS,                // Words of each transcript section (handle types, symbols, ...)
+    SIMILARITY_FAMILY_COUNT
+};
+#define SIMILARITY_MODULE_SLOTS 64
+#define SIMILARITY_STRING_SLOTS 48
+#define SIMILARITY_SECTION_SLOTS 16
+
+// MinHash signature of one process; also the on-disk record in signatures.bin, at index = process ID
+typedef struct {
+    uint32_t familyMask;                // Families with at least one token
+    uint32_t reserved;
+    uint32_t values[SIMILARITY_HASH_COUNT];
+} ProcessSignature;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hashCount;
+    uint32_t recordSize;
+} SignatureFileHeader;
+
+// Band segment: header, then (key, process ID) entries sorted by band, key and ID
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t firstProcess;
+    uint32_t lastProcess;
+    uint32_t bandStart[SIMILARITY_BAND_COUNT + 1];  // First entry of each band; the last is the entry count
+} BandSegmentHeader;
+
+typedef struct {
+    uint32_t key;
+    uint32_t process;
+} BandEntry;
+
+typedef struct {
+    TCHAR path[MAX_PATH];
+    uint64_t modified;                  // Newest write time of the folder's feature files
+    bool known;                         // Has a line in processes.txt
+    bool live;                          // Latest entry for its path
+} IndexedProcess;
+
+typedef struct {
+    HANDLE hFile;
+    HANDLE hMapping;
+    const uint8_t *base;
+    const BandSegmentHeader *header;
+    const BandEntry *entries;
+    TCHAR path[MAX_PATH];
+} BandSegment;
+
+// A loaded index: process table, mapped signatures and mapped band segments
+typedef struct {
+    TCHAR folder[MAX_PATH];
+    IndexedProcess *processes;
+    uint32_t processCount;              // Next process ID
+    uint32_t processCapacity;
+    uint32_t *pathSlots;                // Open-addressing table of process ID + 1 keyed by path
+    uint32_t pathSlotCount;
+    HANDLE hSignatureFile;
+    HANDLE hSignatureMapping;
+    const uint8_t *signatureBase;
+    const ProcessSignature *signatures;
+    uint32_t signatureCount;
+    BandSegment *segments;
+    size_t segmentCount;
+} SimilarityIndex;
+
+typedef struct {
+    uint32_t process;
+    double similarity;                  // Estimated Jaccard, over the families both processes have
+} SimilarProcess;
+
+// Processes waiting to be appended to the index as one band segment
+typedef struct {
+    TCHAR (*paths)[MAX_PATH];
+    uint64_t *modified;
+    ProcessSignature *signatures;
+    size_t count;
+    size_t capacity;
+} SimilarityBatch;
+
+bool BuildProcessSignature(const TCHAR *processFolder, ProcessSignature *signature);
+bool ProcessFeaturesModified(const TCHAR *processFolder, uint64_t *modified);
+double EstimateSimilarity(const ProcessSignature *a, const ProcessSignature *b);
+
+bool OpenSimilarityIndex(SimilarityIndex *index, const TCHAR *indexFolder);
+void CloseSimilarityIndex(SimilarityIndex *index);
+const IndexedProcess *FindIndexedProcess(const SimilarityIndex *index, const TCHAR *path, uint32_t *process);
+size_t QuerySimilarProcesses(const SimilarityIndex *index, const ProcessSignature *signature, uint32_t excludeProcess,
+                             SimilarProcess *results, size_t k, size_t *candidateCount);
+
+bool AddToSimilarityBatch(SimilarityBatch *batch, const TCHAR *path, uint64_t modified, const ProcessSignature *signature);
+bool CommitSimilarityBatch(const TCHAR *indexFolder, SimilarityBatch *batch);
+void FreeSimilarityBatch(SimilarityBatch *batch);
+bool AddFolderToSimilarityIndex(const TCHAR *indexFolder, const TCHAR *rootFolder);
+bool CompactSimilarityIndex(const TCHAR *indexFolder);
+
+#endif
@@ -0,0 +1,87 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "Process_Similarity.h"
+
+#define DEFAULT_RESULT_COUNT 10
+#define MAX_RESULT_COUNT 1000
+
+static double ElapsedMilliseconds(LARGE_INTEGER start) {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)(now.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+// Function to list the indexed processes that look most like a captured process folder
+bool QueryFolder(const TCHAR *indexFolder, const TCHAR *processFolder, size_t k) {
+    LARGE_INTEGER startTime;
+    QueryPerformanceCounter(&startTime);
+
+    SimilarityIndex index;
+    if (!OpenSimilarityIndex(&index, indexFolder)) return false;
+    double openMs = ElapsedMilliseconds(startTime);
+
+    // An indexed, unchanged folder is looked up by its stored signature; anything else is signed now
+    LARGE_INTEGER queryTime;
+    QueryPerformanceCounter(&queryTime);
+    ProcessSignature signature;
+    uint32_t process = UINT32_MAX;
+    uint64_t modified = 0;
+    const IndexedProcess *indexed = FindIndexedProcess(&index, processFolder, &process);
+    if (indexed && process < index.signatureCount && ProcessFeaturesModified(processFolder, &modified) && indexed->modified == modified) {
+        signature = index.signatures[process];
+    } else if (!BuildProcessSignature(processFolder, &signature)) {
+        _tprintf(_T("No modules, strings or transcript found in %s\n"), processFolder);
+        CloseSimilarityIndex(&index);
+        return false;
+    }
+
+    SimilarProcess *results = (SimilarProcess *)malloc(k * sizeof(SimilarProcess));
+    size_t candidateCount = 0;
+    size_t resultCount = results ? QuerySimilarProcesses(&index, &signature, process, results, k, &candidateCount) : 0;
+    double queryMs = ElapsedMilliseconds(queryTime);
+
+    for (size_t i = 0; i < resultCount; i++) {
+        _tprintf(_T("%.3f  %s\n"), results[i].similarity, index.processes[results[i].process].path);
+    }
+    _tprintf(_T("%u similar processes (%u candidates of %u indexed, %u band segments) - open %.2f ms, query %.2f ms\n"),
+             (unsigned)resultCount, (unsigned)candidateCount, index.signatureCount, (unsigned)index.segmentCount, openMs, queryMs);
+
+    free(results);
+    CloseSimilarityIndex(&index);
+    return results != NULL;
+}
+
+void PrintUsage(const TCHAR *program) {
+    _tprintf(_T("Usage:\n"));
+    _tprintf(_T("  %s add <folder> [index folder]                  Sign new or changed process folders under folder\n"), program);
+    _tprintf(_T("  %s query <process folder> [k] [index folder]    List the k most similar indexed processes (default %d)\n"), program, DEFAULT_RESULT_COUNT);
+    _tprintf(_T("  %s compact [index folder]                       Merge all band segments into one\n"), program);
+}
+
+int _tmain(int argc, TCHAR *argv[]) {
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    bool ok;
+    if (_tcscmp(argv[1], _T("add")) == 0 && argc >= 3) {
+        ok = AddFolderToSimilarityIndex(argc >= 4 ? argv[3] : SIMILARITY_DEFAULT_INDEX_FOLDER, argv[2]);
+    } else if (_tcscmp(argv[1], _T("query")) == 0 && argc >= 3) {
+        int k = argc >= 4 ? _ttoi(argv[3]) : DEFAULT_RESULT_COUNT;
+        if (k <= 0 || k > MAX_RESULT_COUNT) k = DEFAULT_RESULT_COUNT;
+        ok = QueryFolder(argc >= 5 ? argv[4] : SIMILARITY_DEFAULT_INDEX_FOLDER, argv[2], (size_t)k);
+    } else if (_tcscmp(argv[1], _T("compact")) == 0) {
+        ok = CompactSimilarityIndex(argc >= 3 ? argv[2] : SIMILARITY_DEFAULT_INDEX_FOLDER);
+    } else {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
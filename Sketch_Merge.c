@@ -0,0 +1,157 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <tchar.h>
+#include <stdbool.h>
+#include "Fleet_Sketch.h"
+
+#define DEFAULT_TOP_COUNT 20
+
+// Combines and inspects fleet sketches:
+//   Sketch_Merge.exe merge <output.sketch> <input.sketch | folder>...
+//   Sketch_Merge.exe show <sketch> [top count]
+//   Sketch_Merge.exe query <sketch> <strings|modules|processes> <key>
+//   Sketch_Merge.exe build <windbg_outputs folder> <output.sketch>
+
+// Function to merge one sketch file into the running total
+static bool MergeSketchFile(FleetSketch *merged, const TCHAR *fileName) {
+    FleetSketch *input = CreateFleetSketch();
+    bool ok = input && LoadFleetSketch(input, fileName);
+    if (ok) {
+        MergeFleetSketch(merged, input);
+    } else {
+        _tprintf(_T("Skipping unreadable sketch %s\n"), fileName);
+    }
+    free(input);
+    return ok;
+}
+
+// Function to merge a file, or every *.sketch file in a folder
+static int MergeSketchPath(FleetSketch *merged, const TCHAR *path) {
+    DWORD attributes = GetFileAttributes(path);
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return MergeSketchFile(merged, path) ? 1 : 0;
+    }
+
+    TCHAR pattern[MAX_PATH];
+    TCHAR fileName[MAX_PATH];
+    WIN32_FIND_DATA findData;
+    int count = 0;
+    _stprintf(pattern, _T("%s\\*%s"), path, FLEET_SKETCH_EXTENSION);
+    HANDLE hFind = FindFirstFile(pattern, &findData);
+    if (hFind == INVALID_HANDLE_VALUE) return 0;
+    do {
+        _stprintf(fileName, _T("%s\\%s"), path, findData.cFileName);
+        if (MergeSketchFile(merged, fileName)) count++;
+    } while (FindNextFile(hFind, &findData));
+    FindClose(hFind);
+    return count;
+}
+
+// Function to rebuild a sketch from an existing windbg_outputs folder of "<pid>_<name>" process folders
+static int BuildSketch(FleetSketch *sketch, const TCHAR *outputsFolder) {
+    TCHAR pattern[MAX_PATH];
+    TCHAR processFolder[MAX_PATH];
+    WIN32_FIND_DATA findData;
+    int count = 0;
+    _stprintf(pattern, _T("%s\\*"), outputsFolder);
+    HANDLE hFind = FindFirstFile(pattern, &findData);
+    if (hFind == INVALID_HANDLE_VALUE) return 0;
+    do {
+        const TCHAR *separator = _tcschr(findData.cFileName, _T('_'));
+        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !separator ||
+            !_istdigit(findData.cFileName[0])) {
+            continue;
+        }
+        _stprintf(processFolder, _T("%s\\%s"), outputsFolder, findData.cFileName);
+        AddProcessToFleetSketch(sketch, processFolder, separator + 1);
+        count++;
+    } while (FindNextFile(hFind, &findData));
+    FindClose(hFind);
+    return count;
+}
+
+int _tmain(int argc, TCHAR *argv[]) {
+    if (argc >= 4 && _tcscmp(argv[1], _T("merge")) == 0) {
+        FleetSketch *merged = CreateFleetSketch();
+        if (!merged) return 1;
+        merged->sources = 0;
+        int inputs = 0;
+        DWORD start = GetTickCount();
+        for (int i = 3; i < argc; i++) {
+            inputs += MergeSketchPath(merged, argv[i]);
+        }
+        bool ok = inputs > 0 && SaveFleetSketch(merged, argv[2]);
+        _tprintf(_T("Merged %d sketches (%u runs, %u processes) into %s in %lu ms\n"),
+                 inputs, merged->sources, merged->processes, argv[2], (unsigned long)(GetTickCount() - start));
+        free(merged);
+        return ok ? 0 : 1;
+    }
+
+    if (argc >= 3 && _tcscmp(argv[1], _T("show")) == 0) {
+        FleetSketch *sketch = CreateFleetSketch();
+        if (!sketch || !LoadFleetSketch(sketch, argv[2])) {
+            _tprintf(_T("Failed to read sketch %s\n"), argv[2]);
+            free(sketch);
+            return 1;
+        }
+        PrintFleetSketch(sketch, argc >= 4 ? (uint32_t)_ttoi(argv[3]) : DEFAULT_TOP_COUNT);
+        free(sketch);
+        return 0;
+    }
+
+    if (argc == 5 && _tcscmp(argv[1], _T("query")) == 0) {
+        FleetSketch *sketch = CreateFleetSketch();
+        if (!sketch || !LoadFleetSketch(sketch, argv[2])) {
+            _tprintf(_T("Failed to read sketch %s\n"), argv[2]);
+            free(sketch);
+            return 1;
+        }
+        int table = -1;
+        char tableName[SKETCH_NAME_SIZE];
+        char key[SKETCH_TOPK_KEY_SIZE * 4];
+#ifdef UNICODE
+        WideCharToMultiByte(CP_UTF8, 0, argv[3], -1, tableName, sizeof(tableName), NULL, NULL);
+        WideCharToMultiByte(CP_UTF8, 0, argv[4], -1, key, sizeof(key), NULL, NULL);
+#else
+        snprintf(tableName, sizeof(tableName), "%s", argv[3]);
+        snprintf(key, sizeof(key), "%s", argv[4]);
+#endif
+        for (int i = 0; i < FLEET_CMS_COUNT; i++) {
+            if (strcmp(sketch->frequencies[i].name, tableName) == 0) table = i;
+        }
+        if (table < 0) {
+            _tprintf(_T("Unknown table %s (strings, modules or processes)\n"), argv[3]);
+            free(sketch);
+            return 1;
+        }
+        // Module and process keys are stored case-folded
+        if (table != FLEET_CMS_STRINGS) {
+            for (char *p = key; *p; p++) *p = (char)tolower((unsigned char)*p);
+        }
+        _tprintf(_T("%s: %llu (at most this many; overestimate bound %.0f)\n"), argv[4],
+                 (unsigned long long)CountMinEstimate(&sketch->frequencies[table], key, strlen(key)),
+                 2.718281828 / SKETCH_CMS_WIDTH * (double)sketch->frequencies[table].total);
+        free(sketch);
+        return 0;
+    }
+
+    if (argc == 4 && _tcscmp(argv[1], _T("build")) == 0) {
+        FleetSketch *sketch = CreateFleetSketch();
+        if (!sketch) return 1;
+        int processes = BuildSketch(sketch, argv[2]);
+        bool ok = SaveFleetSketch(sketch, argv[3]);
+        _tprintf(_T("Sketched %d process folders from %s into %s\n"), processes, argv[2], argv[3]);
+        free(sketch);
+        return ok ? 0 : 1;
+    }
+
+    _tprintf(_T("Usage:\n"));
+    _tprintf(_T("  %s merge <output.sketch> <input.sketch | folder>...\n"), argv[0]);
+    _tprintf(_T("  %s show <sketch> [top count]\n"), argv[0]);
+    _tprintf(_T("  %s query <sketch> <strings|modules|processes> <key>\n"), argv[0]);
+    _tprintf(_T("  %s build <windbg_outputs folder> <output.sketch>\n"), argv[0]);
+    return 1;
+}
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "Sweep_Journal.h"
+
+#define SWEEP_HEADER_MAGIC 0x4C4A5753   // "SWJL"
+#define SWEEP_RECORD_MAGIC 0x52434553   // "SECR"
+#define SWEEP_JOURNAL_VERSION 1
+#define SWEEP_FLAG_COMPLETE 0x1         // Set by compaction once the sweep has finished
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t recordSize;
+    uint64_t sweepStart;
+    uint32_t reserved;
+    uint32_t crc;
+} SweepHeader;
+
+static uint32_t crcTable[256];
+static bool crcTableReady = false;
+
+static void InitCrcTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crcTable[i] = c;
+    }
+    crcTableReady = true;
+}
+
+// Function to compute the CRC-32 (IEEE) of a buffer
+static uint32_t Crc32(const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t c = 0xFFFFFFFFu;
+    if (!crcTableReady) InitCrcTable();
+    for (size_t i = 0; i < size; i++) {
+        c = crcTable[(c ^ bytes[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+static uint64_t CurrentFileTime(void) {
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    return ((uint64_t)now.dwHighDateTime << 32) | now.dwLowDateTime;
+}
+
+static bool WriteAll(HANDLE hFile, const void *data, DWORD size) {
+    DWORD written;
+    return WriteFile(hFile, data, size, &written, NULL) && written == size;
+}
+
+static bool WriteHeader(HANDLE hFile, uint64_t sweepStart, uint32_t flags) {
+    SweepHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SWEEP_HEADER_MAGIC;
+    header.version = SWEEP_JOURNAL_VERSION;
+    header.flags = flags;
+    header.recordSize = sizeof(SweepRecord);
+    header.sweepStart = sweepStart;
+    header.crc = Crc32(&header, offsetof(SweepHeader, crc));
+    return WriteAll(hFile, &header, sizeof(header));
+}
+
+static void FillRecord(SweepRecord *record, const SweepEntry *entry) {
+    memset(record, 0, sizeof(*record));
+    record->magic = SWEEP_RECORD_MAGIC;
+    record->pid = entry->pid;
+    record->creationTime = entry->creationTime;
+    record->state = entry->state;
+    record->attempts = entry->attempts;
+    record->crc = Crc32(record, offsetof(SweepRecord, crc));
+}
+
+// Function to mix a PID and creation time into a slot hash; PIDs are small multiples of 4, so both need spreading
+static uint64_t EntryHash(uint32_t pid, uint64_t creationTime) {
+    uint64_t hash = creationTime ^ ((uint64_t)pid * 0x9E3779B97F4A7C15ULL);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Function to double the slot table and rehash every entry
+static bool GrowEntrySlots(SweepJournal *journal) {
+    size_t slotCount = journal->slotCount ? journal->slotCount * 2 : 1024;
+    uint32_t *slots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+    if (!slots) return false;
+    for (size_t i = 0; i < journal->entryCount; i++) {
+        size_t slot = EntryHash(journal->entries[i].pid, journal->entries[i].creationTime) & (slotCount - 1);
+        while (slots[slot]) slot = (slot + 1) & (slotCount - 1);
+        slots[slot] = (uint32_t)(i + 1);
+    }
+    free(journal->slots);
+    journal->slots = slots;
+    journal->slotCount = slotCount;
+    return true;
+}
+
+static SweepEntry *AddSweepEntry(SweepJournal *journal, uint32_t pid, uint64_t creationTime) {
+    if ((journal->entryCount + 1) * 2 > journal->slotCount && !GrowEntrySlots(journal)) return NULL;
+    if (journal->entryCount == journal->entryCapacity) {
+        size_t capacity = journal->entryCapacity ? journal->entryCapacity * 2 : 256;
+        SweepEntry *entries = (SweepEntry *)realloc(journal->entries, capacity * sizeof(SweepEntry));
+        if (!entries) return NULL;
+        journal->entries = entries;
+        journal->entryCapacity = capacity;
+    }
+    SweepEntry *entry = &journal->entries[journal->entryCount];
+    entry->pid = pid;
+    entry->creationTime = creationTime;
+    entry->state = 0;
+    entry->attempts = 0;
+
+    size_t slot = EntryHash(pid, creationTime) & (journal->slotCount - 1);
+    while (journal->slots[slot]) slot = (slot + 1) & (journal->slotCount - 1);
+    journal->slots[slot] = (uint32_t)(++journal->entryCount);
+    return entry;
+}
+
+SweepEntry *FindSweepEntry(SweepJournal *journal, uint32_t pid, uint64_t creationTime) {
+    if (journal->slotCount == 0) return NULL;
+    size_t mask = journal->slotCount - 1;
+    for (size_t slot = EntryHash(pid, creationTime) & mask; journal->slots[slot]; slot = (slot + 1) & mask) {
+        SweepEntry *entry = &journal->entries[journal->slots[slot] - 1];
+        if (entry->pid == pid && entry->creationTime == creationTime) return entry;
+    }
+    return NULL;
+}
+
+// Function to truncate the journal and start a new sweep
+static bool StartNewSweep(SweepJournal *journal) {
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    journal->entryCount = 0;
+    if (journal->slots) memset(journal->slots, 0, journal->slotCount * sizeof(uint32_t));
+    journal->resumed = false;
+    journal->sweepStart = CurrentFileTime();
+    return SetFilePointerEx(journal->hFile, zero, NULL, FILE_BEGIN) &&
+           SetEndOfFile(journal->hFile) &&
+           WriteHeader(journal->hFile, journal->sweepStart, 0) &&
+           FlushFileBuffers(journal->hFile);
+}
+
+// Function to open the journal, replaying an unfinished sweep or starting a new one
+bool OpenSweepJournal(SweepJournal *journal, const TCHAR *path) {
+    memset(journal, 0, sizeof(*journal));
+    _tcsncpy(journal->path, path, MAX_PATH - 1);
+    journal->hFile = CreateFile(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (journal->hFile == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    SweepHeader header;
+    DWORD bytesRead;
+    if (!GetFileSizeEx(journal->hFile, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(header) ||
+        !ReadFile(journal->hFile, &header, sizeof(header), &bytesRead, NULL) || bytesRead != sizeof(header) ||
+        header.magic != SWEEP_HEADER_MAGIC || header.version != SWEEP_JOURNAL_VERSION ||
+        header.recordSize != sizeof(SweepRecord) || header.crc != Crc32(&header, offsetof(SweepHeader, crc)) ||
+        (header.flags & SWEEP_FLAG_COMPLETE)) {
+        return StartNewSweep(journal);
+    }
+
+    // Replay the record log; the first damaged record marks where an append was cut short
+    size_t bodySize = (size_t)(fileSize.QuadPart - sizeof(header));
+    uint8_t *body = (uint8_t *)malloc(bodySize ? bodySize : 1);
+    if (!body || !ReadFile(journal->hFile, body, (DWORD)bodySize, &bytesRead, NULL) || bytesRead != bodySize) {
+        free(body);
+        return StartNewSweep(journal);
+    }
+    size_t offset = 0;
+    while (offset + sizeof(SweepRecord) <= bodySize) {
+        SweepRecord record;
+        memcpy(&record, body + offset, sizeof(record));
+        if (record.magic != SWEEP_RECORD_MAGIC || record.crc != Crc32(&record, offsetof(SweepRecord, crc))) break;
+
+        SweepEntry *entry = FindSweepEntry(journal, record.pid, record.creationTime);
+        if (!entry) entry = AddSweepEntry(journal, record.pid, record.creationTime);
+        if (!entry) break;
+        entry->state = record.state;
+        entry->attempts = record.attempts;
+        journal->recordsReplayed++;
+        offset += sizeof(SweepRecord);
+    }
+    free(body);
+
+    LARGE_INTEGER validEnd;
+    validEnd.QuadPart = (LONGLONG)(sizeof(header) + offset);
+    journal->tornBytes = bodySize - offset;
+    journal->sweepStart = header.sweepStart;
+    journal->resumed = true;
+    return SetFilePointerEx(journal->hFile, validEnd, NULL, FILE_BEGIN) && SetEndOfFile(journal->hFile);
+}
+
+// Function to append one write-ahead record in the batch buffer.
+// Attaching is flushed at once: it must be durable before a debugger touches the process.
+bool RecordSweepState(SweepJournal *journal, uint32_t pid, uint64_t creationTime, SweepState state) {
+    SweepEntry *entry = FindSweepEntry(journal, pid, creationTime);
+    if (!entry) entry = AddSweepEntry(journal, pid, creationTime);
+    if (!entry) return false;
+    entry->state = state;
+    if (state == SWEEP_ATTACHING) entry->attempts++;
+
+    if (journal->pendingCount == SWEEP_JOURNAL_BATCH && !FlushSweepJournal(journal)) return false;
+    FillRecord(&journal->pending[journal->pendingCount++], entry);
+    if (state == SWEEP_ATTACHING) return FlushSweepJournal(journal);
+    return true;
+}
+
+// Function to write the buffered records with a single write and fsync
+bool FlushSweepJournal(SweepJournal *journal) {
+    if (journal->pendingCount == 0) return true;
+    DWORD size = (DWORD)(journal->pendingCount * sizeof(SweepRecord));
+    if (!WriteAll(journal->hFile, journal->pending, size) || !FlushFileBuffers(journal->hFile)) return false;
+    journal->pendingCount = 0;
+    return true;
+}
+
+size_t CountSweepEntries(const SweepJournal *journal, SweepState state) {
+    size_t count = 0;
+    for (size_t i = 0; i < journal->entryCount; i++) {
+        if (journal->entries[i].state == (uint32_t)state) count++;
+    }
+    return count;
+}
+
+// Function to rewrite the journal as one record per process and mark the sweep complete
+bool CompactSweepJournal(SweepJournal *journal) {
+    TCHAR temporaryPath[MAX_PATH + 8];
+    _stprintf(temporaryPath, _T("%s.tmp"), journal->path);
+    if (!FlushSweepJournal(journal)) return false;
+
+    HANDLE hTemporary = CreateFile(temporaryPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hTemporary == INVALID_HANDLE_VALUE) return false;
+    bool ok = WriteHeader(hTemporary, journal->sweepStart, SWEEP_FLAG_COMPLETE);
+    for (size_t i = 0; ok && i < journal->entryCount; i++) {
+        SweepRecord record;
+        FillRecord(&record, &journal->entries[i]);
+        ok = WriteAll(hTemporary, &record, sizeof(record));
+    }
+    ok = ok && FlushFileBuffers(hTemporary);
+    CloseHandle(hTemporary);
+
+    // The old log stays authoritative until the compacted copy has fully replaced it
+    CloseHandle(journal->hFile);
+    journal->hFile = INVALID_HANDLE_VALUE;
+    if (!ok || !MoveFileEx(temporaryPath, journal->path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFile(temporaryPath);
+        return false;
+    }
+    return true;
+}
+
+void CloseSweepJournal(SweepJournal *journal) {
+    if (journal->hFile != INVALID_HANDLE_VALUE && journal->hFile != NULL) {
+        FlushSweepJournal(journal);
+        CloseHandle(journal->hFile);
+    }
+    journal->hFile = INVALID_HANDLE_VALUE;
+    free(journal->entries);
+    free(journal->slots);
+    journal->entries = NULL;
+    journal->slots = NULL;
+    journal->entryCount = journal->entryCapacity = journal->slotCount = 0;
+}
+
+const TCHAR *SweepStateName(uint32_t state) {
+    switch (state) {
+    case SWEEP_QUEUED:     return _T("queued");
+    case SWEEP_ATTACHING:  return _T("attaching");
+    case SWEEP_CAPTURED:   return _T("captured");
+    case SWEEP_CLASSIFIED: return _T("classified");
+    default:               return _T("unknown");
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef SWEEP_JOURNAL_H
+#define SWEEP_JOURNAL_H
+
+#include <windows.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+
+#define SWEEP_JOURNAL_FILE _T("sweep_journal.wal")
+#define SWEEP_JOURNAL_BATCH 64          // Buffered records before a forced flush
+#define SWEEP_MAX_ATTACH_ATTEMPTS 3     // Across restarts: a PID that keeps killing the analyzer is given up on
+
+typedef enum {
+    SWEEP_QUEUED = 1,
+    SWEEP_ATTACHING = 2,
+    SWEEP_CAPTURED = 3,
+    SWEEP_CLASSIFIED = 4
+} SweepState;
+
+// Fixed-size on-disk record; the CRC covers every preceding byte so torn writes are detected
+typedef struct {
+    uint32_t magic;
+    uint32_t pid;
+    uint64_t creationTime;              // FILETIME of process creation; tells reused PIDs apart
+    uint32_t state;
+    uint32_t attempts;
+    uint32_t reserved;
+    uint32_t crc;
+} SweepRecord;
+
+typedef struct {
+    uint32_t pid;
+    uint64_t creationTime;
+    uint32_t state;
+    uint32_t attempts;
+} SweepEntry;
+
+// Write-ahead journal of per-process sweep progress
+typedef struct {
+    HANDLE hFile;
+    TCHAR path[MAX_PATH];
+    uint64_t sweepStart;
+    SweepEntry *entries;
+    size_t entryCount;
+    size_t entryCapacity;
+    uint32_t *slots;                    // Open-addressing table of entry index + 1 keyed by PID and creation time
+    size_t slotCount;
+    SweepRecord pending[SWEEP_JOURNAL_BATCH];
+    size_t pendingCount;
+    bool resumed;                       // Opened an unfinished sweep
+    uint64_t recordsReplayed;
+    uint64_t tornBytes;                 // Discarded tail from an interrupted append
+} SweepJournal;
+
+bool OpenSweepJournal(SweepJournal *journal, const TCHAR *path);
+SweepEntry *FindSweepEntry(SweepJournal *journal, uint32_t pid, uint64_t creationTime);
+bool RecordSweepState(SweepJournal *journal, uint32_t pid, uint64_t creationTime, SweepState state);
+bool FlushSweepJournal(SweepJournal *journal);
+size_t CountSweepEntries(const SweepJournal *journal, SweepState state);
+bool CompactSweepJournal(SweepJournal *journal);
+void CloseSweepJournal(SweepJournal *journal);
+const TCHAR *SweepStateName(uint32_t state);
+
+#endif
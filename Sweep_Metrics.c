@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Sweep_Metrics.h"
+
+#define DEBUGGER_TIME_PREFIX "Debugger (not debuggee) time:"
+#define MAX_COMMAND_SECONDS 86400   // Gaps longer than a day are clock jumps, not command latency
+
+static CRITICAL_SECTION metricsLock;
+static bool metricsReady = false;
+static char metricsTool[METRIC_NAME_SIZE];
+static time_t metricsStarted;
+static LARGE_INTEGER timerFrequency;
+static LatencyHistogram histograms[METRIC_MAX_HISTOGRAMS];
+static size_t histogramCount = 0;
+static MetricCounter counters[METRIC_MAX_COUNTERS];
+static size_t counterCount = 0;
+
+void InitMetrics(const char *toolName) {
+    if (!metricsReady) {
+        InitializeCriticalSection(&metricsLock);
+        metricsReady = true;
+    }
+    EnterCriticalSection(&metricsLock);
+    snprintf(metricsTool, sizeof(metricsTool), "%s", toolName);
+    metricsStarted = time(NULL);
+    QueryPerformanceFrequency(&timerFrequency);
+    histogramCount = 0;
+    counterCount = 0;
+    LeaveCriticalSection(&metricsLock);
+}
+
+static int BucketIndex(uint64_t value) {
+    if (value < 2 * METRIC_SUB_BUCKETS) return (int)value;
+    int msb = 63;
+    while (!(value >> msb)) msb--;
+    int shift = msb - METRIC_SUB_BUCKET_BITS;
+    return shift * METRIC_SUB_BUCKETS + (int)(value >> shift);
+}
+
+// Largest value that falls in a bucket; used as the Prometheus "le" bound
+static uint64_t BucketUpperBound(int index) {
+    if (index < 2 * METRIC_SUB_BUCKETS) return (uint64_t)index;
+    int shift = index / METRIC_SUB_BUCKETS - 1;
+    uint64_t sub = (uint64_t)(index % METRIC_SUB_BUCKETS + METRIC_SUB_BUCKETS);
+    return ((sub + 1) << shift) - 1;
+}
+
+// Caller holds the lock; the registry is append-only so a full table drops new names
+static LatencyHistogram *FindHistogram(MetricFamily family, const char *name) {
+    for (size_t i = 0; i < histogramCount; i++) {
+        if (histograms[i].family == family && strcmp(histograms[i].name, name) == 0) return &histograms[i];
+    }
+    if (histogramCount == METRIC_MAX_HISTOGRAMS) return NULL;
+    LatencyHistogram *histogram = &histograms[histogramCount++];
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->family = family;
+    histogram->min = UINT64_MAX;
+    snprintf(histogram->name, sizeof(histogram->name), "%s", name);
+    return histogram;
+}
+
+MetricTimer BeginMetricTimer(void) {
+    MetricTimer timer;
+    QueryPerformanceCounter(&timer.start);
+    return timer;
+}
+
+// Function to stop a stage timer and record its latency in microseconds
+uint64_t EndMetricTimer(MetricTimer timer, const char *stage) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    uint64_t ticks = (uint64_t)(now.QuadPart - timer.start.QuadPart);
+    uint64_t frequency = timerFrequency.QuadPart > 0 ? (uint64_t)timerFrequency.QuadPart : 1;
+    uint64_t microseconds = ticks / frequency * 1000000 + ticks % frequency * 1000000 / frequency;
+    RecordLatency(METRIC_STAGE, stage, microseconds);
+    return microseconds;
+}
+
+void RecordLatency(MetricFamily family, const char *name, uint64_t microseconds) {
+    if (!metricsReady) return;
+    EnterCriticalSection(&metricsLock);
+    LatencyHistogram *histogram = FindHistogram(family, name);
+    if (histogram) {
+        histogram->buckets[BucketIndex(microseconds)]++;
+        histogram->count++;
+        histogram->sum += microseconds;
+        if (microseconds < histogram->min) histogram->min = microseconds;
+        if (microseconds > histogram->max) histogram->max = microseconds;
+    }
+    LeaveCriticalSection(&metricsLock);
+}
+
+void AddMetricCounter(const char *name, uint64_t value) {
+    if (!metricsReady) return;
+    EnterCriticalSection(&metricsLock);
+    MetricCounter *counter = NULL;
+    for (size_t i = 0; i < counterCount; i++) {
+        if (strcmp(counters[i].name, name) == 0) {
+            counter = &counters[i];
+            break;
+        }
+    }
+    if (!counter && counterCount < METRIC_MAX_COUNTERS) {
+        counter = &counters[counterCount++];
+        snprintf(counter->name, sizeof(counter->name), "%s", name);
+        counter->value = 0;
+    }
+    if (counter) counter->value += value;
+    LeaveCriticalSection(&metricsLock);
+}
+
+uint64_t LatencyPercentile(const LatencyHistogram *histogram, double percentile) {
+    if (histogram->count == 0) return 0;
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.999999);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t bound = BucketUpperBound(i);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+// Function to read a ".echotime" line as milliseconds; only differences between lines are used
+static bool ParseDebuggerTime(const char *line, int64_t *milliseconds) {
+    static const char *months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char month[4];
+    int day, hour, minute, second, millisecond = 0;
+    const char *text = strstr(line, DEBUGGER_TIME_PREFIX);
+    if (!text) return false;
+    int fields = sscanf(text + strlen(DEBUGGER_TIME_PREFIX), " %*s %3s %d %d:%d:%d.%d",
+                        month, &day, &hour, &minute, &second, &millisecond);
+    if (fields < 5) return false;
+    const char *found = strstr(months, month);
+    int monthIndex = found ? (int)(found - months) / 3 : 0;
+    *milliseconds = ((((int64_t)monthIndex * 31 + day) * 24 + hour) * 60 + minute) * 60000 + second * 1000 + millisecond;
+    return true;
+}
+
+// Function to turn "=== Section ===" headers followed by ".echotime" stamps into per-command latencies
+size_t RecordDebuggerCommandTimings(const TCHAR *transcriptFileName) {
+    FILE *transcript = _tfopen(transcriptFileName, _T("rb"));
+    if (!transcript) return 0;
+
+    char line[1024];
+    char pendingCommand[METRIC_NAME_SIZE] = "";
+    char runningCommand[METRIC_NAME_SIZE] = "";
+    int64_t runningSince = 0;
+    size_t recorded = 0;
+
+    while (fgets(line, sizeof(line), transcript)) {
+        char *header = strstr(line, "=== ");
+        char *end = header ? strstr(header + 4, " ===") : NULL;
+        int64_t now;
+        if (header && end) {
+            size_t length = (size_t)(end - (header + 4));
+            if (length >= METRIC_NAME_SIZE) length = METRIC_NAME_SIZE - 1;
+            memcpy(pendingCommand, header + 4, length);
+            pendingCommand[length] = '\0';
+        } else if (ParseDebuggerTime(line, &now)) {
+            // A stamp closes the previous command and opens the one announced by the last header
+            if (runningCommand[0] && now >= runningSince && now - runningSince <= (int64_t)MAX_COMMAND_SECONDS * 1000) {
+                RecordLatency(METRIC_COMMAND, runningCommand, (uint64_t)(now - runningSince) * 1000);
+                recorded++;
+            }
+            memcpy(runningCommand, pendingCommand, sizeof(runningCommand));
+            runningSince = now;
+        }
+    }
+    fclose(transcript);
+    return recorded;
+}
+
+static void WriteEscaped(FILE *file, const char *text) {
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') {
+            fputc('\\', file);
+            fputc(*text, file);
+        } else if (*text == '\n') {
+            fputs("\\n", file);
+        } else if ((unsigned char)*text >= 0x20) {
+            fputc(*text, file);
+        }
+    }
+}
+
+static void WritePrometheusHistograms(FILE *file, MetricFamily family, const char *metric, const char *label, const char *help) {
+    fprintf(file, "# HELP %s %s\n# TYPE %s histogram\n", metric, help, metric);
+    for (size_t i = 0; i < histogramCount; i++) {
+        const LatencyHistogram *histogram = &histograms[i];
+        if (histogram->family != family) continue;
+
+        // Cumulative counts at the bounds of occupied buckets only; the exposition needs no empty ones
+        uint64_t cumulative = 0;
+        for (int b = 0; b < METRIC_HISTOGRAM_BUCKETS; b++) {
+            if (!histogram->buckets[b]) continue;
+            cumulative += histogram->buckets[b];
+            fprintf(file, "%s_bucket{tool=\"%s\",%s=\"", metric, metricsTool, label);
+            WriteEscaped(file, histogram->name);
+            fprintf(file, "\",le=\"%llu\"} %llu\n", (unsigned long long)BucketUpperBound(b), (unsigned long long)cumulative);
+        }
+        const char *suffixes[] = { "_bucket", "_sum", "_count" };
+        uint64_t values[] = { histogram->count, histogram->sum, histogram->count };
+        for (int s = 0; s < 3; s++) {
+            fprintf(file, "%s%s{tool=\"%s\",%s=\"", metric, suffixes[s], metricsTool, label);
+            WriteEscaped(file, histogram->name);
+            fprintf(file, s == 0 ? "\",le=\"+Inf\"} %llu\n" : "\"} %llu\n", (unsigned long long)values[s]);
+        }
+    }
+}
+
+static void WriteJsonHistograms(FILE *file, MetricFamily family) {
+    bool first = true;
+    for (size_t i = 0; i < histogramCount; i++) {
+        const LatencyHistogram *histogram = &histograms[i];
+        if (histogram->family != family) continue;
+        fprintf(file, "%s\n    \"", first ? "" : ",");
+        WriteEscaped(file, histogram->name);
+        fprintf(file, "\": {\"count\": %llu, \"sum_us\": %llu, \"min_us\": %llu, \"mean_us\": %llu, "
+                      "\"p50_us\": %llu, \"p90_us\": %llu, \"p99_us\": %llu, \"max_us\": %llu}",
+                (unsigned long long)histogram->count, (unsigned long long)histogram->sum,
+                (unsigned long long)(histogram->count ? histogram->min : 0),
+                (unsigned long long)(histogram->count ? histogram->sum / histogram->count : 0),
+                (unsigned long long)LatencyPercentile(histogram, 50.0),
+                (unsigned long long)LatencyPercentile(histogram, 90.0),
+                (unsigned long long)LatencyPercentile(histogram, 99.0),
+                (unsigned long long)histogram->max);
+        first = false;
+    }
+    fprintf(file, first ? "}" : "\n  }");
+}
+
+// Function to write a file next to its final name and swap it in, so scrapers never see a partial file
+static bool WriteMetricsFile(const TCHAR *outputFolder, const TCHAR *fileName, bool prometheus) {
+    TCHAR finalName[MAX_PATH];
+    TCHAR temporaryName[MAX_PATH + 8];
+    _stprintf(finalName, _T("%s\\%s"), outputFolder, fileName);
+    _stprintf(temporaryName, _T("%s.tmp"), finalName);
+
+    FILE *file = _tfopen(temporaryName, _T("wb"));
+    if (!file) return false;
+    time_t now = time(NULL);
+
+    if (prometheus) {
+        WritePrometheusHistograms(file, METRIC_STAGE, "sweep_stage_latency_microseconds", "stage",
+                                  "Latency of sweep stages in microseconds.");
+        WritePrometheusHistograms(file, METRIC_COMMAND, "sweep_debugger_command_latency_microseconds", "command",
+                                  "Latency of debugger commands in microseconds, from .echotime stamps.");
+        for (size_t i = 0; i < counterCount; i++) {
+            fprintf(file, "# TYPE sweep_%s_total counter\nsweep_%s_total{tool=\"%s\"} %llu\n",
+                    counters[i].name, counters[i].name, metricsTool, (unsigned long long)counters[i].value);
+        }
+        fprintf(file, "# TYPE sweep_uptime_seconds gauge\nsweep_uptime_seconds{tool=\"%s\"} %lld\n",
+                metricsTool, (long long)(now - metricsStarted));
+    } else {
+        fprintf(file, "{\n  \"tool\": \"%s\",\n  \"started\": %lld,\n  \"exported\": %lld,\n  \"elapsed_seconds\": %lld,\n  \"counters\": {",
+                metricsTool, (long long)metricsStarted, (long long)now, (long long)(now - metricsStarted));
+        for (size_t i = 0; i < counterCount; i++) {
+            fprintf(file, "%s\n    \"%s\": %llu", i ? "," : "", counters[i].name, (unsigned long long)counters[i].value);
+        }
+        fprintf(file, counterCount ? "\n  },\n  \"stages\": {" : "},\n  \"stages\": {");
+        WriteJsonHistograms(file, METRIC_STAGE);
+        fprintf(file, ",\n  \"debugger_commands\": {");
+        WriteJsonHistograms(file, METRIC_COMMAND);
+        fprintf(file, "\n}\n");
+    }
+
+    bool ok = fclose(file) == 0;
+    return ok && MoveFileEx(temporaryName, finalName, MOVEFILE_REPLACE_EXISTING);
+}
+
+// Function to export every histogram and counter as Prometheus text and a JSON run report
+bool ExportMetrics(const TCHAR *outputFolder) {
+    if (!metricsReady) return false;
+    EnterCriticalSection(&metricsLock);
+    bool ok = WriteMetricsFile(outputFolder, METRICS_PROMETHEUS_FILE, true);
+    ok = WriteMetricsFile(outputFolder, METRICS_REPORT_FILE, false) && ok;
+    LeaveCriticalSection(&metricsLock);
+    return ok;
+}
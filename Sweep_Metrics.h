@@ -0,0 +1,54 @@
+#ifndef SWEEP_METRICS_H
+#define SWEEP_METRICS_H
+
+#include <windows.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <tchar.h>
+
+#define METRICS_PROMETHEUS_FILE _T("metrics.prom")
+#define METRICS_REPORT_FILE _T("run_report.json")
+#define METRICS_EXPORT_INTERVAL_MS 60000    // Periodic export from long-running loops
+
+// Log-linear latency buckets: exact below 32 us, then 16 sub-buckets per power of two (<= 6.25% error)
+#define METRIC_SUB_BUCKET_BITS 4
+#define METRIC_SUB_BUCKETS (1 << METRIC_SUB_BUCKET_BITS)
+#define METRIC_HISTOGRAM_BUCKETS (61 * METRIC_SUB_BUCKETS)
+#define METRIC_MAX_HISTOGRAMS 128
+#define METRIC_MAX_COUNTERS 64
+#define METRIC_NAME_SIZE 64
+
+typedef enum {
+    METRIC_STAGE = 0,       // Sweep stages: enumeration, attach, copy, classification, ...
+    METRIC_COMMAND = 1      // Individual debugger commands, timed with .echotime
+} MetricFamily;
+
+typedef struct {
+    MetricFamily family;
+    char name[METRIC_NAME_SIZE];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint32_t buckets[METRIC_HISTOGRAM_BUCKETS];
+} LatencyHistogram;
+
+typedef struct {
+    char name[METRIC_NAME_SIZE];
+    uint64_t value;
+} MetricCounter;
+
+typedef struct {
+    LARGE_INTEGER start;
+} MetricTimer;
+
+void InitMetrics(const char *toolName);
+MetricTimer BeginMetricTimer(void);
+uint64_t EndMetricTimer(MetricTimer timer, const char *stage);
+void RecordLatency(MetricFamily family, const char *name, uint64_t microseconds);
+void AddMetricCounter(const char *name, uint64_t value);
+uint64_t LatencyPercentile(const LatencyHistogram *histogram, double percentile);
+size_t RecordDebuggerCommandTimings(const TCHAR *transcriptFileName);
+bool ExportMetrics(const TCHAR *outputFolder);
+
+#endif
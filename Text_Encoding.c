@@ -0,0 +1,264 @@
+#include <string.h>
+#include "Text_Encoding.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXT_USE_SSE2 1
+#endif
+
+#define REPLACEMENT_CHARACTER 0xFFFD
+#define TRANSCODE_BLOCK_UNITS 8192
+
+static uint8_t *PutUtf8(uint8_t *dst, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        *dst++ = (uint8_t)codePoint;
+    } else if (codePoint < 0x800) {
+        *dst++ = (uint8_t)(0xC0 | (codePoint >> 6));
+        *dst++ = (uint8_t)(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        *dst++ = (uint8_t)(0xE0 | (codePoint >> 12));
+        *dst++ = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        *dst++ = (uint8_t)(0x80 | (codePoint & 0x3F));
+    } else {
+        *dst++ = (uint8_t)(0xF0 | (codePoint >> 18));
+        *dst++ = (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F));
+        *dst++ = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        *dst++ = (uint8_t)(0x80 | (codePoint & 0x3F));
+    }
+    return dst;
+}
+
+// Function to convert UTF-16LE to UTF-8; ASCII runs are narrowed 16 units at a time
+size_t Utf16ToUtf8(const uint16_t *src, size_t srcLength, uint8_t *dst) {
+    uint8_t *out = dst;
+    size_t i = 0;
+
+    while (i < srcLength) {
+#ifdef TEXT_USE_SSE2
+        const __m128i nonAsciiMask = _mm_set1_epi16((short)0xFF80);
+        const __m128i zero = _mm_setzero_si128();
+        while (i + 16 <= srcLength) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 8));
+            __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAsciiMask);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF) break;
+            _mm_storeu_si128((__m128i *)out, _mm_packus_epi16(a, b));
+            out += 16;
+            i += 16;
+        }
+        if (i >= srcLength) break;
+#endif
+        uint32_t unit = src[i];
+        if (unit < 0x80) {
+            *out++ = (uint8_t)unit;
+            i++;
+        } else if (unit >= 0xD800 && unit <= 0xDBFF) {
+            if (i + 1 < srcLength && src[i + 1] >= 0xDC00 && src[i + 1] <= 0xDFFF) {
+                uint32_t codePoint = 0x10000 + ((unit - 0xD800) << 10) + (src[i + 1] - 0xDC00);
+                out = PutUtf8(out, codePoint);
+                i += 2;
+            } else {
+                out = PutUtf8(out, REPLACEMENT_CHARACTER);
+                i++;
+            }
+        } else if (unit >= 0xDC00 && unit <= 0xDFFF) {
+            out = PutUtf8(out, REPLACEMENT_CHARACTER);
+            i++;
+        } else {
+            out = PutUtf8(out, unit);
+            i++;
+        }
+    }
+    return (size_t)(out - dst);
+}
+
+// Function to convert UTF-8 to UTF-16LE, replacing each maximal invalid subpart with U+FFFD
+size_t Utf8ToUtf16(const uint8_t *src, size_t srcLength, uint16_t *dst) {
+    uint16_t *out = dst;
+    size_t i = 0;
+
+    while (i < srcLength) {
+#ifdef TEXT_USE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        while (i + 16 <= srcLength) {
+            __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+            if (_mm_movemask_epi8(bytes) != 0) break;
+            _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128((__m128i *)(out + 8), _mm_unpackhi_epi8(bytes, zero));
+            out += 16;
+            i += 16;
+        }
+        if (i >= srcLength) break;
+#endif
+        uint8_t lead = src[i];
+        if (lead < 0x80) {
+            *out++ = lead;
+            i++;
+            continue;
+        }
+
+        size_t needed;
+        uint32_t codePoint;
+        uint8_t lower = 0x80, upper = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            needed = 1;
+            codePoint = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            needed = 2;
+            codePoint = lead & 0x0F;
+            if (lead == 0xE0) lower = 0xA0;         // Overlong
+            if (lead == 0xED) upper = 0x9F;         // Encoded surrogates
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            needed = 3;
+            codePoint = lead & 0x07;
+            if (lead == 0xF0) lower = 0x90;         // Overlong
+            if (lead == 0xF4) upper = 0x8F;         // Above U+10FFFF
+        } else {
+            *out++ = REPLACEMENT_CHARACTER;
+            i++;
+            continue;
+        }
+
+        size_t consumed = 1;
+        bool valid = true;
+        while (consumed <= needed) {
+            if (i + consumed >= srcLength) {
+                valid = false;
+                break;
+            }
+            uint8_t next = src[i + consumed];
+            if (next < lower || next > upper) {
+                valid = false;
+                break;
+            }
+            codePoint = (codePoint << 6) | (next & 0x3F);
+            lower = 0x80;
+            upper = 0xBF;
+            consumed++;
+        }
+        i += consumed;
+
+        if (!valid) {
+            *out++ = REPLACEMENT_CHARACTER;
+        } else if (codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            *out++ = (uint16_t)(0xD800 | (codePoint >> 10));
+            *out++ = (uint16_t)(0xDC00 | (codePoint & 0x3FF));
+        } else {
+            *out++ = (uint16_t)codePoint;
+        }
+    }
+    return (size_t)(out - dst);
+}
+
+// Function to write UTF-16 text to a binary stream as UTF-8 without splitting surrogate pairs
+bool WriteUtf16AsUtf8(FILE *file, const uint16_t *text, size_t length) {
+    static const size_t bufferSize = TRANSCODE_BLOCK_UNITS * UTF8_MAX_PER_UTF16;
+    uint8_t buffer[TRANSCODE_BLOCK_UNITS * UTF8_MAX_PER_UTF16];
+
+    while (length > 0) {
+        size_t units = length < TRANSCODE_BLOCK_UNITS ? length : TRANSCODE_BLOCK_UNITS;
+        if (units < length && text[units - 1] >= 0xD800 && text[units - 1] <= 0xDBFF) {
+            units--;
+        }
+        size_t bytes = Utf16ToUtf8(text, units, buffer);
+        if (bytes > bufferSize || fwrite(buffer, 1, bytes, file) != bytes) {
+            return false;
+        }
+        text += units;
+        length -= units;
+    }
+    return true;
+}
+
+static bool IsPrintableAscii(uint32_t c) {
+    return (c >= 0x20 && c < 0x7F) || c == '\t';
+}
+
+// Accepts BMP text outside the C0/C1 controls; surrogates are left to the transcoder to validate
+static bool IsPrintableWide(uint32_t unit) {
+    return IsPrintableAscii(unit) || (unit >= 0xA0 && unit != 0xFFFE && unit != 0xFFFF);
+}
+
+static void FlushAsciiRun(StringExtractor *extractor) {
+    if (extractor->asciiLength >= STRING_MIN_LENGTH) {
+        fprintf(extractor->outputFile, "%016llx a ", (unsigned long long)extractor->asciiStart);
+        fwrite(extractor->asciiRun, 1, extractor->asciiLength, extractor->outputFile);
+        fputc('\n', extractor->outputFile);
+        extractor->asciiStrings++;
+    }
+    extractor->asciiLength = 0;
+}
+
+static void FlushWideRun(StringExtractor *extractor) {
+    // Mostly-ASCII runs only: random data is full of "printable" BMP code units
+    if (extractor->wideLength >= STRING_MIN_LENGTH && extractor->wideAsciiCount * 2 >= extractor->wideLength) {
+        uint8_t text[STRING_MAX_LENGTH * UTF8_MAX_PER_UTF16];
+        size_t bytes = Utf16ToUtf8(extractor->wideRun, extractor->wideLength, text);
+        fprintf(extractor->outputFile, "%016llx u ", (unsigned long long)extractor->wideStart);
+        fwrite(text, 1, bytes, extractor->outputFile);
+        fputc('\n', extractor->outputFile);
+        extractor->wideStrings++;
+    }
+    extractor->wideLength = 0;
+    extractor->wideAsciiCount = 0;
+}
+
+void BeginStringExtraction(StringExtractor *extractor, FILE *outputFile) {
+    memset(extractor, 0, sizeof(*extractor));
+    extractor->outputFile = outputFile;
+    extractor->wideLowByte = -1;
+}
+
+void BeginStringRegion(StringExtractor *extractor, uint64_t baseAddress) {
+    EndStringRegion(extractor);
+    extractor->address = baseAddress;
+}
+
+// Function to scan bytes for ASCII runs and, on even addresses, UTF-16LE runs
+void AppendStringData(StringExtractor *extractor, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++, extractor->address++) {
+        uint8_t c = bytes[i];
+
+        if (IsPrintableAscii(c)) {
+            if (extractor->asciiLength == 0) extractor->asciiStart = extractor->address;
+            extractor->asciiRun[extractor->asciiLength++] = c;
+            if (extractor->asciiLength == STRING_MAX_LENGTH) FlushAsciiRun(extractor);
+        } else if (extractor->asciiLength > 0) {
+            FlushAsciiRun(extractor);
+        }
+
+        if ((extractor->address & 1) == 0) {
+            extractor->wideLowByte = c;
+            continue;
+        }
+        if (extractor->wideLowByte < 0) continue;
+
+        uint16_t unit = (uint16_t)(extractor->wideLowByte | (c << 8));
+        extractor->wideLowByte = -1;
+        if (IsPrintableWide(unit)) {
+            if (extractor->wideLength == 0) extractor->wideStart = extractor->address - 1;
+            extractor->wideRun[extractor->wideLength++] = unit;
+            if (IsPrintableAscii(unit)) extractor->wideAsciiCount++;
+            if (extractor->wideLength == STRING_MAX_LENGTH) {
+                // A high surrogate in the last slot starts the next run, so the pair is not split
+                bool carry = unit >= 0xD800 && unit <= 0xDBFF;
+                if (carry) extractor->wideLength--;
+                FlushWideRun(extractor);
+                if (carry) {
+                    extractor->wideStart = extractor->address - 1;
+                    extractor->wideRun[extractor->wideLength++] = unit;
+                }
+            }
+        } else if (extractor->wideLength > 0) {
+            FlushWideRun(extractor);
+        }
+    }
+}
+
+void EndStringRegion(StringExtractor *extractor) {
+    FlushAsciiRun(extractor);
+    FlushWideRun(extractor);
+    extractor->wideLowByte = -1;
+}
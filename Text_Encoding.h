@@ -0,0 +1,40 @@
+#ifndef TEXT_ENCODING_H
+#define TEXT_ENCODING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define UTF8_MAX_PER_UTF16 3        // Worst-case UTF-8 bytes per UTF-16 code unit
+#define STRING_MIN_LENGTH 5         // Shortest run reported as a string
+#define STRING_MAX_LENGTH 1024      // Longer runs are split
+
+// Validated transcoding; unpaired surrogates and malformed UTF-8 become U+FFFD.
+// Utf16ToUtf8 needs room for srcLength * UTF8_MAX_PER_UTF16 bytes, Utf8ToUtf16 for srcLength units.
+size_t Utf16ToUtf8(const uint16_t *src, size_t srcLength, uint8_t *dst);
+size_t Utf8ToUtf16(const uint8_t *src, size_t srcLength, uint16_t *dst);
+bool WriteUtf16AsUtf8(FILE *file, const uint16_t *text, size_t length);
+
+// Streaming extraction of printable ASCII and UTF-16LE strings from raw memory, written as UTF-8 lines
+typedef struct {
+    FILE *outputFile;
+    uint64_t address;               // Address of the next byte to be appended
+    uint8_t asciiRun[STRING_MAX_LENGTH];
+    size_t asciiLength;
+    uint64_t asciiStart;
+    uint16_t wideRun[STRING_MAX_LENGTH];
+    size_t wideLength;
+    size_t wideAsciiCount;
+    uint64_t wideStart;
+    int wideLowByte;                // Low byte of a half-read code unit, -1 when none
+    uint64_t asciiStrings;
+    uint64_t wideStrings;
+} StringExtractor;
+
+void BeginStringExtraction(StringExtractor *extractor, FILE *outputFile);
+void BeginStringRegion(StringExtractor *extractor, uint64_t baseAddress);
+void AppendStringData(StringExtractor *extractor, const void *data, size_t size);
+void EndStringRegion(StringExtractor *extractor);
+
+#endif
@@ -0,0 +1,964 @@
+#include <windows.h>
+#include <shellapi.h>
+#include <shlwapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tchar.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "Text_Encoding.h"
+
+#pragma comment(lib, "Shell32.lib")
+#pragma comment(lib, "Shlwapi.lib")
+
+#define BUFFER_SIZE 1024
+#define DEFAULT_INDEX_FOLDER _T("transcript_index")
+#define DOCUMENTS_FILE _T("documents.txt")
+#define SEGMENT_PATTERN _T("segment_*.idx")
+#define SEGMENT_MAGIC 0x58495254  // "TRIX"
+#define SEGMENT_VERSION 1
+#define TRIGRAM_SPACE (1u << 24)
+#define READ_CHUNK_SIZE (1 << 20)
+#define MAX_PAIRS_PER_SEGMENT (32u << 20)
+#define MAX_PRINTED_LINES 3
+#define MAX_PRINTED_LINE_LENGTH 160
+
+// Transcripts, module listings and memory strings; the entropy and opcode maps are numbers, not text worth searching
+static const TCHAR *const indexedFileNames[] = {
+    _T("windbg_output.txt"),
+    _T("windbg_output_clipboard.txt"),
+    _T("windbg_output_modules.txt"),
+    _T("windbg_output_strings.txt"),
+};
+
+// Segment layout: header, trigram dictionary sorted by trigram, then varint delta-coded posting lists
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t trigramCount;
+    uint32_t firstDocument;
+    uint32_t lastDocument;
+    uint32_t reserved;
+    uint64_t postingsSize;
+} SegmentHeader;
+
+typedef struct {
+    uint32_t trigram;
+    uint32_t documentCount;
+    uint64_t offset;          // Offset into the postings area
+} SegmentEntry;
+
+typedef struct {
+    TCHAR path[MAX_PATH];
+    uint64_t size;
+    uint64_t modified;
+    bool known;               // Has a line in documents.txt
+    bool live;                // Latest entry for its path
+} IndexedDocument;
+
+typedef struct {
+    IndexedDocument *documents;
+    uint32_t count;           // Next document ID
+    uint32_t capacity;
+    uint32_t *pathSlots;      // Open-addressing table of document ID + 1 keyed by path
+    uint32_t pathSlotCount;
+} DocumentTable;
+
+typedef struct {
+    HANDLE hFile;
+    HANDLE hMapping;
+    const uint8_t *base;
+    const SegmentHeader *header;
+    const SegmentEntry *entries;
+    const uint8_t *postings;
+    TCHAR path[MAX_PATH];
+} MappedSegment;
+
+typedef struct {
+    uint64_t *items;
+    size_t count;
+    size_t capacity;
+} PairList;
+
+typedef struct {
+    uint32_t *items;
+    size_t count;
+    size_t capacity;
+} DocumentList;
+
+// Function declarations
+bool LoadDocuments(const TCHAR *indexFolder, DocumentTable *table);
+void FreeDocuments(DocumentTable *table);
+bool AppendDocumentLines(const TCHAR *indexFolder, const DocumentTable *table, uint32_t firstDocument, uint32_t endDocument);
+bool AddFolderToIndex(const TCHAR *indexFolder, const TCHAR *rootFolder);
+bool QueryIndex(const TCHAR *indexFolder, const uint8_t *query, size_t queryLength);
+bool CompactIndex(const TCHAR *indexFolder);
+bool WriteSegment(const TCHAR *indexFolder, PairList *pairs, uint32_t firstDocument, uint32_t lastDocument);
+size_t LoadSegments(const TCHAR *indexFolder, MappedSegment **segments);
+void UnloadSegments(MappedSegment *segments, size_t count);
+
+static uint8_t FoldByte(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+static double ElapsedMilliseconds(LARGE_INTEGER start) {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)(now.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+static bool PushPair(PairList *list, uint64_t value) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : (1u << 20);
+        uint64_t *items = (uint64_t *)realloc(list->items, capacity * sizeof(uint64_t));
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = value;
+    return true;
+}
+
+static bool PushDocument(DocumentList *list, uint32_t value) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+        uint32_t *items = (uint32_t *)realloc(list->items, capacity * sizeof(uint32_t));
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = value;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Document table
+// ---------------------------------------------------------------------------
+
+static uint32_t HashPath(const TCHAR *path) {
+    uint32_t hash = 2166136261u;
+    for (; *path; path++) {
+        hash = (hash ^ (uint32_t)_totlower(*path)) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t *FindPathSlot(DocumentTable *table, const TCHAR *path) {
+    uint32_t mask = table->pathSlotCount - 1;
+    for (uint32_t slot = HashPath(path) & mask;; slot = (slot + 1) & mask) {
+        uint32_t entry = table->pathSlots[slot];
+        if (entry == 0 || _tcsicmp(table->documents[entry - 1].path, path) == 0) {
+            return &table->pathSlots[slot];
+        }
+    }
+}
+
+static bool GrowPathSlots(DocumentTable *table) {
+    uint32_t slotCount = table->pathSlotCount ? table->pathSlotCount * 2 : 4096;
+    uint32_t *slots = (uint32_t *)calloc(slotCount, sizeof(uint32_t));
+    if (!slots) return false;
+    free(table->pathSlots);
+    table->pathSlots = slots;
+    table->pathSlotCount = slotCount;
+    for (uint32_t id = 0; id < table->count; id++) {
+        if (table->documents[id].live) {
+            *FindPathSlot(table, table->documents[id].path) = id + 1;
+        }
+    }
+    return true;
+}
+
+// Function to make room for document IDs below count; unused IDs stay zeroed (not known, not live)
+static bool ReserveDocuments(DocumentTable *table, uint32_t count) {
+    if (count > table->capacity) {
+        uint32_t capacity = table->capacity ? table->capacity : 1024;
+        while (capacity < count) capacity *= 2;
+        IndexedDocument *documents = (IndexedDocument *)realloc(table->documents, capacity * sizeof(IndexedDocument));
+        if (!documents) return false;
+        memset(documents + table->capacity, 0, (capacity - table->capacity) * sizeof(IndexedDocument));
+        table->documents = documents;
+        table->capacity = capacity;
+    }
+    if (count > table->count) table->count = count;
+    return true;
+}
+
+// Function to register a document under a new ID, retiring any older entry for the same path
+static bool SetDocument(DocumentTable *table, uint32_t id, const TCHAR *path, uint64_t size, uint64_t modified, bool known) {
+    if (!ReserveDocuments(table, id + 1)) return false;
+    if (table->count * 2 > table->pathSlotCount && !GrowPathSlots(table)) return false;
+
+    IndexedDocument *document = &table->documents[id];
+    _tcsncpy(document->path, path, MAX_PATH - 1);
+    document->path[MAX_PATH - 1] = _T('\0');
+    document->size = size;
+    document->modified = modified;
+    document->known = known;
+    document->live = true;
+
+    uint32_t *slot = FindPathSlot(table, document->path);
+    if (*slot != 0 && *slot != id + 1) {
+        table->documents[*slot - 1].live = false;
+    }
+    *slot = id + 1;
+    return true;
+}
+
+static const IndexedDocument *FindLiveDocument(DocumentTable *table, const TCHAR *path) {
+    if (table->pathSlotCount == 0) return NULL;
+    uint32_t slot = *FindPathSlot(table, path);
+    return slot ? &table->documents[slot - 1] : NULL;
+}
+
+bool LoadDocuments(const TCHAR *indexFolder, DocumentTable *table) {
+    memset(table, 0, sizeof(*table));
+    if (!GrowPathSlots(table)) return false;
+
+    TCHAR documentsFileName[MAX_PATH];
+    _stprintf(documentsFileName, _T("%s\\%s"), indexFolder, DOCUMENTS_FILE);
+    FILE *documentsFile = _tfopen(documentsFileName, _T("r"));
+    if (!documentsFile) return true;
+
+    TCHAR line[MAX_PATH + 64];
+    while (_fgetts(line, MAX_PATH + 64, documentsFile)) {
+        unsigned int id;
+        unsigned long long size, modified;
+        TCHAR path[MAX_PATH];
+        if (_stscanf(line, _T("%u %llu %llu %259[^\r\n]"), &id, &size, &modified, path) == 4) {
+            if (!SetDocument(table, id, path, size, modified, true)) {
+                fclose(documentsFile);
+                return false;
+            }
+        }
+    }
+    fclose(documentsFile);
+    return true;
+}
+
+void FreeDocuments(DocumentTable *table) {
+    free(table->documents);
+    free(table->pathSlots);
+    memset(table, 0, sizeof(*table));
+}
+
+// Function to publish documents once their segment is safely on disk
+bool AppendDocumentLines(const TCHAR *indexFolder, const DocumentTable *table, uint32_t firstDocument, uint32_t endDocument) {
+    TCHAR documentsFileName[MAX_PATH];
+    _stprintf(documentsFileName, _T("%s\\%s"), indexFolder, DOCUMENTS_FILE);
+    FILE *documentsFile = _tfopen(documentsFileName, _T("a"));
+    if (!documentsFile) return false;
+    for (uint32_t id = firstDocument; id < endDocument; id++) {
+        const IndexedDocument *document = &table->documents[id];
+        if (document->path[0]) {
+            _ftprintf(documentsFile, _T("%u %llu %llu %s\n"), id, (unsigned long long)document->size,
+                      (unsigned long long)document->modified, document->path);
+        }
+    }
+    fclose(documentsFile);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Index building
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const TCHAR *indexFolder;
+    DocumentTable documents;
+    PairList pairs;
+    uint8_t *seen;            // One bit per trigram for the current document
+    uint32_t *touched;        // Trigrams set in seen, for cheap clearing
+    size_t touchedCapacity;
+    uint8_t *readBuffer;
+    uint32_t segmentFirstDocument;
+    uint32_t addedDocuments;
+    uint32_t skippedDocuments;
+    uint32_t unreadableDocuments;
+    uint64_t indexedBytes;
+} IndexBuilder;
+
+// Function to collect the distinct case-folded trigrams of one open file as (trigram, document) pairs, then close it
+static bool IndexDocument(IndexBuilder *builder, FILE *file, uint32_t id) {
+    size_t touchedCount = 0;
+    uint32_t window = 0;
+    uint64_t position = 0;
+    size_t bytesRead;
+    bool ok = true;
+    while (ok && (bytesRead = fread(builder->readBuffer, 1, READ_CHUNK_SIZE, file)) > 0) {
+        for (size_t i = 0; i < bytesRead; i++, position++) {
+            window = ((window << 8) | FoldByte(builder->readBuffer[i])) & (TRIGRAM_SPACE - 1);
+            if (position < 2) continue;
+            uint8_t bit = (uint8_t)(1u << (window & 7));
+            if (builder->seen[window >> 3] & bit) continue;
+            builder->seen[window >> 3] |= bit;
+            if (touchedCount == builder->touchedCapacity) {
+                size_t capacity = builder->touchedCapacity ? builder->touchedCapacity * 2 : 65536;
+                uint32_t *touched = (uint32_t *)realloc(builder->touched, capacity * sizeof(uint32_t));
+                if (!touched) {
+                    ok = false;
+                    break;
+                }
+                builder->touched = touched;
+                builder->touchedCapacity = capacity;
+            }
+            builder->touched[touchedCount++] = window;
+        }
+    }
+    fclose(file);
+    builder->indexedBytes += position;
+
+    for (size_t i = 0; i < touchedCount; i++) {
+        uint32_t trigram = builder->touched[i];
+        builder->seen[trigram >> 3] = 0;
+        if (ok) ok = PushPair(&builder->pairs, ((uint64_t)trigram << 32) | id);
+    }
+    return ok;
+}
+
+static bool FlushSegment(IndexBuilder *builder) {
+    uint32_t endDocument = builder->documents.count;
+    if (endDocument == builder->segmentFirstDocument) return true;
+    if (builder->pairs.count > 0 &&
+        !WriteSegment(builder->indexFolder, &builder->pairs, builder->segmentFirstDocument, endDocument - 1)) {
+        return false;
+    }
+    if (!AppendDocumentLines(builder->indexFolder, &builder->documents, builder->segmentFirstDocument, endDocument)) {
+        return false;
+    }
+    builder->pairs.count = 0;
+    builder->segmentFirstDocument = endDocument;
+    return true;
+}
+
+static bool IsIndexedFile(const TCHAR *fileName) {
+    for (size_t i = 0; i < sizeof(indexedFileNames) / sizeof(indexedFileNames[0]); i++) {
+        if (PathMatchSpec(fileName, indexedFileNames[i])) return true;
+    }
+    return false;
+}
+
+// Function to index every transcript, module listing and strings file under a folder that is new or changed
+// since the last run; a file that cannot be opened, such as one still being written, is left for the next run
+static bool IndexFolder(IndexBuilder *builder, const TCHAR *folder) {
+    TCHAR pattern[MAX_PATH];
+    WIN32_FIND_DATA findData;
+    bool ok = true;
+
+    _stprintf(pattern, _T("%s\\*"), folder);
+    HANDLE hFind = FindFirstFile(pattern, &findData);
+    if (hFind == INVALID_HANDLE_VALUE) return true;
+
+    do {
+        if (_tcscmp(findData.cFileName, _T(".")) == 0 || _tcscmp(findData.cFileName, _T("..")) == 0) continue;
+
+        TCHAR path[MAX_PATH];
+        _stprintf(path, _T("%s\\%s"), folder, findData.cFileName);
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            ok = IndexFolder(builder, path);
+            continue;
+        }
+        if (!IsIndexedFile(findData.cFileName)) continue;
+
+        uint64_t size = ((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+        uint64_t modified = ((uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime;
+        const IndexedDocument *existing = FindLiveDocument(&builder->documents, path);
+        if (existing && existing->size == size && existing->modified == modified) {
+            builder->skippedDocuments++;
+            continue;
+        }
+
+        FILE *file = _tfopen(path, _T("rb"));
+        if (!file) {
+            _tprintf(_T("Skipping %s: cannot open it (%d)\n"), path, GetLastError());
+            builder->unreadableDocuments++;
+            continue;
+        }
+        uint32_t id = builder->documents.count;
+        if (!SetDocument(&builder->documents, id, path, size, modified, false)) {
+            _tprintf(_T("Failed to index %s\n"), path);
+            fclose(file);
+            ok = false;
+            continue;
+        }
+        if (!IndexDocument(builder, file, id)) {
+            _tprintf(_T("Failed to index %s\n"), path);
+            ok = false;
+            continue;
+        }
+        builder->addedDocuments++;
+        if (builder->pairs.count >= MAX_PAIRS_PER_SEGMENT) {
+            ok = FlushSegment(builder);
+        }
+    } while (ok && FindNextFile(hFind, &findData));
+
+    FindClose(hFind);
+    return ok;
+}
+
+bool AddFolderToIndex(const TCHAR *indexFolder, const TCHAR *rootFolder) {
+    IndexBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.indexFolder = indexFolder;
+
+    LARGE_INTEGER startTime;
+    QueryPerformanceCounter(&startTime);
+
+    CreateDirectory(indexFolder, NULL);
+    if (!LoadDocuments(indexFolder, &builder.documents)) {
+        _tprintf(_T("Failed to load %s\\%s\n"), indexFolder, DOCUMENTS_FILE);
+        return false;
+    }
+
+    // Segments left behind by an interrupted run may already use IDs past documents.txt
+    MappedSegment *segments = NULL;
+    size_t segmentCount = LoadSegments(indexFolder, &segments);
+    bool ok = true;
+    for (size_t i = 0; ok && i < segmentCount; i++) {
+        ok = ReserveDocuments(&builder.documents, segments[i].header->lastDocument + 1);
+    }
+    UnloadSegments(segments, segmentCount);
+    builder.segmentFirstDocument = builder.documents.count;
+
+    builder.seen = (uint8_t *)calloc(TRIGRAM_SPACE / 8, 1);
+    builder.readBuffer = (uint8_t *)malloc(READ_CHUNK_SIZE);
+    ok = ok && builder.seen && builder.readBuffer && IndexFolder(&builder, rootFolder) && FlushSegment(&builder);
+
+    _tprintf(_T("Indexed %u new or changed files (%.1f MB), skipped %u unchanged and %u unreadable, in %.0f ms\n"),
+             builder.addedDocuments, (double)builder.indexedBytes / (1024.0 * 1024.0),
+             builder.skippedDocuments, builder.unreadableDocuments, ElapsedMilliseconds(startTime));
+
+    free(builder.seen);
+    free(builder.touched);
+    free(builder.readBuffer);
+    free(builder.pairs.items);
+    FreeDocuments(&builder.documents);
+    return ok;
+}
+
+// Function to sort pairs by trigram; LSD radix passes are stable so document order survives
+static bool SortPairsByTrigram(PairList *pairs) {
+    uint64_t *scratch = (uint64_t *)malloc(pairs->count * sizeof(uint64_t));
+    if (!scratch) return false;
+
+    uint64_t *source = pairs->items;
+    uint64_t *target = scratch;
+    for (int shift = 32; shift < 56; shift += 8) {
+        size_t counts[257] = {0};
+        for (size_t i = 0; i < pairs->count; i++) {
+            counts[((source[i] >> shift) & 0xff) + 1]++;
+        }
+        for (int b = 0; b < 256; b++) {
+            counts[b + 1] += counts[b];
+        }
+        for (size_t i = 0; i < pairs->count; i++) {
+            target[counts[(source[i] >> shift) & 0xff]++] = source[i];
+        }
+        uint64_t *swap = source;
+        source = target;
+        target = swap;
+    }
+
+    // Three passes leave the result in scratch
+    free(pairs->items);
+    pairs->items = source;
+    pairs->capacity = pairs->count;
+    return true;
+}
+
+static size_t PutVarint(uint8_t *out, uint32_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+static const uint8_t *GetVarint(const uint8_t *in, uint32_t *value) {
+    uint32_t result = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        result |= (uint32_t)(*in++ & 0x7f) << shift;
+        shift += 7;
+    }
+    *value = result | ((uint32_t)*in++ << shift);
+    return in;
+}
+
+// Function to write a segment from raw pairs, or from pre-grouped entries when merging
+static bool WriteSegmentFile(const TCHAR *indexFolder, const SegmentEntry *entries, uint32_t trigramCount,
+                             const uint8_t *postings, uint64_t postingsSize, uint32_t firstDocument, uint32_t lastDocument) {
+    TCHAR segmentFileName[MAX_PATH];
+    TCHAR temporaryFileName[MAX_PATH];
+    _stprintf(segmentFileName, _T("%s\\segment_%010u.idx"), indexFolder, firstDocument);
+    _stprintf(temporaryFileName, _T("%s.tmp"), segmentFileName);
+
+    FILE *segmentFile = _tfopen(temporaryFileName, _T("wb"));
+    if (!segmentFile) return false;
+
+    SegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SEGMENT_MAGIC;
+    header.version = SEGMENT_VERSION;
+    header.trigramCount = trigramCount;
+    header.firstDocument = firstDocument;
+    header.lastDocument = lastDocument;
+    header.postingsSize = postingsSize;
+
+    bool ok = fwrite(&header, sizeof(header), 1, segmentFile) == 1 &&
+              fwrite(entries, sizeof(SegmentEntry), trigramCount, segmentFile) == trigramCount &&
+              fwrite(postings, 1, (size_t)postingsSize, segmentFile) == postingsSize;
+    ok = (fclose(segmentFile) == 0) && ok;
+
+    // The rename publishes the segment; readers never see a partial file
+    return ok && MoveFileEx(temporaryFileName, segmentFileName, MOVEFILE_REPLACE_EXISTING);
+}
+
+bool WriteSegment(const TCHAR *indexFolder, PairList *pairs, uint32_t firstDocument, uint32_t lastDocument) {
+    if (!SortPairsByTrigram(pairs)) return false;
+
+    SegmentEntry *entries = (SegmentEntry *)malloc(pairs->count * sizeof(SegmentEntry));
+    uint8_t *postings = (uint8_t *)malloc(pairs->count * 5);
+    if (!entries || !postings) {
+        free(entries);
+        free(postings);
+        return false;
+    }
+
+    uint32_t trigramCount = 0;
+    uint64_t postingsSize = 0;
+    for (size_t i = 0; i < pairs->count;) {
+        uint32_t trigram = (uint32_t)(pairs->items[i] >> 32);
+        SegmentEntry *entry = &entries[trigramCount++];
+        entry->trigram = trigram;
+        entry->offset = postingsSize;
+        entry->documentCount = 0;
+
+        uint32_t previous = firstDocument;
+        for (; i < pairs->count && (uint32_t)(pairs->items[i] >> 32) == trigram; i++) {
+            uint32_t document = (uint32_t)pairs->items[i];
+            postingsSize += PutVarint(postings + postingsSize, document - previous);
+            previous = document;
+            entry->documentCount++;
+        }
+    }
+
+    bool ok = WriteSegmentFile(indexFolder, entries, trigramCount, postings, postingsSize, firstDocument, lastDocument);
+    free(entries);
+    free(postings);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Segment access
+// ---------------------------------------------------------------------------
+
+static bool MapSegment(MappedSegment *segment, const TCHAR *path) {
+    memset(segment, 0, sizeof(*segment));
+    _tcsncpy(segment->path, path, MAX_PATH - 1);
+    segment->hFile = CreateFile(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (segment->hFile == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(segment->hFile, &fileSize);
+    segment->hMapping = CreateFileMapping(segment->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    segment->base = segment->hMapping ? (const uint8_t *)MapViewOfFile(segment->hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!segment->base || (uint64_t)fileSize.QuadPart < sizeof(SegmentHeader)) return false;
+
+    segment->header = (const SegmentHeader *)segment->base;
+    segment->entries = (const SegmentEntry *)(segment->base + sizeof(SegmentHeader));
+    segment->postings = (const uint8_t *)(segment->entries + segment->header->trigramCount);
+    return segment->header->magic == SEGMENT_MAGIC && segment->header->version == SEGMENT_VERSION &&
+           sizeof(SegmentHeader) + (uint64_t)segment->header->trigramCount * sizeof(SegmentEntry) +
+           segment->header->postingsSize == (uint64_t)fileSize.QuadPart;
+}
+
+static void UnmapSegment(MappedSegment *segment) {
+    if (segment->base) UnmapViewOfFile(segment->base);
+    if (segment->hMapping) CloseHandle(segment->hMapping);
+    if (segment->hFile != INVALID_HANDLE_VALUE && segment->hFile != NULL) CloseHandle(segment->hFile);
+    segment->base = NULL;
+    segment->hMapping = NULL;
+    segment->hFile = NULL;
+}
+
+static int CompareSegments(const void *a, const void *b) {
+    uint32_t left = ((const MappedSegment *)a)->header->firstDocument;
+    uint32_t right = ((const MappedSegment *)b)->header->firstDocument;
+    return (left > right) - (left < right);
+}
+
+// Function to map every valid segment, ordered by the documents they cover
+size_t LoadSegments(const TCHAR *indexFolder, MappedSegment **segments) {
+    TCHAR pattern[MAX_PATH];
+    WIN32_FIND_DATA findData;
+    size_t count = 0, capacity = 0;
+    *segments = NULL;
+
+    _stprintf(pattern, _T("%s\\%s"), indexFolder, SEGMENT_PATTERN);
+    HANDLE hFind = FindFirstFile(pattern, &findData);
+    if (hFind == INVALID_HANDLE_VALUE) return 0;
+    do {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            MappedSegment *grown = (MappedSegment *)realloc(*segments, capacity * sizeof(MappedSegment));
+            if (!grown) break;
+            *segments = grown;
+        }
+        TCHAR path[MAX_PATH];
+        _stprintf(path, _T("%s\\%s"), indexFolder, findData.cFileName);
+        if (MapSegment(&(*segments)[count], path)) {
+            count++;
+        } else {
+            _tprintf(_T("Ignoring damaged segment %s\n"), path);
+            UnmapSegment(&(*segments)[count]);
+        }
+    } while (FindNextFile(hFind, &findData));
+    FindClose(hFind);
+
+    if (count > 1) qsort(*segments, count, sizeof(MappedSegment), CompareSegments);
+    return count;
+}
+
+void UnloadSegments(MappedSegment *segments, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        UnmapSegment(&segments[i]);
+    }
+    free(segments);
+}
+
+static const SegmentEntry *FindTrigram(const MappedSegment *segment, uint32_t trigram) {
+    uint32_t low = 0, high = segment->header->trigramCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (segment->entries[middle].trigram < trigram) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return (low < segment->header->trigramCount && segment->entries[low].trigram == trigram) ? &segment->entries[low] : NULL;
+}
+
+static void DecodePostings(const MappedSegment *segment, const SegmentEntry *entry, uint32_t *out) {
+    const uint8_t *in = segment->postings + entry->offset;
+    uint32_t document = segment->header->firstDocument;
+    for (uint32_t i = 0; i < entry->documentCount; i++) {
+        uint32_t delta;
+        in = GetVarint(in, &delta);
+        document += delta;
+        out[i] = document;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+static size_t IntersectSorted(uint32_t *left, size_t leftCount, const uint32_t *right, size_t rightCount) {
+    size_t i = 0, j = 0, out = 0;
+    while (i < leftCount && j < rightCount) {
+        if (left[i] < right[j]) {
+            i++;
+        } else if (left[i] > right[j]) {
+            j++;
+        } else {
+            left[out++] = left[i];
+            i++;
+            j++;
+        }
+    }
+    return out;
+}
+
+static int CompareEntryCounts(const void *a, const void *b) {
+    uint32_t left = (*(const SegmentEntry *const *)a)->documentCount;
+    uint32_t right = (*(const SegmentEntry *const *)b)->documentCount;
+    return (left > right) - (left < right);
+}
+
+static int CompareDocuments(const void *a, const void *b) {
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    return (left > right) - (left < right);
+}
+
+// Function to collect the documents of one segment that contain every query trigram
+static bool CollectCandidates(const MappedSegment *segment, const uint32_t *trigrams, size_t trigramCount, DocumentList *candidates) {
+    const SegmentEntry **entries = (const SegmentEntry **)malloc(trigramCount * sizeof(SegmentEntry *));
+    if (!entries) return false;
+    for (size_t i = 0; i < trigramCount; i++) {
+        entries[i] = FindTrigram(segment, trigrams[i]);
+        if (!entries[i]) {
+            free(entries);
+            return true;
+        }
+    }
+
+    // Intersect from the rarest trigram up so the working set only shrinks
+    qsort(entries, trigramCount, sizeof(SegmentEntry *), CompareEntryCounts);
+    uint32_t *result = (uint32_t *)malloc(entries[0]->documentCount * sizeof(uint32_t));
+    uint32_t *scratch = (uint32_t *)malloc(entries[trigramCount - 1]->documentCount * sizeof(uint32_t));
+    bool ok = result && scratch;
+    if (ok) {
+        size_t resultCount = entries[0]->documentCount;
+        DecodePostings(segment, entries[0], result);
+        for (size_t i = 1; i < trigramCount && resultCount > 0; i++) {
+            DecodePostings(segment, entries[i], scratch);
+            resultCount = IntersectSorted(result, resultCount, scratch, entries[i]->documentCount);
+        }
+        for (size_t i = 0; ok && i < resultCount; i++) {
+            ok = PushDocument(candidates, result[i]);
+        }
+    }
+    free(result);
+    free(scratch);
+    free(entries);
+    return ok;
+}
+
+static const uint8_t *FindFolded(const uint8_t *haystack, size_t haystackLength, const uint8_t *needle, size_t needleLength) {
+    if (needleLength == 0 || haystackLength < needleLength) return needleLength == 0 ? haystack : NULL;
+    uint8_t first = needle[0];
+    uint8_t firstUpper = (first >= 'a' && first <= 'z') ? (uint8_t)(first - ('a' - 'A')) : first;
+    for (size_t i = 0; i + needleLength <= haystackLength; i++) {
+        if (haystack[i] != first && haystack[i] != firstUpper) continue;
+        size_t j = 1;
+        while (j < needleLength && FoldByte(haystack[i + j]) == needle[j]) j++;
+        if (j == needleLength) return haystack + i;
+    }
+    return NULL;
+}
+
+// Function to confirm a candidate against the original file and print the matching lines
+static uint32_t VerifyCandidate(const TCHAR *path, const uint8_t *query, size_t queryLength) {
+    FILE *file = _tfopen(path, _T("rb"));
+    if (!file) return 0;
+    _fseeki64(file, 0, SEEK_END);
+    int64_t size = _ftelli64(file);
+    _fseeki64(file, 0, SEEK_SET);
+    uint8_t *data = (size > 0) ? (uint8_t *)malloc((size_t)size) : NULL;
+    size_t length = data ? fread(data, 1, (size_t)size, file) : 0;
+    fclose(file);
+
+    uint32_t matches = 0;
+    const uint8_t *cursor = data;
+    const uint8_t *end = data + length;
+    const uint8_t *match;
+    while (data && (match = FindFolded(cursor, (size_t)(end - cursor), query, queryLength)) != NULL) {
+        if (matches == 0) _tprintf(_T("%s\n"), path);
+        if (matches < MAX_PRINTED_LINES) {
+            const uint8_t *lineStart = match;
+            const uint8_t *lineEnd = match;
+            while (lineStart > data && lineStart[-1] != '\n') lineStart--;
+            while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r') lineEnd++;
+            int printed = (int)((lineEnd - lineStart) < MAX_PRINTED_LINE_LENGTH ? (lineEnd - lineStart) : MAX_PRINTED_LINE_LENGTH);
+            printf("    %.*s\n", printed, (const char *)lineStart);
+        }
+        matches++;
+        cursor = match + 1;
+    }
+    if (matches > MAX_PRINTED_LINES) _tprintf(_T("    ... %u matches\n"), matches);
+    free(data);
+    return matches;
+}
+
+bool QueryIndex(const TCHAR *indexFolder, const uint8_t *query, size_t queryLength) {
+    LARGE_INTEGER startTime;
+    QueryPerformanceCounter(&startTime);
+
+    DocumentTable documents;
+    if (!LoadDocuments(indexFolder, &documents)) return false;
+    MappedSegment *segments = NULL;
+    size_t segmentCount = LoadSegments(indexFolder, &segments);
+
+    uint8_t *folded = (uint8_t *)malloc(queryLength + 1);
+    uint32_t *trigrams = (uint32_t *)malloc((queryLength + 1) * sizeof(uint32_t));
+    DocumentList candidates = {0};
+    bool ok = folded && trigrams;
+    size_t trigramCount = 0;
+    for (size_t i = 0; ok && i < queryLength; i++) {
+        folded[i] = FoldByte(query[i]);
+        if (i >= 2) {
+            trigrams[trigramCount++] = ((uint32_t)folded[i - 2] << 16) | ((uint32_t)folded[i - 1] << 8) | folded[i];
+        }
+    }
+
+    if (ok && trigramCount == 0) {
+        // Too short for the index: every live document is a candidate
+        for (uint32_t id = 0; ok && id < documents.count; id++) {
+            ok = PushDocument(&candidates, id);
+        }
+    }
+    for (size_t i = 0; ok && trigramCount > 0 && i < segmentCount; i++) {
+        ok = CollectCandidates(&segments[i], trigrams, trigramCount, &candidates);
+    }
+    if (candidates.count > 1) qsort(candidates.items, candidates.count, sizeof(uint32_t), CompareDocuments);
+    double lookupMs = ElapsedMilliseconds(startTime);
+
+    uint32_t verified = 0, checked = 0;
+    for (size_t i = 0; ok && i < candidates.count; i++) {
+        uint32_t id = candidates.items[i];
+        if (i > 0 && id == candidates.items[i - 1]) continue;
+        if (id >= documents.count || !documents.documents[id].known || !documents.documents[id].live) continue;
+        checked++;
+        if (VerifyCandidate(documents.documents[id].path, folded, queryLength) > 0) verified++;
+    }
+
+    _tprintf(_T("%u files matched (%u candidates from %u segments) - index lookup %.2f ms, total %.2f ms\n"),
+             verified, checked, (unsigned)segmentCount, lookupMs, ElapsedMilliseconds(startTime));
+
+    free(candidates.items);
+    free(folded);
+    free(trigrams);
+    UnloadSegments(segments, segmentCount);
+    FreeDocuments(&documents);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Compaction
+// ---------------------------------------------------------------------------
+
+// Function to merge all segments into one, dropping documents superseded by newer captures
+bool CompactIndex(const TCHAR *indexFolder) {
+    DocumentTable documents;
+    if (!LoadDocuments(indexFolder, &documents)) return false;
+    MappedSegment *segments = NULL;
+    size_t segmentCount = LoadSegments(indexFolder, &segments);
+    if (segmentCount < 2) {
+        _tprintf(_T("Nothing to compact (%u segments)\n"), (unsigned)segmentCount);
+        UnloadSegments(segments, segmentCount);
+        FreeDocuments(&documents);
+        return true;
+    }
+
+    uint32_t firstDocument = segments[0].header->firstDocument;
+    uint32_t lastDocument = segments[segmentCount - 1].header->lastDocument;
+    uint64_t postingsCapacity = 0;
+    size_t trigramCapacity = 0, largestList = 0;
+    for (size_t i = 0; i < segmentCount; i++) {
+        postingsCapacity += segments[i].header->postingsSize;
+        trigramCapacity += segments[i].header->trigramCount;
+        for (uint32_t t = 0; t < segments[i].header->trigramCount; t++) {
+            if (segments[i].entries[t].documentCount > largestList) largestList = segments[i].entries[t].documentCount;
+        }
+    }
+
+    // Re-basing deltas on the merged first document can add at most a few bytes per list
+    SegmentEntry *entries = (SegmentEntry *)malloc(trigramCapacity * sizeof(SegmentEntry));
+    uint8_t *postings = (uint8_t *)malloc((size_t)postingsCapacity + trigramCapacity * 5);
+    uint32_t *decoded = (uint32_t *)malloc((largestList + 1) * sizeof(uint32_t));
+    uint32_t *cursors = (uint32_t *)calloc(segmentCount, sizeof(uint32_t));
+    bool ok = entries && postings && decoded && cursors;
+
+    uint32_t trigramCount = 0;
+    uint64_t postingsSize = 0;
+    while (ok) {
+        uint32_t trigram = UINT32_MAX;
+        for (size_t i = 0; i < segmentCount; i++) {
+            if (cursors[i] < segments[i].header->trigramCount && segments[i].entries[cursors[i]].trigram < trigram) {
+                trigram = segments[i].entries[cursors[i]].trigram;
+            }
+        }
+        if (trigram == UINT32_MAX) break;
+
+        SegmentEntry *entry = &entries[trigramCount];
+        entry->trigram = trigram;
+        entry->offset = postingsSize;
+        entry->documentCount = 0;
+        uint32_t previous = firstDocument;
+        for (size_t i = 0; i < segmentCount; i++) {
+            if (cursors[i] >= segments[i].header->trigramCount || segments[i].entries[cursors[i]].trigram != trigram) continue;
+            const SegmentEntry *source = &segments[i].entries[cursors[i]++];
+            DecodePostings(&segments[i], source, decoded);
+            for (uint32_t d = 0; d < source->documentCount; d++) {
+                uint32_t id = decoded[d];
+                if (id < previous || id >= documents.count || !documents.documents[id].live) continue;
+                postingsSize += PutVarint(postings + postingsSize, id - previous);
+                previous = id;
+                entry->documentCount++;
+            }
+        }
+        if (entry->documentCount > 0) trigramCount++;
+        else postingsSize = entry->offset;
+    }
+
+    // Old segments must be unmapped before the merged one replaces them
+    TCHAR (*oldPaths)[MAX_PATH] = (TCHAR (*)[MAX_PATH])malloc(segmentCount * sizeof(*oldPaths));
+    ok = ok && oldPaths;
+    for (size_t i = 0; ok && i < segmentCount; i++) {
+        _tcscpy(oldPaths[i], segments[i].path);
+    }
+    UnloadSegments(segments, segmentCount);
+
+    TCHAR mergedFolder[MAX_PATH];
+    _stprintf(mergedFolder, _T("%s\\compacting"), indexFolder);
+    CreateDirectory(mergedFolder, NULL);
+    ok = ok && WriteSegmentFile(mergedFolder, entries, trigramCount, postings, postingsSize, firstDocument, lastDocument);
+    if (ok) {
+        // The merged segment replaces the oldest one first; leftovers after a crash only duplicate postings
+        TCHAR mergedFile[MAX_PATH];
+        TCHAR finalFile[MAX_PATH];
+        _stprintf(mergedFile, _T("%s\\segment_%010u.idx"), mergedFolder, firstDocument);
+        _stprintf(finalFile, _T("%s\\segment_%010u.idx"), indexFolder, firstDocument);
+        ok = MoveFileEx(mergedFile, finalFile, MOVEFILE_REPLACE_EXISTING);
+        for (size_t i = 0; ok && i < segmentCount; i++) {
+            if (_tcsicmp(oldPaths[i], finalFile) != 0) DeleteFile(oldPaths[i]);
+        }
+    }
+    RemoveDirectory(mergedFolder);
+
+    _tprintf(_T("Compacted %u segments into one (%u trigrams, %.1f MB of postings)\n"),
+             (unsigned)segmentCount, trigramCount, (double)postingsSize / (1024.0 * 1024.0));
+
+    free(oldPaths);
+    free(entries);
+    free(postings);
+    free(decoded);
+    free(cursors);
+    FreeDocuments(&documents);
+    return ok;
+}
+
+void PrintUsage(const TCHAR *program) {
+    _tprintf(_T("Usage:\n"));
+    _tprintf(_T("  %s add <folder> [index folder]      Index new or changed windbg_output*.txt files under folder\n"), program);
+    _tprintf(_T("  %s query <text> [index folder]      Find files containing text (case-insensitive)\n"), program);
+    _tprintf(_T("  %s compact [index folder]           Merge all segments into one\n"), program);
+}
+
+int _tmain(int argc, TCHAR *argv[]) {
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    bool ok;
+    if (_tcscmp(argv[1], _T("add")) == 0 && argc >= 3) {
+        ok = AddFolderToIndex(argc >= 4 ? argv[3] : DEFAULT_INDEX_FOLDER, argv[2]);
+    } else if (_tcscmp(argv[1], _T("query")) == 0 && argc >= 3) {
+        // Take the query from the wide command line so non-ANSI text matches the UTF-8 transcripts
+        int wideCount;
+        LPWSTR *wideArgs = CommandLineToArgvW(GetCommandLineW(), &wideCount);
+        if (!wideArgs || wideCount < 3) {
+            _tprintf(_T("Failed to read the query from the command line\n"));
+            return 1;
+        }
+        size_t wideLength = wcslen(wideArgs[2]);
+        uint8_t *query = (uint8_t *)malloc(wideLength * UTF8_MAX_PER_UTF16 + 1);
+        size_t queryLength = query ? Utf16ToUtf8((const uint16_t *)wideArgs[2], wideLength, query) : 0;
+        ok = query && QueryIndex(argc >= 4 ? argv[3] : DEFAULT_INDEX_FOLDER, query, queryLength);
+        free(query);
+        LocalFree(wideArgs);
+    } else if (_tcscmp(argv[1], _T("compact")) == 0) {
+        ok = CompactIndex(argc >= 3 ? argv[2] : DEFAULT_INDEX_FOLDER);
+    } else {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -1,11 +1,16 @@
 
 import os
 import re
+import shutil
 
 def extract_and_save_sections(input_file_path, output_dir):
-    with open(input_file_path, 'r') as file:
+    with open(input_file_path, 'r', encoding='utf-8', errors='replace') as file:
         content = file.read()
 
+    # Drop the ".echotime" stamps used for per-command timing; they would only add noise to the features
+    content = re.sub(r"^.*Debugger \(not debuggee\) time:.*\n?", "", content, flags=re.MULTILINE)
+    content = re.sub(r"^.*> ?\.echotime\s*\n?", "", content, flags=re.MULTILINE)
+
     # Define regex patterns for different sections and their labels
     patterns = {
         "preparing_env": r"[*]+ Preparing the environment for Debugger Extensions Gallery repositories [*]+\n.*?(?=\n[*]+|$)",
@@ -58,9 +63,17 @@ def extract_and_save_sections(input_file_path, output_dir):
     for section_type, sections in extracted_sections.items():
         for i, section in enumerate(sections):
             section_file_path = os.path.join(output_dir, f"{section_type}_{i+1}.txt")
-            with open(section_file_path, 'w') as section_file:
+            with open(section_file_path, 'w', encoding='utf-8') as section_file:
                 section_file.write(section)
 
+# Copy structured features (*.features, one "name value" pair per line) next to the extracted sections
+def copy_structured_features(process_folder_path, output_dir):
+    for file_name in os.listdir(process_folder_path):
+        if file_name.endswith('.features'):
+            if not os.path.exists(output_dir):
+                os.makedirs(output_dir)
+            shutil.copyfile(os.path.join(process_folder_path, file_name), os.path.join(output_dir, file_name))
+
 def process_windbg_outputs(root_dir, output_base_dir):
     windbg_outputs_dir = os.path.join(root_dir, 'windbg_outputs')
 
@@ -72,11 +85,17 @@ def process_windbg_outputs(root_dir, output_base_dir):
         if os.path.isdir(process_folder_path):
             input_file_path = os.path.join(process_folder_path, 'windbg_output_clipboard.txt')
 
+            # Folders are named <pid>_<process name>; the process name is the label, each folder one sample of it
+            match = re.match(r"\d+_(.+)", process_folder)
+            label = match.group(1) if match else process_folder
+            output_dir = os.path.join(output_base_dir, label, process_folder)
+
             # Check if the windbg_output_clipboard.txt file exists
             if os.path.isfile(input_file_path):
-                output_dir = os.path.join(output_base_dir, process_folder)
                 extract_and_save_sections(input_file_path, output_dir)
 
+            copy_structured_features(process_folder_path, output_dir)
+
 if __name__ == "__main__":
     # Set the root directory (the directory containing the 'classifier' folder)
     root_dir = os.path.dirname(os.path.abspath(__file__))
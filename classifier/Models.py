@@ -4,9 +4,10 @@ import pandas as pd
 import numpy as np
 import seaborn as sns
 import matplotlib.pyplot as plt
-from sklearn.model_selection import train_test_split, cross_val_score, StratifiedKFold
+from sklearn.model_selection import train_test_split, cross_val_score, StratifiedKFold, GroupKFold, GroupShuffleSplit
 from sklearn.preprocessing import LabelEncoder
 from sklearn.feature_extraction.text import TfidfVectorizer
+from sklearn.feature_extraction import DictVectorizer
 from sklearn.ensemble import RandomForestClassifier
 from sklearn.svm import SVC
 from sklearn.neural_network import MLPClassifier
@@ -21,23 +22,26 @@ import plotly.graph_objects as go
 from datetime import datetime
 import tensorflow as tf
 
-# Function to read and preprocess data from classifiers directory
+# Function to read and preprocess data from classifiers directory (<label>/<process folder>/*.txt)
 def preprocess_data(base_dir):
     data = []
     labels = []
+    sources = []
 
     for folder in os.listdir(base_dir):
         folder_path = os.path.join(base_dir, folder)
         if os.path.isdir(folder_path):
-            for file_name in os.listdir(folder_path):
-                file_path = os.path.join(folder_path, file_name)
-                if os.path.exists(file_path) and file_name.endswith('.txt'):
-                    with open(file_path, 'r') as file:
-                        content = file.read()
-                        data.append(content)
-                        labels.append(folder)
-
-    return pd.DataFrame({'text': data, 'label': labels})
+            for source_path, _, file_names in os.walk(folder_path):
+                for file_name in file_names:
+                    file_path = os.path.join(source_path, file_name)
+                    if os.path.exists(file_path) and file_name.endswith('.txt'):
+                        with open(file_path, 'r', encoding='utf-8', errors='replace') as file:
+                            content = file.read()
+                            data.append(content)
+                            labels.append(folder)
+                            sources.append(os.path.relpath(source_path, base_dir))
+
+    return pd.DataFrame({'text': data, 'label': labels, 'source': sources})
 
 base_dir = 'classifiers'
 df = preprocess_data(base_dir)
@@ -54,13 +58,41 @@ df['text'] = df['text'].apply(clean_text)
 label_encoder = LabelEncoder()
 df['label_encoded'] = label_encoder.fit_transform(df['label'])
 
+# Function to read structured features (*.features, one "name value" pair per line) per process folder
+def load_structured_features(base_dir):
+    features = {}
+    for source_path, _, file_names in os.walk(base_dir):
+        values = {}
+        for file_name in file_names:
+            if file_name.endswith('.features'):
+                with open(os.path.join(source_path, file_name), 'r') as file:
+                    for line in file:
+                        parts = line.split()
+                        if len(parts) == 2:
+                            values[parts[0]] = float(parts[1])
+        if values:
+            features[os.path.relpath(source_path, base_dir)] = values
+    return features
+
 # Vectorize text data using TF-IDF
 tfidf_vectorizer = TfidfVectorizer(max_features=10000)
-X = tfidf_vectorizer.fit_transform(df['text']).toarray()
+X_text = tfidf_vectorizer.fit_transform(df['text']).toarray()
+
+# Join memory-shape features (entropy maps etc.) onto every row of the process folder it came from, never by label
+structured_features = load_structured_features(base_dir)
+dict_vectorizer = DictVectorizer(sparse=False)
+X_structured = dict_vectorizer.fit_transform([structured_features.get(source, {}) for source in df['source']])
+X = np.hstack([X_text, X_structured])
+feature_names = list(tfidf_vectorizer.get_feature_names_out()) + list(dict_vectorizer.get_feature_names_out())
 y = df['label_encoded']
 
+# Rows of one process share its structured features, so a process sits entirely on one side of every split
+groups = df['source']
+group_folds = max(2, min(5, groups.nunique()))
+
 # Split data into training and testing sets
-X_train, X_test, y_train, y_test = train_test_split(X, y, test_size=0.2, random_state=42)
+train_index, test_index = next(GroupShuffleSplit(n_splits=1, test_size=0.2, random_state=42).split(X, y, groups))
+X_train, X_test, y_train, y_test = X[train_index], X[test_index], y.iloc[train_index], y.iloc[test_index]
 
 # Function to create LSTM model
 def create_lstm_model():
@@ -109,10 +141,9 @@ models = {
 results = {}
 for name, model in models.items():
     if name == 'LSTM':
-        skf = StratifiedKFold(n_splits=3)
-        scores = cross_val_score(model, X, y, cv=skf)
+        scores = cross_val_score(model, X, y, groups=groups, cv=GroupKFold(n_splits=min(3, group_folds)))
     else:
-        scores = cross_val_score(model, X, y, cv=5)
+        scores = cross_val_score(model, X, y, groups=groups, cv=GroupKFold(n_splits=group_folds))
     results[name] = scores
     print(f'{name} Cross-Validation Accuracy: {np.mean(scores):.4f} ± {np.std(scores):.4f}')
 
@@ -163,7 +194,7 @@ sorted_indices = np.argsort(feature_importances)[::-1]
 plt.figure(figsize=(15, 8))
 plt.title('Feature Importances')
 plt.bar(range(30), feature_importances[sorted_indices[:30]], align='center')
-plt.xticks(range(30), [tfidf_vectorizer.get_feature_names_out()[i] for i in sorted_indices[:30]], rotation=90)
+plt.xticks(range(30), [feature_names[i] for i in sorted_indices[:30]], rotation=90)
 plt.tight_layout()
 plt.show()
 
@@ -16,7 +16,7 @@ from sklearn.metrics import silhouette_score
 
 # Helper function to read files
 def read_file(file_path):
-    with open(file_path, 'r') as file:
+    with open(file_path, 'r', encoding='utf-8', errors='replace') as file:
         return file.read()
 
 # Helper function to parse register states
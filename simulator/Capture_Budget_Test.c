@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "Capture_Budget.h"
+
+// Checks the capture planner against hand-built address spaces: how regions split around thread stacks
+// and instruction pointers, how bulk regions share what is left of the byte budget, and where every
+// piece lands. Pieces are "read" by charging their length to the plan, as Locate_Code does after a
+// successful ReadProcessMemory. Exits non-zero if any check fails, so `make check` can gate on it.
+
+#define MB (1024ull * 1024)
+#define LONG_DEADLINE_MS 60000
+#define MAX_REGIONS 8
+
+static int failures;
+static int checks;
+
+static void Expect(const char *name, bool condition) {
+    checks++;
+    if (!condition) {
+        failures++;
+        fprintf(stderr, "FAIL %s\n", name);
+    }
+}
+
+static void ExpectValue(const char *name, uint64_t got, uint64_t expected) {
+    checks++;
+    if (got != expected) {
+        failures++;
+        fprintf(stderr, "FAIL %s\n  expected: 0x%llx\n  got:      0x%llx\n", name,
+                (unsigned long long)expected, (unsigned long long)got);
+    }
+}
+
+static void AddRegion(CaptureRegion *regions, size_t *count, uint64_t base, uint64_t size, uint32_t protect, uint32_t type) {
+    CaptureRegion *region = &regions[(*count)++];
+    region->base = base;
+    region->size = size;
+    region->protect = protect;
+    region->type = type;
+}
+
+// Function to read every allotted piece of a span; false if a piece falls outside the span
+static bool ReadSpan(CapturePlan *plan, CaptureSpan *span) {
+    bool inside = true;
+    uint32_t pieces = AllotCaptureSpan(plan, span);
+    for (uint32_t piece = 0; piece < pieces; piece++) {
+        uint64_t length = CapturePieceLength(span, piece);
+        if (length == 0) break;
+        inside = inside && CapturePieceOffset(span, piece) + length <= span->size;
+        RecordCapturedPiece(plan, span, length, false);
+    }
+    FinishCaptureSpan(span);
+    return inside;
+}
+
+static int CompareSpanBases(const void *a, const void *b) {
+    uint64_t left = ((const CaptureSpan *)a)->base;
+    uint64_t right = ((const CaptureSpan *)b)->base;
+    return (left > right) - (left < right);
+}
+
+// Function to check that a plan's spans cover [start, end) exactly once
+static void ExpectTiled(const char *name, const CapturePlan *plan, uint64_t start, uint64_t end) {
+    CaptureSpan *spans = (CaptureSpan *)malloc(plan->spanCount * sizeof(CaptureSpan));
+    bool tiled = spans != NULL;
+    if (tiled) {
+        memcpy(spans, plan->spans, plan->spanCount * sizeof(CaptureSpan));
+        qsort(spans, plan->spanCount, sizeof(CaptureSpan), CompareSpanBases);
+        uint64_t cursor = start;
+        for (size_t i = 0; i < plan->spanCount; i++) {
+            tiled = tiled && spans[i].base == cursor && spans[i].size > 0;
+            cursor = spans[i].base + spans[i].size;
+        }
+        tiled = tiled && cursor == end;
+    }
+    free(spans);
+    Expect(name, tiled);
+}
+
+static void TestSmallBulkPrefix(void) {
+    // Two mapped regions share 1.5 MB; the 1 MB one comes first and is no larger than a sample
+    CaptureRegion regions[MAX_REGIONS];
+    size_t regionCount = 0;
+    AddRegion(regions, &regionCount, 0x20000000, 64 * MB, PAGE_READONLY, MEM_MAPPED);
+    AddRegion(regions, &regionCount, 0x30000000, 1 * MB, PAGE_READONLY, MEM_MAPPED);
+    CapturePlan plan;
+    StartCaptureBudget(&plan, 3 * MB / 2, LONG_DEADLINE_MS);
+    Expect("small bulk: planned", PlanCaptureSpans(&plan, regions, regionCount, NULL, 0));
+    ExpectValue("small bulk: span count", plan.spanCount, 2);
+
+    CaptureSpan *span = &plan.spans[0];
+    ExpectValue("small bulk: smallest first", span->size, 1 * MB);
+    Expect("small bulk: pieces inside span", ReadSpan(&plan, span));
+    Expect("small bulk: not sampled", !span->sampled);
+    ExpectValue("small bulk: prefix is the page-rounded share", span->allottedBytes, 3 * MB / 4);
+    ExpectValue("small bulk: one piece", span->pieceCount, 1);
+    ExpectValue("small bulk: piece at start", CapturePieceOffset(span, 0), 0);
+    ExpectValue("small bulk: captured", span->capturedBytes, 3 * MB / 4);
+    ExpectValue("small bulk: outcome", span->outcome, CAPTURE_PARTIAL);
+    ExpectValue("small bulk: stop", span->stopReason, CAPTURE_STOP_BUDGET);
+    FreeCapturePlan(&plan);
+}
+
+static void TestSampleEnds(void) {
+    // 100 MB and three pages, so the sample step does not divide the span evenly
+    uint64_t size = 100 * MB + 3 * CAPTURE_PAGE_SIZE;
+    CaptureRegion regions[MAX_REGIONS];
+    size_t regionCount = 0;
+    AddRegion(regions, &regionCount, 0x40000000, size, PAGE_READWRITE, MEM_PRIVATE);
+    CapturePlan plan;
+    StartCaptureBudget(&plan, 10 * MB, LONG_DEADLINE_MS);
+    Expect("samples: planned", PlanCaptureSpans(&plan, regions, regionCount, NULL, 0));
+    ExpectValue("samples: span count", plan.spanCount, 1);
+
+    CaptureSpan *span = &plan.spans[0];
+    ExpectValue("samples: bulk class", span->spanClass, CAPTURE_BULK);
+    Expect("samples: pieces inside span", ReadSpan(&plan, span));
+    Expect("samples: sampled", span->sampled);
+    ExpectValue("samples: count", span->pieceCount, 10);
+    ExpectValue("samples: first at start", CapturePieceOffset(span, 0), 0);
+    uint32_t last = span->pieceCount - 1;
+    ExpectValue("samples: last ends at span end", CapturePieceOffset(span, last) + CapturePieceLength(span, last), size);
+
+    bool aligned = true, apart = true, full = true;
+    for (uint32_t piece = 0; piece < span->pieceCount; piece++) {
+        uint64_t offset = CapturePieceOffset(span, piece);
+        aligned = aligned && offset % CAPTURE_PAGE_SIZE == 0;
+        full = full && CapturePieceLength(span, piece) == CAPTURE_SAMPLE_SIZE;
+        apart = apart && (piece == 0 || offset >= CapturePieceOffset(span, piece - 1) + CAPTURE_SAMPLE_SIZE);
+    }
+    Expect("samples: page aligned", aligned);
+    Expect("samples: whole samples", full);
+    Expect("samples: no overlap", apart);
+    ExpectValue("samples: captured", span->capturedBytes, 10 * MB);
+    ExpectValue("samples: outcome", span->outcome, CAPTURE_SAMPLED);
+    Expect("samples: within budget", plan.bytesUsed <= plan.byteBudget);
+    FreeCapturePlan(&plan);
+}
+
+static void TestSharesShrink(void) {
+    // Three 64 MB mapped regions and 2.5 MB: each takes a sample until less than one is left
+    CaptureRegion regions[MAX_REGIONS];
+    size_t regionCount = 0;
+    for (uint64_t i = 0; i < 3; i++) {
+        AddRegion(regions, &regionCount, 0x50000000 + i * 0x08000000, 64 * MB, PAGE_READONLY, MEM_MAPPED);
+    }
+    CapturePlan plan;
+    StartCaptureBudget(&plan, 5 * MB / 2, LONG_DEADLINE_MS);
+    Expect("shares: planned", PlanCaptureSpans(&plan, regions, regionCount, NULL, 0));
+    ExpectValue("shares: bulk spans", plan.bulkRemaining, 3);
+
+    static const uint64_t expected[] = { 1 * MB, 1 * MB, 0 };
+    bool inside = true, shrinking = true;
+    uint64_t previous = UINT64_MAX;
+    for (size_t i = 0; i < plan.spanCount; i++) {
+        inside = inside && ReadSpan(&plan, &plan.spans[i]);
+        shrinking = shrinking && plan.spans[i].allottedBytes <= previous;
+        previous = plan.spans[i].allottedBytes;
+        char name[64];
+        snprintf(name, sizeof(name), "shares: span %u allotted", (unsigned)i);
+        ExpectValue(name, plan.spans[i].allottedBytes, expected[i]);
+    }
+    Expect("shares: pieces inside spans", inside);
+    Expect("shares: never grow", shrinking);
+    ExpectValue("shares: budget used", plan.bytesUsed, 2 * MB);
+    ExpectValue("shares: no bulk left", plan.bulkRemaining, 0);
+
+    // The last span was left less than a sample: no pieces, skipped for the budget
+    CaptureSpan *skipped = &plan.spans[2];
+    ExpectValue("skip: no pieces", skipped->pieceCount, 0);
+    ExpectValue("skip: nothing to read", CapturePieceLength(skipped, 0), 0);
+    ExpectValue("skip: outcome", skipped->outcome, CAPTURE_SKIPPED);
+    ExpectValue("skip: stop", skipped->stopReason, CAPTURE_STOP_BUDGET);
+    FreeCapturePlan(&plan);
+}
+
+static void TestDeadlineSkip(void) {
+    CaptureRegion regions[MAX_REGIONS];
+    size_t regionCount = 0;
+    AddRegion(regions, &regionCount, 0x60000000, 64 * 1024, PAGE_READWRITE, MEM_PRIVATE);
+    CapturePlan plan;
+    StartCaptureBudget(&plan, 64 * MB, 0);
+    Expect("deadline: planned", PlanCaptureSpans(&plan, regions, regionCount, NULL, 0));
+
+    CaptureSpan *span = &plan.spans[0];
+    ExpectValue("deadline: heap class", span->spanClass, CAPTURE_HEAP);
+    ExpectValue("deadline: no pieces", AllotCaptureSpan(&plan, span), 0);
+    ExpectValue("deadline: nothing allotted", span->allottedBytes, 0);
+    ExpectValue("deadline: stop", span->stopReason, CAPTURE_STOP_DEADLINE);
+    FinishCaptureSpan(span);
+    ExpectValue("deadline: outcome", span->outcome, CAPTURE_SKIPPED);
+    FreeCapturePlan(&plan);
+}
+
+static void TestOverlappingThreadRanges(void) {
+    // A 1 MB heap region with the instruction pointer just above the stack pointer: the instruction window
+    // starts first and keeps the bytes it shares with the stack
+    uint64_t base = 0x00500000, size = 1 * MB;
+    CaptureRegion regions[MAX_REGIONS];
+    size_t regionCount = 0;
+    AddRegion(regions, &regionCount, base, size, PAGE_READWRITE, MEM_PRIVATE);
+    ThreadPointers thread = { base + 0x81234, base + 0x80010 };
+    CapturePlan plan;
+    StartCaptureBudget(&plan, 64 * MB, LONG_DEADLINE_MS);
+    Expect("overlap: planned", PlanCaptureSpans(&plan, regions, regionCount, &thread, 1));
+    ExpectValue("overlap: span count", plan.spanCount, 3);
+    ExpectTiled("overlap: spans tile the region", &plan, base, base + size);
+    ExpectValue("overlap: planned bytes", plan.plannedBytes, size);
+
+    // Capture order is stack, instruction window, heap
+    ExpectValue("overlap: stack first", plan.spans[0].spanClass, CAPTURE_STACK);
+    ExpectValue("overlap: stack starts after the window", plan.spans[0].base, base + 0x8A000);
+    ExpectValue("overlap: stack runs to region end", plan.spans[0].base + plan.spans[0].size, base + size);
+    ExpectValue("overlap: window second", plan.spans[1].spanClass, CAPTURE_INSTRUCTION);
+    ExpectValue("overlap: window start", plan.spans[1].base, base + 0x79000);
+    ExpectValue("overlap: window end", plan.spans[1].base + plan.spans[1].size, base + 0x8A000);
+    ExpectValue("overlap: heap last", plan.spans[2].spanClass, CAPTURE_HEAP);
+    ExpectValue("overlap: heap below the window", plan.spans[2].size, 0x79000);
+    FreeCapturePlan(&plan);
+
+    // The stack pointer below the instruction window: the stack range covers the window, which adds nothing
+    thread.stackPointer = base + 0x40000;
+    thread.instructionPointer = base + 0x50000;
+    StartCaptureBudget(&plan, 64 * MB, LONG_DEADLINE_MS);
+    Expect("covered: planned", PlanCaptureSpans(&plan, regions, regionCount, &thread, 1));
+    ExpectValue("covered: span count", plan.spanCount, 2);
+    ExpectTiled("covered: spans tile the region", &plan, base, base + size);
+    ExpectValue("covered: stack", plan.spans[0].spanClass, CAPTURE_STACK);
+    ExpectValue("covered: stack start", plan.spans[0].base, base + 0x40000);
+    ExpectValue("covered: heap", plan.spans[1].spanClass, CAPTURE_HEAP);
+    FreeCapturePlan(&plan);
+
+    // A read-only image section is only worth the window around the instruction pointer
+    regionCount = 0;
+    AddRegion(regions, &regionCount, 0x70000000, 1 * MB, PAGE_READONLY, MEM_IMAGE);
+    thread.stackPointer = 0;
+    thread.instructionPointer = 0x70040000;
+    StartCaptureBudget(&plan, 64 * MB, LONG_DEADLINE_MS);
+    Expect("image: planned", PlanCaptureSpans(&plan, regions, regionCount, &thread, 1));
+    ExpectValue("image: span count", plan.spanCount, 1);
+    ExpectValue("image: window", plan.spans[0].spanClass, CAPTURE_INSTRUCTION);
+    ExpectTiled("image: window only", &plan, 0x70040000 - CAPTURE_IP_WINDOW / 2, 0x70040000 + CAPTURE_IP_WINDOW / 2);
+    FreeCapturePlan(&plan);
+}
+
+int main(void) {
+    TestSmallBulkPrefix();
+    TestSampleEnds();
+    TestSharesShrink();
+    TestDeadlineSkip();
+    TestOverlappingThreadRanges();
+
+    printf("%d of %d capture budget checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
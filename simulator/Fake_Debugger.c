@@ -0,0 +1,269 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "Synthetic_Processes.h"
+
+// Stands in for windbg.exe: "fake_debugger -p <pid> -c "$$><script"" replays a recorded transcript.
+// Each command in the script prints the recorded output of its "=== Section ===", after a simulated
+// delay, and .echotime prints the simulated clock. Tunables, read from the environment:
+//   SIM_TRANSCRIPTS           folder of recorded transcripts, <process name>.txt or any *.txt (default: transcripts/ next to this binary)
+//   SIM_COMMAND_MS            mean simulated milliseconds per command, exponentially distributed (default 150)
+//   SIM_ATTACH_FAILURE_RATE   share of processes the debugger cannot attach to (default 0.02)
+//   SIM_HANG_RATE             share of sessions that hang in a random command until killed (default 0.005)
+//   SIM_OUTPUT_SCALE          multiplier on recorded output size (default 1.0)
+//   SIM_TIME_SCALE            real seconds per simulated second (default 1.0)
+
+#define MAX_SECTIONS 128
+#define SECTION_NAME_SIZE 128
+#define LINE_SIZE 8192
+#define ATTACH_FAILED_EXIT 1
+#define DEBUGGER_TIME_PREFIX "Debugger (not debuggee) time:"
+
+typedef struct {
+    char name[SECTION_NAME_SIZE];
+    char **lines;
+    size_t lineCount;
+    size_t lineCapacity;
+} TranscriptSection;
+
+static TranscriptSection sections[MAX_SECTIONS];
+static size_t sectionCount;
+
+static void TrimLineEnd(char *line) {
+    size_t length = strlen(line);
+    while (length && (line[length - 1] == '\n' || line[length - 1] == '\r')) line[--length] = '\0';
+}
+
+// Function to pull the name out of a "=== Name ===" header, false for any other line
+static bool ParseSectionHeader(const char *line, char *name, size_t nameSize) {
+    const char *start = strstr(line, "=== ");
+    const char *end = start ? strstr(start + 4, " ===") : NULL;
+    if (!end) return false;
+    size_t length = (size_t)(end - (start + 4));
+    if (length >= nameSize) length = nameSize - 1;
+    memcpy(name, start + 4, length);
+    name[length] = '\0';
+    return true;
+}
+
+static TranscriptSection *FindSection(const char *name) {
+    for (size_t i = 0; i < sectionCount; i++) {
+        if (strcmp(sections[i].name, name) == 0) return &sections[i];
+    }
+    return NULL;
+}
+
+// Function to split a recorded transcript into sections, dropping the recorded .echotime stamps
+static bool LoadTranscript(const char *fileName) {
+    FILE *transcript = fopen(fileName, "rb");
+    if (!transcript) return false;
+
+    char line[LINE_SIZE];
+    char name[SECTION_NAME_SIZE];
+    TranscriptSection *current = NULL;
+    while (fgets(line, sizeof(line), transcript)) {
+        TrimLineEnd(line);
+        if (ParseSectionHeader(line, name, sizeof(name))) {
+            current = FindSection(name);
+            if (!current && sectionCount < MAX_SECTIONS) {
+                current = &sections[sectionCount++];
+                snprintf(current->name, sizeof(current->name), "%s", name);
+            }
+            continue;
+        }
+        if (!current || strstr(line, DEBUGGER_TIME_PREFIX)) continue;
+        if (current->lineCount == current->lineCapacity) {
+            current->lineCapacity = current->lineCapacity ? current->lineCapacity * 2 : 64;
+            current->lines = (char **)realloc(current->lines, current->lineCapacity * sizeof(char *));
+            if (!current->lines) break;
+        }
+        current->lines[current->lineCount++] = strdup(line);
+    }
+    fclose(transcript);
+    return sectionCount > 0;
+}
+
+// Function to choose the recording for a process: one named after it, else any recording picked by PID
+static bool ChooseTranscript(const char *folder, const char *processName, uint32_t pid, char *fileName, size_t size) {
+    snprintf(fileName, size, "%s/%s.txt", folder, processName);
+    if (access(fileName, R_OK) == 0) return true;
+
+    DIR *directory = opendir(folder);
+    if (!directory) return false;
+    char names[256][256];
+    size_t count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(directory)) && count < 256) {
+        size_t length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".txt") == 0) {
+            snprintf(names[count++], sizeof(names[0]), "%s", entry->d_name);
+        }
+    }
+    closedir(directory);
+    if (count == 0) return false;
+
+    // readdir order is arbitrary; sort so the choice only depends on the PID
+    qsort(names, count, sizeof(names[0]), (int (*)(const void *, const void *))strcmp);
+    snprintf(fileName, size, "%s/%s", folder, names[(pid / 4) % count]);
+    return true;
+}
+
+static void DefaultTranscriptFolder(char *folder, size_t size) {
+    ssize_t length = readlink("/proc/self/exe", folder, size - 16);
+    if (length <= 0) {
+        snprintf(folder, size, "transcripts");
+        return;
+    }
+    folder[length] = '\0';
+    char *slash = strrchr(folder, '/');
+    strcpy(slash ? slash + 1 : folder, "transcripts");
+}
+
+static void PrintDebuggerTime(uint64_t simulatedMs) {
+    time_t seconds = (time_t)(simulatedMs / 1000);
+    struct tm utc;
+    char stamp[64];
+    gmtime_r(&seconds, &utc);
+    strftime(stamp, sizeof(stamp), "%a %b %e %H:%M:%S", &utc);
+    printf("%s %s.%03u %d (UTC + 0:00)\n", DEBUGGER_TIME_PREFIX, stamp, (unsigned)(simulatedMs % 1000), utc.tm_year + 1900);
+}
+
+static void SimulatedSleep(double milliseconds, double timeScale) {
+    uint64_t microseconds = (uint64_t)(milliseconds * 1000.0 * timeScale);
+    struct timespec delay = { (time_t)(microseconds / 1000000), (long)(microseconds % 1000000) * 1000 };
+    nanosleep(&delay, NULL);
+}
+
+// Function to print a section's recorded output, repeated or cut to the configured output scale
+static void PrintSection(const TranscriptSection *section, double outputScale) {
+    size_t total = (size_t)(section->lineCount * outputScale + 0.5);
+    for (size_t i = 0; i < total; i++) {
+        puts(section->lines[i % section->lineCount]);
+    }
+}
+
+static size_t CountCommands(FILE *script) {
+    char line[LINE_SIZE];
+    size_t count = 0;
+    while (fgets(line, sizeof(line), script)) {
+        TrimLineEnd(line);
+        if (line[0] && line[0] != '.') count++;
+    }
+    rewind(script);
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t pid = 0;
+    const char *scriptPath = NULL;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0) pid = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-c") == 0) scriptPath = argv[++i];
+    }
+    if (!scriptPath) {
+        fprintf(stderr, "Usage: %s -p <pid> -c \"$$><commands script>\"\n", argv[0]);
+        return 2;
+    }
+    if (strncmp(scriptPath, "$$><", 4) == 0) scriptPath += 4;
+
+    double commandMs = SimEnvDouble("SIM_COMMAND_MS", 150.0);
+    double attachFailureRate = SimEnvDouble("SIM_ATTACH_FAILURE_RATE", 0.02);
+    double hangRate = SimEnvDouble("SIM_HANG_RATE", 0.005);
+    double outputScale = SimEnvDouble("SIM_OUTPUT_SCALE", 1.0);
+    double timeScale = SimEnvDouble("SIM_TIME_SCALE", 1.0);
+
+    // Outcomes depend only on the seed and the PID, so a run can be repeated exactly
+    uint64_t random = ((uint64_t)SimEnvDouble("SIM_SEED", 1) << 32) ^ ((uint64_t)pid * 0x9E3779B97F4A7C15ULL);
+    SimRandom(&random);
+
+    LoadSyntheticProcesses();
+    const SyntheticProcess *process = FindSyntheticProcess(pid);
+    const char *processName = process ? process->name : "unknown.exe";
+
+    printf("\nMicrosoft (R) Windows Debugger Version 10.0.26100.1 AMD64\n");
+    printf("Copyright (c) Microsoft Corporation. All rights reserved.\n\n");
+    printf("*** wait with pending attach\n");
+
+    if (!process || SimRandomUnit(&random) < attachFailureRate) {
+        printf("Cannot debug pid %u, Win32 error 0n5\n    \"Access is denied.\"\n", pid);
+        printf("Unable to examine process id %u, Win32 error 0n5\n", pid);
+        fflush(stdout);
+        return ATTACH_FAILED_EXIT;
+    }
+
+    char folder[4096];
+    char transcriptName[4352];
+    const char *configured = getenv("SIM_TRANSCRIPTS");
+    if (configured && *configured) {
+        snprintf(folder, sizeof(folder), "%s", configured);
+    } else {
+        DefaultTranscriptFolder(folder, sizeof(folder));
+    }
+    if (!ChooseTranscript(folder, processName, pid, transcriptName, sizeof(transcriptName)) ||
+        !LoadTranscript(transcriptName)) {
+        fprintf(stderr, "No recorded transcripts in %s\n", folder);
+        return 2;
+    }
+
+    FILE *script = fopen(scriptPath, "rb");
+    if (!script) {
+        printf("Couldn't open script file '%s'\n", scriptPath);
+        return 2;
+    }
+
+    printf("Symbol search path is: srv*\nExecutable search path is: \n");
+    printf("ModLoad: 00007ff7`1a2b0000 00007ff7`1a2e8000   %s\n", processName);
+    printf("(%x.%x): Break instruction exception - code 80000003 (first chance)\n", pid, pid + 8);
+
+    size_t commandCount = CountCommands(script);
+    size_t hangAt = SimRandomUnit(&random) < hangRate && commandCount ? (size_t)(SimRandom(&random) % commandCount) : SIZE_MAX;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t simulatedMs = (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+
+    char line[LINE_SIZE];
+    char sectionName[SECTION_NAME_SIZE] = "";
+    bool sectionPrinted = false;
+    size_t commandIndex = 0;
+    while (fgets(line, sizeof(line), script)) {
+        TrimLineEnd(line);
+        if (!line[0]) continue;
+
+        if (strncmp(line, ".echotime", 9) == 0) {
+            PrintDebuggerTime(simulatedMs);
+        } else if (strncmp(line, ".echo ", 6) == 0) {
+            puts(line + 6);
+            if (ParseSectionHeader(line + 6, sectionName, sizeof(sectionName))) sectionPrinted = false;
+        } else if (strncmp(line, ".quit", 5) == 0) {
+            break;
+        } else if (line[0] != '.') {
+            if (commandIndex++ == hangAt) {
+                // The target or a symbol server stopped answering; only the analyzer's timeout ends this
+                fflush(stdout);
+                while (true) pause();
+            }
+            double delay = -log(1.0 - SimRandomUnit(&random)) * commandMs;
+            SimulatedSleep(delay, timeScale);
+            simulatedMs += (uint64_t)delay;
+
+            // Recordings carry their own "0:000>" prompt lines, so only unrecorded commands echo one here
+            const TranscriptSection *section = FindSection(sectionName);
+            if (!section) {
+                printf("0:000> %s\nNo export %s found\n", line, line);
+            } else if (!sectionPrinted) {
+                PrintSection(section, outputScale);
+                sectionPrinted = true;
+            }
+        }
+    }
+    fclose(script);
+    fflush(stdout);
+    return 0;
+}
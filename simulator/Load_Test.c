@@ -0,0 +1,307 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+// Drives one end-to-end sweep of process_analyzer_sim against the fake debugger and reports
+// wall time, peak RSS and per-stage throughput from the analyzer's own run report. Each run
+// appends one row to load_test_results.tsv so scheduler, capture and logging changes can be compared.
+
+#define PATH_SIZE 4096
+#define LINE_SIZE 1024
+#define MAX_STAGES 64
+#define MAX_COUNTERS 64
+#define RSS_POLL_US 20000
+#define RESULTS_FILE "load_test_results.tsv"
+
+typedef struct {
+    char name[64];
+    unsigned long long count;
+    unsigned long long sumUs;
+    unsigned long long p99Us;
+} StageReport;
+
+typedef struct {
+    char name[64];
+    unsigned long long value;
+} CounterReport;
+
+static StageReport stages[MAX_STAGES];
+static size_t stageCount;
+static CounterReport counters[MAX_COUNTERS];
+static size_t counterCount;
+
+static void Usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -n <count>   synthetic processes (default 1000)\n"
+            "  -s <seed>    seed for the process table and failure draws (default 1)\n"
+            "  -t <scale>   real seconds per simulated second (default 0.001)\n"
+            "  -c <ms>      mean simulated milliseconds per debugger command (default 150)\n"
+            "  -f <rate>    debugger attach failure rate (default 0.02)\n"
+            "  -l <rate>    debugger launch failure rate (default 0)\n"
+            "  -h <rate>    debugger hang rate (default 0.005)\n"
+            "  -o <scale>   recorded output size multiplier (default 1)\n"
+            "  -x <rate>    share of processes that exit mid-sweep (default 0.01)\n"
+            "  -w <folder>  work folder for runs and results (default load_test_runs)\n"
+            "  -L <label>   label for the results row (default: unlabeled)\n",
+            program);
+}
+
+// Function to find a sibling binary next to this one
+static void SiblingPath(const char *name, char *path) {
+    ssize_t length = readlink("/proc/self/exe", path, PATH_SIZE - 64);
+    if (length <= 0) {
+        snprintf(path, PATH_SIZE, "./%s", name);
+        return;
+    }
+    path[length] = '\0';
+    char *slash = strrchr(path, '/');
+    strcpy(slash ? slash + 1 : path, name);
+}
+
+static double Seconds(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Function to read the high-water RSS of a running process, in KB
+static long ReadPeakRss(pid_t pid) {
+    char path[64];
+    char line[LINE_SIZE];
+    long peak = -1;
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *status = fopen(path, "r");
+    if (!status) return -1;
+    while (fgets(line, sizeof(line), status)) {
+        if (strncmp(line, "VmHWM:", 6) == 0) {
+            peak = atol(line + 6);
+            break;
+        }
+    }
+    fclose(status);
+    return peak;
+}
+
+static bool ParseQuotedName(const char *line, char *name, size_t size) {
+    const char *start = strchr(line, '"');
+    const char *end = start ? strchr(start + 1, '"') : NULL;
+    if (!end || (size_t)(end - start - 1) >= size) return false;
+    memcpy(name, start + 1, (size_t)(end - start - 1));
+    name[end - start - 1] = '\0';
+    return true;
+}
+
+static unsigned long long JsonNumber(const char *line, const char *key) {
+    const char *found = strstr(line, key);
+    return found ? strtoull(found + strlen(key), NULL, 10) : 0;
+}
+
+// Function to pull counters and stage histograms out of run_report.json; the writer puts one entry per line
+static bool LoadRunReport(const char *fileName) {
+    FILE *report = fopen(fileName, "r");
+    if (!report) return false;
+
+    enum { SECTION_NONE, SECTION_COUNTERS, SECTION_STAGES } section = SECTION_NONE;
+    char line[LINE_SIZE];
+    while (fgets(line, sizeof(line), report)) {
+        if (strstr(line, "\"counters\": {")) {
+            section = SECTION_COUNTERS;
+        } else if (strstr(line, "\"stages\": {")) {
+            section = SECTION_STAGES;
+        } else if (strstr(line, "\"debugger_commands\": {")) {
+            section = SECTION_NONE;
+        } else if (section == SECTION_COUNTERS && counterCount < MAX_COUNTERS) {
+            CounterReport *counter = &counters[counterCount];
+            if (ParseQuotedName(line, counter->name, sizeof(counter->name))) {
+                counter->value = JsonNumber(line, "\": ");
+                counterCount++;
+            }
+        } else if (section == SECTION_STAGES && stageCount < MAX_STAGES) {
+            StageReport *stage = &stages[stageCount];
+            if (ParseQuotedName(line, stage->name, sizeof(stage->name))) {
+                stage->count = JsonNumber(line, "\"count\": ");
+                stage->sumUs = JsonNumber(line, "\"sum_us\": ");
+                stage->p99Us = JsonNumber(line, "\"p99_us\": ");
+                stageCount++;
+            }
+        }
+    }
+    fclose(report);
+    return stageCount > 0;
+}
+
+static unsigned long long CounterValue(const char *name) {
+    for (size_t i = 0; i < counterCount; i++) {
+        if (strcmp(counters[i].name, name) == 0) return counters[i].value;
+    }
+    return 0;
+}
+
+static const StageReport *FindStage(const char *name) {
+    for (size_t i = 0; i < stageCount; i++) {
+        if (strcmp(stages[i].name, name) == 0) return &stages[i];
+    }
+    return NULL;
+}
+
+static void SetEnvironment(const char *name, const char *value) {
+    if (value) setenv(name, value, 1);
+}
+
+int main(int argc, char *argv[]) {
+    const char *processes = "1000";
+    const char *seed = "1";
+    const char *timeScale = "0.001";
+    const char *workFolder = "load_test_runs";
+    const char *label = "unlabeled";
+    const char *commandMs = NULL, *attachFailure = NULL, *launchFailure = NULL;
+    const char *hangRate = NULL, *outputScale = NULL, *exitRate = NULL;
+
+    int option;
+    while ((option = getopt(argc, argv, "n:s:t:c:f:l:h:o:x:w:L:")) != -1) {
+        switch (option) {
+            case 'n': processes = optarg; break;
+            case 's': seed = optarg; break;
+            case 't': timeScale = optarg; break;
+            case 'c': commandMs = optarg; break;
+            case 'f': attachFailure = optarg; break;
+            case 'l': launchFailure = optarg; break;
+            case 'h': hangRate = optarg; break;
+            case 'o': outputScale = optarg; break;
+            case 'x': exitRate = optarg; break;
+            case 'w': workFolder = optarg; break;
+            case 'L': label = optarg; break;
+            default: Usage(argv[0]); return 2;
+        }
+    }
+
+    // The analyzer and every fake debugger it starts read the same knobs
+    SetEnvironment("SIM_PROCESSES", processes);
+    SetEnvironment("SIM_SEED", seed);
+    SetEnvironment("SIM_TIME_SCALE", timeScale);
+    SetEnvironment("SIM_COMMAND_MS", commandMs);
+    SetEnvironment("SIM_ATTACH_FAILURE_RATE", attachFailure);
+    SetEnvironment("SIM_LAUNCH_FAILURE_RATE", launchFailure);
+    SetEnvironment("SIM_HANG_RATE", hangRate);
+    SetEnvironment("SIM_OUTPUT_SCALE", outputScale);
+    SetEnvironment("SIM_EXIT_RATE", exitRate);
+
+    char analyzer[PATH_SIZE];
+    SiblingPath("process_analyzer_sim", analyzer);
+    if (access(analyzer, X_OK) != 0) {
+        fprintf(stderr, "Cannot find %s; run make first\n", analyzer);
+        return 1;
+    }
+
+    // Each run gets a fresh folder, so a leftover sweep journal is never resumed by accident
+    char runFolder[PATH_SIZE];
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+    mkdir(workFolder, 0755);
+    snprintf(runFolder, sizeof(runFolder), "%s/run_%s_%s_%d", workFolder, stamp, label, (int)getpid());
+    if (mkdir(runFolder, 0755) != 0) {
+        perror("mkdir");
+        return 1;
+    }
+    printf("Load test '%s': %s processes, seed %s, time scale %s, run folder %s\n", label, processes, seed, timeScale, runFolder);
+    fflush(stdout);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (child == 0) {
+        char logName[PATH_SIZE];
+        if (snprintf(logName, sizeof(logName), "%s/analyzer.log", runFolder) >= (int)sizeof(logName)) _exit(127);
+        int log = open(logName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (log < 0 || chdir(runFolder) != 0) _exit(127);
+        dup2(log, 1);
+        dup2(log, 2);
+        close(log);
+        execl(analyzer, analyzer, (char *)NULL);
+        _exit(127);
+    }
+
+    // VmHWM of the analyzer alone; wait4 then reports the peak across the analyzer and its debuggers
+    long analyzerPeakKb = 0;
+    int status = 0;
+    struct rusage usage;
+    while (true) {
+        pid_t done = wait4(child, &status, WNOHANG, &usage);
+        if (done == child) break;
+        if (done < 0) {
+            perror("wait4");
+            return 1;
+        }
+        long peak = ReadPeakRss(child);
+        if (peak > analyzerPeakKb) analyzerPeakKb = peak;
+        usleep(RSS_POLL_US);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wallSeconds = Seconds(&start, &end);
+    long treePeakKb = usage.ru_maxrss;
+    int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+    char reportName[PATH_SIZE];
+    if (snprintf(reportName, sizeof(reportName), "%s/windbg_output/run_report.json", runFolder) >= (int)sizeof(reportName) ||
+        !LoadRunReport(reportName)) {
+        fprintf(stderr, "Analyzer exited with %d and left no run report; see %s/analyzer.log\n", exitCode, runFolder);
+        return 1;
+    }
+
+    printf("\nAnalyzer exit code:       %d\n", exitCode);
+    printf("Sweep wall time:          %.2f s\n", wallSeconds);
+    printf("Peak RSS, analyzer:       %ld KB\n", analyzerPeakKb);
+    printf("Peak RSS, any process:    %ld KB\n", treePeakKb);
+    printf("Processes analyzed:       %llu (%.1f per s)\n", CounterValue("processes_analyzed"),
+           wallSeconds > 0 ? CounterValue("processes_analyzed") / wallSeconds : 0.0);
+    printf("Attach retries/failures:  %llu / %llu\n", CounterValue("attach_retries"), CounterValue("attach_failures"));
+    printf("Debugger timeouts:        %llu\n", CounterValue("windbg_timeouts"));
+
+    // Stage times are on the analyzer's clock, which the simulator scales along with Sleep and waits
+    printf("\n%-24s %10s %14s %14s %12s\n", "stage", "count", "per wall s", "per busy s", "p99 us");
+    for (size_t i = 0; i < stageCount; i++) {
+        const StageReport *stage = &stages[i];
+        printf("%-24s %10llu %14.1f %14.1f %12llu\n", stage->name, stage->count,
+               wallSeconds > 0 ? stage->count / wallSeconds : 0.0,
+               stage->sumUs ? stage->count * 1e6 / stage->sumUs : 0.0, stage->p99Us);
+    }
+
+    // One row per run; the header is written when the file is new
+    char resultsName[PATH_SIZE];
+    snprintf(resultsName, sizeof(resultsName), "%s/%s", workFolder, RESULTS_FILE);
+    bool fresh = access(resultsName, F_OK) != 0;
+    FILE *results = fopen(resultsName, "a");
+    if (results) {
+        if (fresh) {
+            fprintf(results, "timestamp\tlabel\tprocesses\tseed\ttime_scale\texit_code\twall_s\tanalyzer_peak_kb\t"
+                             "tree_peak_kb\tanalyzed\tattach_failures\ttimeouts\tprocess_total_p99_us\tstages\n");
+        }
+        const StageReport *total = FindStage("process_total");
+        fprintf(results, "%s\t%s\t%s\t%s\t%s\t%d\t%.3f\t%ld\t%ld\t%llu\t%llu\t%llu\t%llu\t", stamp, label, processes, seed,
+                timeScale, exitCode, wallSeconds, analyzerPeakKb, treePeakKb, CounterValue("processes_analyzed"),
+                CounterValue("attach_failures"), CounterValue("windbg_timeouts"), total ? total->p99Us : 0ULL);
+        for (size_t i = 0; i < stageCount; i++) {
+            fprintf(results, "%s%s=%.1f", i ? "," : "", stages[i].name, wallSeconds > 0 ? stages[i].count / wallSeconds : 0.0);
+        }
+        fprintf(results, "\n");
+        fclose(results);
+        printf("\nResults appended to %s\n", resultsName);
+    }
+    return exitCode == 0 ? 0 : 1;
+}
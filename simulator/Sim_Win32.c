@@ -0,0 +1,718 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "Sim_Win32.h"
+#include "Synthetic_Processes.h"
+#include "../Text_Encoding.h"
+
+#define SIM_PATH_SIZE 4096
+#define SIM_MAX_ARGUMENTS 32
+#define SIM_ATTACH_FAILED_EXIT 1        // Fake debugger exit code when it could not attach
+#define SIM_POLL_MIN_US 50
+#define SIM_POLL_MAX_US 2000
+
+extern char **environ;
+
+typedef enum {
+    SIM_HANDLE_FILE,
+    SIM_HANDLE_TARGET,                  // Synthetic process opened with OpenProcess
+    SIM_HANDLE_CHILD,                   // Real fake-debugger process
+    SIM_HANDLE_THREAD
+} SimHandleKind;
+
+typedef struct {
+    SimHandleKind kind;
+    int fd;
+    char path[SIM_PATH_SIZE];
+    const SyntheticProcess *target;
+    pid_t child;
+    bool exited;
+    DWORD exitCode;
+} SimHandle;
+
+struct SimWindow {
+    const char *title;
+    RECT rect;
+};
+
+static __thread DWORD lastError;
+static double timeScale = -1.0;
+static uint64_t launchRandom;
+static bool sweepStarted;               // EnumProcesses has run; processes marked to exit are gone
+static bool *terminatedTargets;
+
+// Simulated desktop
+static struct SimWindow windbgWindow = { "WinDbg", { 100, 100, 1100, 800 } };
+static struct SimWindow errorWindow = { "Error", { 450, 350, 750, 500 } };
+static bool windbgOpen;
+static bool errorOpen;
+static char windbgTranscriptPath[SIM_PATH_SIZE];
+static HWND foregroundWindow;
+static LONG cursorX, cursorY;
+static bool controlDown;
+static bool textSelected;
+static WCHAR *clipboardText;
+
+DWORD GetLastError(void) {
+    return lastError;
+}
+
+void SetLastError(DWORD error) {
+    lastError = error;
+}
+
+static void SetErrorFromErrno(void) {
+    switch (errno) {
+        case ENOENT: lastError = ERROR_FILE_NOT_FOUND; break;
+        case EACCES: case EPERM: lastError = ERROR_ACCESS_DENIED; break;
+        case EEXIST: lastError = ERROR_ALREADY_EXISTS; break;
+        default: lastError = ERROR_INVALID_PARAMETER; break;
+    }
+}
+
+static double TimeScale(void) {
+    if (timeScale < 0) {
+        timeScale = SimEnvDouble("SIM_TIME_SCALE", 1.0);
+        if (timeScale < 0) timeScale = 0;
+    }
+    return timeScale;
+}
+
+// Function to turn a Windows path into a POSIX one
+static const char *SimPath(const char *path, char *buffer) {
+    snprintf(buffer, SIM_PATH_SIZE, "%s", path);
+    for (char *p = buffer; *p; p++) {
+        if (*p == '\\') *p = '/';
+    }
+    return buffer;
+}
+
+size_t SimUtf16Length(const WCHAR *text) {
+    size_t length = 0;
+    while (text[length]) length++;
+    return length;
+}
+
+FILE *SimOpenFile(const char *path, const char *mode) {
+    char posixPath[SIM_PATH_SIZE];
+    char posixMode[16];
+    snprintf(posixMode, sizeof(posixMode), "%se", mode);      // Close on exec: the debugger inherits only stdout
+    FILE *file = fopen(SimPath(path, posixPath), posixMode);
+    if (!file) SetErrorFromErrno();
+    return file;
+}
+
+static SimHandle *NewHandle(SimHandleKind kind) {
+    SimHandle *handle = (SimHandle *)calloc(1, sizeof(SimHandle));
+    if (handle) {
+        handle->kind = kind;
+        handle->fd = -1;
+    }
+    return handle;
+}
+
+HANDLE CreateFile(LPCTSTR fileName, DWORD desiredAccess, DWORD shareMode, SECURITY_ATTRIBUTES *security,
+                  DWORD creation, DWORD flags, HANDLE templateFile) {
+    (void)shareMode; (void)security; (void)flags; (void)templateFile;
+    SimHandle *handle = NewHandle(SIM_HANDLE_FILE);
+    if (!handle) return INVALID_HANDLE_VALUE;
+    SimPath(fileName, handle->path);
+
+    int openFlags = O_CLOEXEC;
+    if ((desiredAccess & GENERIC_READ) && (desiredAccess & GENERIC_WRITE)) {
+        openFlags |= O_RDWR;
+    } else {
+        openFlags |= (desiredAccess & GENERIC_WRITE) ? O_WRONLY : O_RDONLY;
+    }
+    if (creation == CREATE_ALWAYS) openFlags |= O_CREAT | O_TRUNC;
+    if (creation == OPEN_ALWAYS) openFlags |= O_CREAT;
+
+    bool existed = access(handle->path, F_OK) == 0;
+    handle->fd = open(handle->path, openFlags, 0644);
+    if (handle->fd < 0) {
+        SetErrorFromErrno();
+        free(handle);
+        return INVALID_HANDLE_VALUE;
+    }
+    lastError = existed && creation != OPEN_EXISTING ? ERROR_ALREADY_EXISTS : 0;
+    return handle;
+}
+
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, DWORD *bytesRead, LPVOID overlapped) {
+    (void)overlapped;
+    ssize_t result = read(((SimHandle *)file)->fd, buffer, size);
+    if (result < 0) {
+        SetErrorFromErrno();
+        return FALSE;
+    }
+    if (bytesRead) *bytesRead = (DWORD)result;
+    return TRUE;
+}
+
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, DWORD *bytesWritten, LPVOID overlapped) {
+    (void)overlapped;
+    ssize_t result = write(((SimHandle *)file)->fd, buffer, size);
+    if (result < 0) {
+        SetErrorFromErrno();
+        return FALSE;
+    }
+    if (bytesWritten) *bytesWritten = (DWORD)result;
+    return TRUE;
+}
+
+BOOL SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, LARGE_INTEGER *newPosition, DWORD method) {
+    int whence = method == FILE_END ? SEEK_END : method == FILE_CURRENT ? SEEK_CUR : SEEK_SET;
+    off_t position = lseek(((SimHandle *)file)->fd, (off_t)distance.QuadPart, whence);
+    if (position < 0) {
+        SetErrorFromErrno();
+        return FALSE;
+    }
+    if (newPosition) newPosition->QuadPart = position;
+    return TRUE;
+}
+
+BOOL SetEndOfFile(HANDLE file) {
+    int fd = ((SimHandle *)file)->fd;
+    return ftruncate(fd, lseek(fd, 0, SEEK_CUR)) == 0;
+}
+
+BOOL FlushFileBuffers(HANDLE file) {
+    return fdatasync(((SimHandle *)file)->fd) == 0;
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER *size) {
+    struct stat st;
+    if (fstat(((SimHandle *)file)->fd, &st) != 0) return FALSE;
+    size->QuadPart = st.st_size;
+    return TRUE;
+}
+
+static void ReapChild(SimHandle *handle, bool wait) {
+    int status;
+    if (handle->exited) return;
+    if (waitpid(handle->child, &status, wait ? 0 : WNOHANG) == handle->child) {
+        handle->exited = true;
+        if (WIFEXITED(status)) {
+            handle->exitCode = (DWORD)WEXITSTATUS(status);
+            // The real WinDbg puts up an error dialog when it cannot attach
+            if (handle->exitCode == SIM_ATTACH_FAILED_EXIT) errorOpen = true;
+        }
+    }
+}
+
+BOOL CloseHandle(HANDLE object) {
+    SimHandle *handle = (SimHandle *)object;
+    if (!handle || object == INVALID_HANDLE_VALUE) return FALSE;
+    if (handle->kind == SIM_HANDLE_FILE && handle->fd >= 0) close(handle->fd);
+    if (handle->kind == SIM_HANDLE_CHILD) {
+        // The analyzer waits for or terminates every debugger before closing it; reap in case it just ended
+        ReapChild(handle, false);
+    }
+    free(handle);
+    return TRUE;
+}
+
+BOOL MoveFileEx(LPCTSTR existingName, LPCTSTR newName, DWORD flags) {
+    char from[SIM_PATH_SIZE], to[SIM_PATH_SIZE];
+    SimPath(existingName, from);
+    SimPath(newName, to);
+    if (!(flags & MOVEFILE_REPLACE_EXISTING) && access(to, F_OK) == 0) {
+        lastError = ERROR_ALREADY_EXISTS;
+        return FALSE;
+    }
+    if (rename(from, to) != 0) {
+        SetErrorFromErrno();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL DeleteFile(LPCTSTR fileName) {
+    char path[SIM_PATH_SIZE];
+    if (unlink(SimPath(fileName, path)) != 0) {
+        SetErrorFromErrno();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL CreateDirectory(LPCTSTR path, SECURITY_ATTRIBUTES *security) {
+    char posixPath[SIM_PATH_SIZE];
+    (void)security;
+    if (mkdir(SimPath(path, posixPath), 0755) != 0) {
+        SetErrorFromErrno();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+DWORD GetFileAttributes(LPCTSTR path) {
+    char posixPath[SIM_PATH_SIZE];
+    struct stat st;
+    if (stat(SimPath(path, posixPath), &st) != 0) {
+        SetErrorFromErrno();
+        return INVALID_FILE_ATTRIBUTES;
+    }
+    return S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+}
+
+static void SleepMicroseconds(uint64_t microseconds) {
+    struct timespec delay = { (time_t)(microseconds / 1000000), (long)(microseconds % 1000000) * 1000 };
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {}
+}
+
+void Sleep(DWORD milliseconds) {
+    SleepMicroseconds((uint64_t)(milliseconds * 1000.0 * TimeScale()));
+}
+
+ULONGLONG GetTickCount64(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (ULONGLONG)now.tv_sec * 1000 + (ULONGLONG)now.tv_nsec / 1000000;
+}
+
+DWORD GetTickCount(void) {
+    return (DWORD)GetTickCount64();
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER *counter) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    counter->QuadPart = (LONGLONG)now.tv_sec * 1000000000LL + now.tv_nsec;
+    return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER *frequency) {
+    frequency->QuadPart = 1000000000LL;
+    return TRUE;
+}
+
+void GetSystemTimeAsFileTime(FILETIME *fileTime) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t value = 116444736000000000ULL + (uint64_t)now.tv_sec * 10000000ULL + (uint64_t)now.tv_nsec / 100;
+    fileTime->dwLowDateTime = (DWORD)value;
+    fileTime->dwHighDateTime = (DWORD)(value >> 32);
+}
+
+void InitializeCriticalSection(CRITICAL_SECTION *section) {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);     // Critical sections are re-entrant
+    pthread_mutex_init(section, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+}
+
+void EnterCriticalSection(CRITICAL_SECTION *section) {
+    pthread_mutex_lock(section);
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION *section) {
+    pthread_mutex_unlock(section);
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION *section) {
+    pthread_mutex_destroy(section);
+}
+
+BOOL EnumProcesses(DWORD *processIds, DWORD size, DWORD *bytesReturned) {
+    if (!LoadSyntheticProcesses()) {
+        lastError = ERROR_INVALID_PARAMETER;
+        return FALSE;
+    }
+    size_t capacity = size / sizeof(DWORD);
+    size_t count = SyntheticProcessCount() < capacity ? SyntheticProcessCount() : capacity;
+    for (size_t i = 0; i < count; i++) {
+        processIds[i] = SyntheticProcessAt(i)->pid;
+    }
+    *bytesReturned = (DWORD)(count * sizeof(DWORD));
+    sweepStarted = true;
+    return TRUE;
+}
+
+static bool TargetGone(const SyntheticProcess *target) {
+    size_t index = (size_t)(target - SyntheticProcessAt(0));
+    return (sweepStarted && target->exitsDuringSweep) || (terminatedTargets && terminatedTargets[index]);
+}
+
+HANDLE OpenProcess(DWORD access, BOOL inheritHandle, DWORD pid) {
+    (void)inheritHandle;
+    LoadSyntheticProcesses();
+    const SyntheticProcess *target = FindSyntheticProcess(pid);
+    if (!target || pid == 0 || TargetGone(target)) {
+        lastError = ERROR_INVALID_PARAMETER;
+        return NULL;
+    }
+    if (target->protectedProcess && (access & ~PROCESS_QUERY_LIMITED_INFORMATION)) {
+        lastError = ERROR_ACCESS_DENIED;
+        return NULL;
+    }
+    SimHandle *handle = NewHandle(SIM_HANDLE_TARGET);
+    if (handle) handle->target = target;
+    return handle;
+}
+
+BOOL EnumProcessModules(HANDLE process, HMODULE *modules, DWORD size, DWORD *bytesNeeded) {
+    SimHandle *handle = (SimHandle *)process;
+    if (!handle || handle->kind != SIM_HANDLE_TARGET) return FALSE;
+    if (size >= sizeof(HMODULE)) modules[0] = (HMODULE)handle->target;
+    *bytesNeeded = sizeof(HMODULE);
+    return TRUE;
+}
+
+DWORD GetModuleBaseName(HANDLE process, HMODULE module, LPTSTR baseName, DWORD size) {
+    SimHandle *handle = (SimHandle *)process;
+    (void)module;
+    if (!handle || handle->kind != SIM_HANDLE_TARGET || size == 0) return 0;
+    snprintf(baseName, size, "%s", handle->target->name);
+    return (DWORD)strlen(baseName);
+}
+
+BOOL GetProcessTimes(HANDLE process, FILETIME *creation, FILETIME *exit, FILETIME *kernel, FILETIME *user) {
+    SimHandle *handle = (SimHandle *)process;
+    if (!handle || handle->kind != SIM_HANDLE_TARGET) return FALSE;
+    creation->dwLowDateTime = (DWORD)handle->target->creationTime;
+    creation->dwHighDateTime = (DWORD)(handle->target->creationTime >> 32);
+    memset(exit, 0, sizeof(*exit));
+    memset(kernel, 0, sizeof(*kernel));
+    memset(user, 0, sizeof(*user));
+    return TRUE;
+}
+
+// Function to split a Windows command line on spaces outside double quotes
+static int SplitCommandLine(char *commandLine, char **arguments, int maxArguments) {
+    int count = 0;
+    char *p = commandLine;
+    while (*p && count < maxArguments - 1) {
+        while (*p == ' ') p++;
+        if (!*p) break;
+        char *out = p;
+        arguments[count++] = out;
+        bool quoted = false;
+        while (*p && (quoted || *p != ' ')) {
+            if (*p == '"') {
+                quoted = !quoted;
+                p++;
+            } else {
+                *out++ = *p++;
+            }
+        }
+        if (*p) p++;
+        *out = '\0';
+    }
+    arguments[count] = NULL;
+    return count;
+}
+
+static const char *DebuggerPath(char *buffer) {
+    const char *configured = getenv("SIM_DEBUGGER");
+    if (configured && *configured) return configured;
+
+    // Default: fake_debugger next to the simulated analyzer
+    ssize_t length = readlink("/proc/self/exe", buffer, SIM_PATH_SIZE - 32);
+    if (length <= 0) return "./fake_debugger";
+    buffer[length] = '\0';
+    char *slash = strrchr(buffer, '/');
+    strcpy(slash ? slash + 1 : buffer, "fake_debugger");
+    return buffer;
+}
+
+// Function to start the fake debugger in place of WinDbg, with stdout and stderr redirected as requested
+BOOL CreateProcess(LPCTSTR applicationName, LPTSTR commandLine, SECURITY_ATTRIBUTES *processAttributes,
+                   SECURITY_ATTRIBUTES *threadAttributes, BOOL inheritHandles, DWORD flags, LPVOID environment,
+                   LPCTSTR currentDirectory, STARTUPINFO *startupInfo, PROCESS_INFORMATION *processInformation) {
+    (void)applicationName; (void)processAttributes; (void)threadAttributes; (void)inheritHandles;
+    (void)flags; (void)environment; (void)currentDirectory;
+
+    if (!launchRandom) launchRandom = (uint64_t)SimEnvDouble("SIM_SEED", 1) * 0xD1B54A32D192ED03ULL + 7;
+    if (SimRandomUnit(&launchRandom) < SimEnvDouble("SIM_LAUNCH_FAILURE_RATE", 0.0)) {
+        lastError = ERROR_FILE_NOT_FOUND;
+        return FALSE;
+    }
+
+    char line[SIM_PATH_SIZE];
+    char debugger[SIM_PATH_SIZE];
+    char *arguments[SIM_MAX_ARGUMENTS];
+    snprintf(line, sizeof(line), "%s", commandLine);
+    if (SplitCommandLine(line, arguments, SIM_MAX_ARGUMENTS) == 0) {
+        lastError = ERROR_INVALID_PARAMETER;
+        return FALSE;
+    }
+    arguments[0] = (char *)DebuggerPath(debugger);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    SimHandle *output = (SimHandle *)startupInfo->hStdOutput;
+    SimHandle *error = (SimHandle *)startupInfo->hStdError;
+    if ((startupInfo->dwFlags & STARTF_USESTDHANDLES) && output && output->kind == SIM_HANDLE_FILE) {
+        posix_spawn_file_actions_adddup2(&actions, output->fd, 1);
+    }
+    if ((startupInfo->dwFlags & STARTF_USESTDHANDLES) && error && error->kind == SIM_HANDLE_FILE) {
+        posix_spawn_file_actions_adddup2(&actions, error->fd, 2);
+    }
+
+    pid_t child;
+    int result = posix_spawn(&child, arguments[0], &actions, NULL, arguments, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (result != 0) {
+        errno = result;
+        SetErrorFromErrno();
+        return FALSE;
+    }
+
+    SimHandle *process = NewHandle(SIM_HANDLE_CHILD);
+    SimHandle *thread = NewHandle(SIM_HANDLE_THREAD);
+    process->child = child;
+    processInformation->hProcess = process;
+    processInformation->hThread = thread;
+    processInformation->dwProcessId = (DWORD)child;
+    processInformation->dwThreadId = (DWORD)child;
+
+    // A new WinDbg window replaces the previous one and shows this debugger's output
+    windbgOpen = true;
+    errorOpen = false;
+    textSelected = false;
+    snprintf(windbgTranscriptPath, sizeof(windbgTranscriptPath), "%s", output ? output->path : "");
+    return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE object, DWORD milliseconds) {
+    SimHandle *handle = (SimHandle *)object;
+    if (!handle || handle->kind != SIM_HANDLE_CHILD) return WAIT_OBJECT_0;
+
+    uint64_t timeout = milliseconds == INFINITE ? UINT64_MAX : (uint64_t)(milliseconds * 1000.0 * TimeScale());
+    uint64_t waited = 0;
+    uint64_t poll = SIM_POLL_MIN_US;
+    while (true) {
+        ReapChild(handle, false);
+        if (handle->exited) return WAIT_OBJECT_0;
+        if (waited >= timeout) return WAIT_TIMEOUT;
+        SleepMicroseconds(poll);
+        waited += poll;
+        if (poll < SIM_POLL_MAX_US) poll *= 2;
+    }
+}
+
+BOOL TerminateProcess(HANDLE object, UINT exitCode) {
+    SimHandle *handle = (SimHandle *)object;
+    if (!handle) return FALSE;
+    if (handle->kind == SIM_HANDLE_CHILD) {
+        if (!handle->exited) {
+            kill(handle->child, SIGKILL);
+            ReapChild(handle, true);
+            handle->exitCode = exitCode;
+        }
+        return TRUE;
+    }
+    if (handle->kind == SIM_HANDLE_TARGET) {
+        if (!terminatedTargets) terminatedTargets = (bool *)calloc(SyntheticProcessCount(), sizeof(bool));
+        if (terminatedTargets) terminatedTargets[handle->target - SyntheticProcessAt(0)] = true;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+BOOL GetExitCodeProcess(HANDLE object, DWORD *exitCode) {
+    SimHandle *handle = (SimHandle *)object;
+    if (!handle || handle->kind != SIM_HANDLE_CHILD) return FALSE;
+    ReapChild(handle, false);
+    *exitCode = handle->exited ? handle->exitCode : STILL_ACTIVE;
+    return TRUE;
+}
+
+void GetSystemInfo(SYSTEM_INFO *systemInfo) {
+    memset(systemInfo, 0, sizeof(*systemInfo));
+    systemInfo->lpMinimumApplicationAddress = (LPVOID)(uintptr_t)0x10000;
+    systemInfo->lpMaximumApplicationAddress = (LPVOID)(uintptr_t)0x7FFEFFFF;
+    systemInfo->dwPageSize = 0x1000;
+}
+
+// Function to describe a target's address space: one free region from the address up
+SIZE_T VirtualQueryEx(HANDLE process, LPCVOID address, MEMORY_BASIC_INFORMATION *buffer, SIZE_T length) {
+    (void)process;
+    uintptr_t base = (uintptr_t)address & ~(uintptr_t)0xFFF;
+    if (length < sizeof(*buffer) || base >= 0x7FFF0000) {
+        lastError = ERROR_INVALID_PARAMETER;
+        return 0;
+    }
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->BaseAddress = (LPVOID)base;
+    buffer->RegionSize = 0x7FFF0000 - base;
+    buffer->State = MEM_FREE;
+    buffer->Protect = PAGE_NOACCESS;
+    return sizeof(*buffer);
+}
+
+HANDLE CreateToolhelp32Snapshot(DWORD flags, DWORD pid) {
+    (void)flags; (void)pid;
+    lastError = ERROR_ACCESS_DENIED;
+    return INVALID_HANDLE_VALUE;
+}
+
+BOOL Thread32First(HANDLE snapshot, THREADENTRY32 *entry) {
+    (void)snapshot; (void)entry;
+    return FALSE;
+}
+
+BOOL Thread32Next(HANDLE snapshot, THREADENTRY32 *entry) {
+    (void)snapshot; (void)entry;
+    return FALSE;
+}
+
+HANDLE OpenThread(DWORD access, BOOL inheritHandle, DWORD threadId) {
+    (void)access; (void)inheritHandle; (void)threadId;
+    lastError = ERROR_INVALID_PARAMETER;
+    return NULL;
+}
+
+DWORD SuspendThread(HANDLE thread) {
+    (void)thread;
+    return (DWORD)-1;
+}
+
+DWORD ResumeThread(HANDLE thread) {
+    (void)thread;
+    return (DWORD)-1;
+}
+
+BOOL GetThreadContext(HANDLE thread, CONTEXT *context) {
+    (void)thread; (void)context;
+    return FALSE;
+}
+
+BOOL IsWow64Process(HANDLE process, BOOL *wow64) {
+    (void)process;
+    *wow64 = FALSE;
+    return TRUE;
+}
+
+BOOL AllocateAndInitializeSid(SID_IDENTIFIER_AUTHORITY *authority, BYTE count, DWORD a0, DWORD a1, DWORD a2, DWORD a3,
+                              DWORD a4, DWORD a5, DWORD a6, DWORD a7, PSID *sid) {
+    (void)authority; (void)count; (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5; (void)a6; (void)a7;
+    *sid = malloc(1);
+    return *sid != NULL;
+}
+
+BOOL CheckTokenMembership(HANDLE token, PSID sid, BOOL *isMember) {
+    (void)token; (void)sid;
+    *isMember = TRUE;
+    return TRUE;
+}
+
+void *FreeSid(PSID sid) {
+    free(sid);
+    return NULL;
+}
+
+HWND FindWindow(LPCTSTR className, LPCTSTR windowName) {
+    (void)className;
+    if (windowName && strcmp(windowName, windbgWindow.title) == 0 && windbgOpen) return &windbgWindow;
+    if (windowName && strcmp(windowName, errorWindow.title) == 0 && errorOpen) return &errorWindow;
+    lastError = ERROR_FILE_NOT_FOUND;
+    return NULL;
+}
+
+BOOL SetForegroundWindow(HWND window) {
+    foregroundWindow = window;
+    return window != NULL;
+}
+
+BOOL GetWindowRect(HWND window, RECT *rect) {
+    if (!window) return FALSE;
+    *rect = window->rect;
+    return TRUE;
+}
+
+BOOL SetCursorPos(int x, int y) {
+    cursorX = x;
+    cursorY = y;
+    return TRUE;
+}
+
+static bool CursorIn(const struct SimWindow *window) {
+    return cursorX >= window->rect.left && cursorX < window->rect.right &&
+           cursorY >= window->rect.top && cursorY < window->rect.bottom;
+}
+
+void mouse_event(DWORD flags, DWORD dx, DWORD dy, DWORD data, ULONG_PTR extraInfo) {
+    (void)dx; (void)dy; (void)data; (void)extraInfo;
+    if (!(flags & MOUSEEVENTF_LEFTUP)) return;
+    if (errorOpen && CursorIn(&errorWindow)) {
+        errorOpen = false;                  // "OK" on the error dialog
+    } else if (windbgOpen && CursorIn(&windbgWindow)) {
+        foregroundWindow = &windbgWindow;
+        textSelected = false;
+    }
+}
+
+// Function to copy the WinDbg transcript to the clipboard as UTF-16, as Ctrl+C in the command window does
+static void CopyTranscript(void) {
+    FILE *transcript = fopen(windbgTranscriptPath, "rbe");
+    if (!transcript) return;
+    fseeko(transcript, 0, SEEK_END);
+    off_t size = ftello(transcript);
+    fseeko(transcript, 0, SEEK_SET);
+    uint8_t *text = (uint8_t *)malloc((size_t)size + 1);
+    WCHAR *wide = (WCHAR *)malloc(((size_t)size + 1) * sizeof(WCHAR));
+    if (text && wide && fread(text, 1, (size_t)size, transcript) == (size_t)size) {
+        size_t length = Utf8ToUtf16(text, (size_t)size, wide);
+        wide[length] = 0;
+        free(clipboardText);
+        clipboardText = wide;
+        wide = NULL;
+    }
+    free(text);
+    free(wide);
+    fclose(transcript);
+}
+
+void keybd_event(BYTE key, BYTE scan, DWORD flags, ULONG_PTR extraInfo) {
+    (void)scan; (void)extraInfo;
+    bool down = !(flags & KEYEVENTF_KEYUP);
+    if (key == VK_CONTROL) {
+        controlDown = down;
+        return;
+    }
+    if (!down || !controlDown || foregroundWindow != &windbgWindow || !windbgOpen) return;
+    if (key == 'A') {
+        textSelected = true;
+    } else if (key == 'C' && textSelected) {
+        CopyTranscript();
+    }
+}
+
+LRESULT SendMessage(HWND window, UINT message, WPARAM wParam, LPARAM lParam) {
+    if (!window || message != WM_GETTEXT || wParam == 0) return 0;
+    snprintf((char *)lParam, wParam, "%s", window->title);
+    return (LRESULT)strlen((char *)lParam);
+}
+
+BOOL OpenClipboard(HWND owner) {
+    (void)owner;
+    return TRUE;
+}
+
+HANDLE GetClipboardData(UINT format) {
+    return format == CF_UNICODETEXT ? (HANDLE)clipboardText : NULL;
+}
+
+BOOL CloseClipboard(void) {
+    return TRUE;
+}
+
+LPVOID GlobalLock(HANDLE memory) {
+    return memory;
+}
+
+BOOL GlobalUnlock(HANDLE memory) {
+    (void)memory;
+    return TRUE;
+}
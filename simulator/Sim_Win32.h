@@ -0,0 +1,295 @@
+#ifndef SIM_WIN32_H
+#define SIM_WIN32_H
+
+// The subset of the Win32 API used by the Process_Analyzer collection path and the capture planner, implemented on POSIX.
+// Files map to file descriptors (backslashes become slashes), processes come from the synthetic
+// table, WinDbg is the fake debugger, and the WinDbg window and clipboard are simulated.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <wchar.h>
+#include <ctype.h>
+#include <pthread.h>
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef uint32_t UINT;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef void *HANDLE;
+typedef void *HMODULE;
+typedef void *LPVOID;
+typedef const void *LPCVOID;
+typedef void *PSID;
+typedef struct SimWindow *HWND;
+typedef char TCHAR;
+typedef const char *LPCTSTR;
+typedef char *LPTSTR;
+typedef uint16_t WCHAR;             // UTF-16, as on Windows; wchar_t is 32-bit here
+
+typedef union {
+    struct {
+        DWORD LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct {
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+typedef struct {
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+} RECT;
+
+typedef struct {
+    DWORD nLength;
+    LPVOID lpSecurityDescriptor;
+    BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES;
+
+typedef struct {
+    DWORD cb;
+    DWORD dwFlags;
+    HANDLE hStdInput;
+    HANDLE hStdOutput;
+    HANDLE hStdError;
+} STARTUPINFO;
+
+typedef struct {
+    HANDLE hProcess;
+    HANDLE hThread;
+    DWORD dwProcessId;
+    DWORD dwThreadId;
+} PROCESS_INFORMATION;
+
+typedef struct {
+    BYTE Value[6];
+} SID_IDENTIFIER_AUTHORITY;
+
+typedef struct {
+    LPVOID lpMinimumApplicationAddress;
+    LPVOID lpMaximumApplicationAddress;
+    DWORD dwPageSize;
+} SYSTEM_INFO;
+
+typedef struct {
+    LPVOID BaseAddress;
+    SIZE_T RegionSize;
+    DWORD State;
+    DWORD Protect;
+    DWORD Type;
+} MEMORY_BASIC_INFORMATION;
+
+typedef struct {
+    DWORD dwSize;
+    DWORD th32ThreadID;
+    DWORD th32OwnerProcessID;
+} THREADENTRY32;
+
+// x86 register layout: _WIN64 is not defined here
+typedef struct {
+    DWORD ContextFlags;
+    DWORD Eip;
+    DWORD Esp;
+} CONTEXT;
+
+typedef pthread_mutex_t CRITICAL_SECTION;
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define WINAPI
+#define CALLBACK
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+
+#define ERROR_FILE_NOT_FOUND 2
+#define ERROR_ACCESS_DENIED 5
+#define ERROR_INVALID_PARAMETER 87
+#define ERROR_ALREADY_EXISTS 183
+
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define STILL_ACTIVE 259
+
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 0x1
+#define FILE_SHARE_WRITE 0x2
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define FILE_ATTRIBUTE_DIRECTORY 0x10
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define FILE_BEGIN 0
+#define FILE_CURRENT 1
+#define FILE_END 2
+#define MOVEFILE_REPLACE_EXISTING 0x1
+#define MOVEFILE_WRITE_THROUGH 0x8
+
+#define PROCESS_TERMINATE 0x0001
+#define PROCESS_VM_READ 0x0010
+#define PROCESS_QUERY_INFORMATION 0x0400
+#define PROCESS_QUERY_LIMITED_INFORMATION 0x1000
+#define THREAD_SUSPEND_RESUME 0x0002
+#define THREAD_GET_CONTEXT 0x0008
+#define THREAD_QUERY_INFORMATION 0x0040
+#define TH32CS_SNAPTHREAD 0x4
+#define CONTEXT_CONTROL 0x10001
+#define STARTF_USESTDHANDLES 0x100
+#define DETACHED_PROCESS 0x8
+#define CREATE_NO_WINDOW 0x08000000
+
+#define MEM_COMMIT 0x1000
+#define MEM_FREE 0x10000
+#define MEM_PRIVATE 0x20000
+#define MEM_MAPPED 0x40000
+#define MEM_IMAGE 0x1000000
+#define PAGE_NOACCESS 0x01
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOPY 0x08
+#define PAGE_EXECUTE 0x10
+#define PAGE_EXECUTE_READ 0x20
+#define PAGE_EXECUTE_READWRITE 0x40
+#define PAGE_EXECUTE_WRITECOPY 0x80
+#define PAGE_GUARD 0x100
+
+#define WM_GETTEXT 0x000D
+#define CF_UNICODETEXT 13
+#define VK_CONTROL 0x11
+#define KEYEVENTF_KEYUP 0x2
+#define MOUSEEVENTF_LEFTDOWN 0x2
+#define MOUSEEVENTF_LEFTUP 0x4
+
+#define SECURITY_NT_AUTHORITY {{0, 0, 0, 0, 0, 5}}
+#define SECURITY_BUILTIN_DOMAIN_RID 0x20
+#define DOMAIN_ALIAS_RID_ADMINS 0x220
+
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+#define _T(x) x
+#define TEXT(x) x
+
+// TCHAR is char: the Windows build is ANSI too
+#define _tmain main
+#define _tprintf printf
+#define _ftprintf fprintf
+#define _stprintf sprintf
+#define _tfopen SimOpenFile
+#define _tcsstr strstr
+#define _tcschr strchr
+#define _tcscmp strcmp
+#define _tcscpy strcpy
+#define _tcsncpy strncpy
+#define _tcslen strlen
+#define _fgetts fgets
+#define _fputts fputs
+#define _ftelli64 ftello
+#define _ttoi atoi
+#define _istdigit isdigit
+#define wcslen SimUtf16Length
+
+DWORD GetLastError(void);
+void SetLastError(DWORD error);
+size_t SimUtf16Length(const WCHAR *text);
+FILE *SimOpenFile(const char *path, const char *mode);
+
+// Files
+HANDLE CreateFile(LPCTSTR fileName, DWORD desiredAccess, DWORD shareMode, SECURITY_ATTRIBUTES *security,
+                  DWORD creation, DWORD flags, HANDLE templateFile);
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, DWORD *bytesRead, LPVOID overlapped);
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, DWORD *bytesWritten, LPVOID overlapped);
+BOOL SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, LARGE_INTEGER *newPosition, DWORD method);
+BOOL SetEndOfFile(HANDLE file);
+BOOL FlushFileBuffers(HANDLE file);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER *size);
+BOOL CloseHandle(HANDLE handle);
+BOOL MoveFileEx(LPCTSTR existingName, LPCTSTR newName, DWORD flags);
+BOOL DeleteFile(LPCTSTR fileName);
+BOOL CreateDirectory(LPCTSTR path, SECURITY_ATTRIBUTES *security);
+DWORD GetFileAttributes(LPCTSTR path);
+
+// Time and synchronisation; Sleep and wait timeouts run on the SIM_TIME_SCALE timeline
+void Sleep(DWORD milliseconds);
+DWORD GetTickCount(void);
+ULONGLONG GetTickCount64(void);
+BOOL QueryPerformanceCounter(LARGE_INTEGER *counter);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER *frequency);
+void GetSystemTimeAsFileTime(FILETIME *fileTime);
+void InitializeCriticalSection(CRITICAL_SECTION *section);
+void EnterCriticalSection(CRITICAL_SECTION *section);
+void LeaveCriticalSection(CRITICAL_SECTION *section);
+void DeleteCriticalSection(CRITICAL_SECTION *section);
+
+static inline LONG InterlockedIncrement(volatile LONG *value) { return __sync_add_and_fetch(value, 1); }
+static inline LONG InterlockedDecrement(volatile LONG *value) { return __sync_sub_and_fetch(value, 1); }
+static inline LONG InterlockedExchange(volatile LONG *target, LONG value) { return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST); }
+static inline LONG InterlockedCompareExchange(volatile LONG *target, LONG exchange, LONG comparand) {
+    return __sync_val_compare_and_swap(target, comparand, exchange);
+}
+
+// Processes: the synthetic table for targets, real child processes for the debugger
+BOOL EnumProcesses(DWORD *processIds, DWORD size, DWORD *bytesReturned);
+HANDLE OpenProcess(DWORD access, BOOL inheritHandle, DWORD pid);
+BOOL EnumProcessModules(HANDLE process, HMODULE *modules, DWORD size, DWORD *bytesNeeded);
+DWORD GetModuleBaseName(HANDLE process, HMODULE module, LPTSTR baseName, DWORD size);
+BOOL GetProcessTimes(HANDLE process, FILETIME *creation, FILETIME *exit, FILETIME *kernel, FILETIME *user);
+BOOL CreateProcess(LPCTSTR applicationName, LPTSTR commandLine, SECURITY_ATTRIBUTES *processAttributes,
+                   SECURITY_ATTRIBUTES *threadAttributes, BOOL inheritHandles, DWORD flags, LPVOID environment,
+                   LPCTSTR currentDirectory, STARTUPINFO *startupInfo, PROCESS_INFORMATION *processInformation);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+BOOL TerminateProcess(HANDLE process, UINT exitCode);
+BOOL GetExitCodeProcess(HANDLE process, DWORD *exitCode);
+
+// Memory and threads: synthetic targets have no address space or threads to inspect
+void GetSystemInfo(SYSTEM_INFO *systemInfo);
+SIZE_T VirtualQueryEx(HANDLE process, LPCVOID address, MEMORY_BASIC_INFORMATION *buffer, SIZE_T length);
+HANDLE CreateToolhelp32Snapshot(DWORD flags, DWORD pid);
+BOOL Thread32First(HANDLE snapshot, THREADENTRY32 *entry);
+BOOL Thread32Next(HANDLE snapshot, THREADENTRY32 *entry);
+HANDLE OpenThread(DWORD access, BOOL inheritHandle, DWORD threadId);
+DWORD SuspendThread(HANDLE thread);
+DWORD ResumeThread(HANDLE thread);
+BOOL GetThreadContext(HANDLE thread, CONTEXT *context);
+BOOL IsWow64Process(HANDLE process, BOOL *wow64);
+
+// Security: the simulated analyzer always runs elevated
+BOOL AllocateAndInitializeSid(SID_IDENTIFIER_AUTHORITY *authority, BYTE count, DWORD a0, DWORD a1, DWORD a2, DWORD a3,
+                              DWORD a4, DWORD a5, DWORD a6, DWORD a7, PSID *sid);
+BOOL CheckTokenMembership(HANDLE token, PSID sid, BOOL *isMember);
+void *FreeSid(PSID sid);
+
+// Desktop: the WinDbg window shows the last debugger's transcript; Ctrl+C copies it
+HWND FindWindow(LPCTSTR className, LPCTSTR windowName);
+BOOL SetForegroundWindow(HWND window);
+BOOL GetWindowRect(HWND window, RECT *rect);
+BOOL SetCursorPos(int x, int y);
+void mouse_event(DWORD flags, DWORD dx, DWORD dy, DWORD data, ULONG_PTR extraInfo);
+void keybd_event(BYTE key, BYTE scan, DWORD flags, ULONG_PTR extraInfo);
+LRESULT SendMessage(HWND window, UINT message, WPARAM wParam, LPARAM lParam);
+BOOL OpenClipboard(HWND owner);
+HANDLE GetClipboardData(UINT format);
+BOOL CloseClipboard(void);
+LPVOID GlobalLock(HANDLE memory);
+BOOL GlobalUnlock(HANDLE memory);
+
+#endif
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Synthetic_Processes.h"
+
+#define FILETIME_UNIX_EPOCH 116444736000000000ULL
+#define FILETIME_PER_SECOND 10000000ULL
+
+typedef struct {
+    const char *name;
+    int weight;
+    bool protectedProcess;
+} ProcessTemplate;
+
+// Roughly the mix of a busy Windows 11 desktop
+static const ProcessTemplate templates[] = {
+    { "svchost.exe", 30, false },      { "chrome.exe", 12, false },      { "msedge.exe", 8, false },
+    { "RuntimeBroker.exe", 4, false }, { "conhost.exe", 4, false },     { "dllhost.exe", 3, false },
+    { "Code.exe", 3, false },          { "Teams.exe", 2, false },       { "taskhostw.exe", 2, false },
+    { "fontdrvhost.exe", 2, false },   { "WmiPrvSE.exe", 2, false },    { "csrss.exe", 2, true },
+    { "explorer.exe", 1, false },      { "notepad.exe", 1, false },     { "outlook.exe", 1, false },
+    { "SearchHost.exe", 1, false },    { "sihost.exe", 1, false },      { "ctfmon.exe", 1, false },
+    { "winlogon.exe", 1, false },      { "spoolsv.exe", 1, false },     { "cmd.exe", 1, false },
+    { "powershell.exe", 1, false },    { "python.exe", 1, false },      { "msiexec.exe", 1, false },
+    { "mspaint.exe", 1, false },       { "taskmgr.exe", 1, false },     { "OneDrive.exe", 1, false },
+    { "Widgets.exe", 1, false },       { "lsass.exe", 1, true },        { "services.exe", 1, true },
+    { "wininit.exe", 1, true },        { "smss.exe", 1, true },         { "MsMpEng.exe", 1, true },
+    { "audiodg.exe", 1, true }
+};
+
+static SyntheticProcess *processes;
+static size_t processCount;
+
+double SimEnvDouble(const char *name, double defaultValue) {
+    const char *value = getenv(name);
+    return value && *value ? atof(value) : defaultValue;
+}
+
+// xorshift64*: cheap, and identical in every process that uses the same seed
+uint64_t SimRandom(uint64_t *state) {
+    uint64_t x = *state ? *state : 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+double SimRandomUnit(uint64_t *state) {
+    return (double)(SimRandom(state) >> 11) / 9007199254740992.0;
+}
+
+static void AddProcess(uint32_t pid, const char *name, uint64_t creationTime, bool protectedProcess, bool exits) {
+    SyntheticProcess *process = &processes[processCount++];
+    process->pid = pid;
+    snprintf(process->name, sizeof(process->name), "%s", name);
+    process->creationTime = creationTime;
+    process->protectedProcess = protectedProcess;
+    process->exitsDuringSweep = exits;
+}
+
+// Function to build the fake process table: System Idle (0), System (4), then weighted names at rising PIDs
+bool LoadSyntheticProcesses(void) {
+    if (processes) return true;
+
+    size_t count = (size_t)SimEnvDouble("SIM_PROCESSES", SYNTHETIC_DEFAULT_PROCESSES);
+    uint64_t state = (uint64_t)SimEnvDouble("SIM_SEED", 1) * 0x9E3779B97F4A7C15ULL + 1;
+    double exitRate = SimEnvDouble("SIM_EXIT_RATE", 0.01);
+    if (count < 2) count = 2;
+
+    processes = (SyntheticProcess *)calloc(count, sizeof(SyntheticProcess));
+    if (!processes) return false;
+
+    int totalWeight = 0;
+    for (size_t i = 0; i < sizeof(templates) / sizeof(templates[0]); i++) totalWeight += templates[i].weight;
+
+    uint64_t bootTime = FILETIME_UNIX_EPOCH + 1767225600ULL * FILETIME_PER_SECOND;   // 2026-01-01
+    AddProcess(0, "System Idle Process", 0, true, false);
+    AddProcess(4, "System", bootTime, true, false);
+
+    // Windows PIDs are multiples of four with gaps where processes have come and gone
+    uint32_t pid = 4;
+    uint64_t creationTime = bootTime;
+    while (processCount < count) {
+        pid += 4 * (1 + (uint32_t)(SimRandom(&state) % 8));
+        creationTime += (SimRandom(&state) % (600 * FILETIME_PER_SECOND));
+        int pick = (int)(SimRandom(&state) % (uint64_t)totalWeight);
+        size_t t = 0;
+        while (pick >= templates[t].weight) pick -= templates[t++].weight;
+        AddProcess(pid, templates[t].name, creationTime, templates[t].protectedProcess,
+                   SimRandomUnit(&state) < exitRate);
+    }
+    return true;
+}
+
+size_t SyntheticProcessCount(void) {
+    return processCount;
+}
+
+const SyntheticProcess *SyntheticProcessAt(size_t index) {
+    return index < processCount ? &processes[index] : NULL;
+}
+
+// Function to look a PID up; the table is sorted by PID
+const SyntheticProcess *FindSyntheticProcess(uint32_t pid) {
+    size_t low = 0, high = processCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (processes[middle].pid < pid) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < processCount && processes[low].pid == pid ? &processes[low] : NULL;
+}
@@ -0,0 +1,33 @@
+#ifndef SYNTHETIC_PROCESSES_H
+#define SYNTHETIC_PROCESSES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SYNTHETIC_NAME_SIZE 64
+#define SYNTHETIC_DEFAULT_PROCESSES 1000
+
+// A fake process; the table is rebuilt identically from SIM_SEED by the analyzer and the fake debugger
+typedef struct {
+    uint32_t pid;
+    char name[SYNTHETIC_NAME_SIZE];
+    uint64_t creationTime;              // FILETIME
+    bool protectedProcess;              // Only PROCESS_QUERY_LIMITED_INFORMATION succeeds
+    bool exitsDuringSweep;              // Enumerated, then gone before it is analyzed
+} SyntheticProcess;
+
+// Tunables, read from the environment:
+//   SIM_PROCESSES   number of fake PIDs (default 1000)
+//   SIM_SEED        seed for names, PIDs and failure draws (default 1)
+//   SIM_EXIT_RATE   share of processes that exit between enumeration and analysis (default 0.01)
+bool LoadSyntheticProcesses(void);
+size_t SyntheticProcessCount(void);
+const SyntheticProcess *SyntheticProcessAt(size_t index);
+const SyntheticProcess *FindSyntheticProcess(uint32_t pid);
+
+double SimEnvDouble(const char *name, double defaultValue);
+uint64_t SimRandom(uint64_t *state);
+double SimRandomUnit(uint64_t *state);
+
+#endif
@@ -0,0 +1,255 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "Text_Encoding.h"
+
+// Checks the shared UTF-16LE/UTF-8 transcoder against hand-built inputs: surrogate pairs in and
+// around the SSE2 blocks, lone surrogates, pairs that straddle a buffer boundary, and malformed UTF-8
+// that must come out as one U+FFFD per maximal invalid subpart. Exits non-zero if any check fails,
+// so `make check` can gate on it.
+
+#define MAX_UNITS 20000
+
+static int failures;
+static int checks;
+
+static void PrintUnits(const char *label, const uint16_t *units, size_t length) {
+    fprintf(stderr, "  %s:", label);
+    for (size_t i = 0; i < length && i < 32; i++) fprintf(stderr, " %04X", units[i]);
+    fprintf(stderr, length > 32 ? " ...\n" : "\n");
+}
+
+static void PrintBytes(const char *label, const uint8_t *bytes, size_t length) {
+    fprintf(stderr, "  %s:", label);
+    for (size_t i = 0; i < length && i < 32; i++) fprintf(stderr, " %02X", bytes[i]);
+    fprintf(stderr, length > 32 ? " ...\n" : "\n");
+}
+
+// Function to convert UTF-16 to UTF-8 and compare with the expected bytes
+static void ExpectUtf8(const char *name, const uint16_t *src, size_t srcLength, const uint8_t *expected, size_t expectedLength) {
+    static uint8_t out[MAX_UNITS * UTF8_MAX_PER_UTF16];
+    size_t length = Utf16ToUtf8(src, srcLength, out);
+    checks++;
+    if (length != expectedLength || memcmp(out, expected, length) != 0) {
+        failures++;
+        fprintf(stderr, "FAIL %s\n", name);
+        PrintBytes("expected", expected, expectedLength);
+        PrintBytes("got", out, length);
+    }
+}
+
+// Function to convert UTF-8 to UTF-16 and compare with the expected units
+static void ExpectUtf16(const char *name, const uint8_t *src, size_t srcLength, const uint16_t *expected, size_t expectedLength) {
+    static uint16_t out[MAX_UNITS];
+    size_t length = Utf8ToUtf16(src, srcLength, out);
+    checks++;
+    if (length != expectedLength || memcmp(out, expected, length * sizeof(uint16_t)) != 0) {
+        failures++;
+        fprintf(stderr, "FAIL %s\n", name);
+        PrintUnits("expected", expected, expectedLength);
+        PrintUnits("got", out, length);
+    }
+}
+
+static void TestValidPairs(void) {
+    // U+1F600 and U+10FFFF, alone and between ASCII
+    static const uint16_t smile[] = { 0xD83D, 0xDE00 };
+    static const uint8_t smileUtf8[] = { 0xF0, 0x9F, 0x98, 0x80 };
+    ExpectUtf8("pair U+1F600", smile, 2, smileUtf8, 4);
+    ExpectUtf16("pair U+1F600 back", smileUtf8, 4, smile, 2);
+
+    static const uint16_t top[] = { 'a', 0xDBFF, 0xDFFF, 'b' };
+    static const uint8_t topUtf8[] = { 'a', 0xF4, 0x8F, 0xBF, 0xBF, 'b' };
+    ExpectUtf8("pair U+10FFFF", top, 4, topUtf8, 6);
+    ExpectUtf16("pair U+10FFFF back", topUtf8, 6, top, 4);
+
+    static const uint16_t bottom[] = { 0xD800, 0xDC00 };
+    static const uint8_t bottomUtf8[] = { 0xF0, 0x90, 0x80, 0x80 };
+    ExpectUtf8("pair U+10000", bottom, 2, bottomUtf8, 4);
+    ExpectUtf16("pair U+10000 back", bottomUtf8, 4, bottom, 2);
+
+    // A pair at every position around the 16-unit SSE2 block boundary
+    for (size_t at = 12; at <= 18; at++) {
+        uint16_t units[40];
+        uint8_t bytes[48];
+        size_t byteCount = 0;
+        for (size_t i = 0; i < 34; i++) units[i] = (uint16_t)('A' + i % 26);
+        units[at] = 0xD83D;
+        units[at + 1] = 0xDE00;
+        for (size_t i = 0; i < 34; i++) {
+            if (i == at) {
+                memcpy(bytes + byteCount, smileUtf8, 4);
+                byteCount += 4;
+                i++;
+            } else {
+                bytes[byteCount++] = (uint8_t)units[i];
+            }
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "pair at unit %u among ASCII", (unsigned)at);
+        ExpectUtf8(name, units, 34, bytes, byteCount);
+        snprintf(name, sizeof(name), "pair at byte %u among ASCII", (unsigned)at);
+        ExpectUtf16(name, bytes, byteCount, units, 34);
+    }
+}
+
+static void TestLoneSurrogates(void) {
+    static const uint8_t fffd[] = { 0xEF, 0xBF, 0xBD };
+
+    static const uint16_t high[] = { 0xD83D };
+    ExpectUtf8("lone high at end", high, 1, fffd, 3);
+    static const uint16_t low[] = { 0xDE00 };
+    ExpectUtf8("lone low", low, 1, fffd, 3);
+
+    static const uint16_t highThenAscii[] = { 0xD83D, 'x' };
+    static const uint8_t highThenAsciiUtf8[] = { 0xEF, 0xBF, 0xBD, 'x' };
+    ExpectUtf8("high before ASCII", highThenAscii, 2, highThenAsciiUtf8, 4);
+
+    // Reversed order is two lone surrogates, and two highs are not a pair either
+    static const uint16_t reversed[] = { 0xDE00, 0xD83D };
+    static const uint8_t twoFffd[] = { 0xEF, 0xBF, 0xBD, 0xEF, 0xBF, 0xBD };
+    ExpectUtf8("low then high", reversed, 2, twoFffd, 6);
+    static const uint16_t highHighLow[] = { 0xD83D, 0xD83D, 0xDE00 };
+    static const uint8_t highHighLowUtf8[] = { 0xEF, 0xBF, 0xBD, 0xF0, 0x9F, 0x98, 0x80 };
+    ExpectUtf8("high then pair", highHighLow, 3, highHighLowUtf8, 7);
+
+    // Surrogates encoded directly in UTF-8 (CESU) are invalid: ED is limited to 80-9F
+    static const uint8_t cesu[] = { 0xED, 0xA0, 0xBD, 0xED, 0xB8, 0x80 };
+    static const uint16_t cesuUtf16[] = { 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD };
+    ExpectUtf16("encoded surrogates", cesu, 6, cesuUtf16, 6);
+}
+
+static void TestSplitPairs(void) {
+    static const uint16_t smile[] = { 0xD83D, 0xDE00 };
+    static const uint8_t fffd[] = { 0xEF, 0xBF, 0xBD };
+
+    // Utf16ToUtf8 keeps no state, so each half of a pair split across calls is unpaired
+    ExpectUtf8("first half of split pair", smile, 1, fffd, 3);
+    ExpectUtf8("second half of split pair", smile + 1, 1, fffd, 3);
+
+    // WriteUtf16AsUtf8 transcodes in blocks and must not cut a pair at a block boundary
+    static uint16_t text[MAX_UNITS];
+    static uint8_t expected[MAX_UNITS * UTF8_MAX_PER_UTF16];
+    static uint8_t written[MAX_UNITS * UTF8_MAX_PER_UTF16];
+    const size_t blockUnits = 8192;
+    for (size_t at = blockUnits - 2; at <= blockUnits; at++) {
+        size_t length = 2 * blockUnits + 3;
+        size_t expectedLength = 0;
+        for (size_t i = 0; i < length; i++) text[i] = (uint16_t)('a' + i % 26);
+        text[at] = smile[0];
+        text[at + 1] = smile[1];
+        text[2 * blockUnits - 1] = smile[0];
+        text[2 * blockUnits] = smile[1];
+        expectedLength = Utf16ToUtf8(text, length, expected);
+
+        FILE *file = tmpfile();
+        if (!file) {
+            perror("tmpfile");
+            exit(2);
+        }
+        bool ok = WriteUtf16AsUtf8(file, text, length);
+        rewind(file);
+        size_t writtenLength = fread(written, 1, sizeof(written), file);
+        fclose(file);
+
+        checks++;
+        if (!ok || writtenLength != expectedLength || memcmp(written, expected, expectedLength) != 0 ||
+            memmem(written, writtenLength, fffd, sizeof(fffd)) != NULL) {
+            failures++;
+            fprintf(stderr, "FAIL pair at unit %u across a WriteUtf16AsUtf8 block (%u of %u bytes)\n",
+                    (unsigned)at, (unsigned)writtenLength, (unsigned)expectedLength);
+        }
+    }
+
+    // UTF-16LE strings in memory: a pair whose high half fills the last slot of a run, fed in two appends
+    // that split the high half between its bytes
+    char *output = NULL;
+    size_t outputSize = 0;
+    FILE *file = open_memstream(&output, &outputSize);
+    StringExtractor extractor;
+    BeginStringExtraction(&extractor, file);
+    BeginStringRegion(&extractor, 0x1000);
+    uint8_t memory[(STRING_MAX_LENGTH + 8) * 2];
+    for (size_t i = 0; i < STRING_MAX_LENGTH + 8; i++) {
+        uint16_t unit = (uint16_t)('a' + i % 26);
+        if (i == STRING_MAX_LENGTH - 1) unit = smile[0];
+        if (i == STRING_MAX_LENGTH) unit = smile[1];
+        memory[2 * i] = (uint8_t)unit;
+        memory[2 * i + 1] = (uint8_t)(unit >> 8);
+    }
+    AppendStringData(&extractor, memory, STRING_MAX_LENGTH * 2 - 1);
+    AppendStringData(&extractor, memory + STRING_MAX_LENGTH * 2 - 1, sizeof(memory) - (STRING_MAX_LENGTH * 2 - 1));
+    EndStringRegion(&extractor);
+    fclose(file);
+
+    checks++;
+    if (!output || !memmem(output, outputSize, "\xF0\x9F\x98\x80", 4) || memmem(output, outputSize, fffd, sizeof(fffd))) {
+        failures++;
+        fprintf(stderr, "FAIL pair at the end of a full UTF-16LE string run\n");
+    }
+    free(output);
+}
+
+static void TestMalformedUtf8(void) {
+    // Overlong forms of '/', U+0000 and U+FFFF: C0/C1 are never valid, E0 and F0 need a higher second byte
+    static const uint8_t overlong2[] = { 0xC0, 0xAF, 'x' };
+    static const uint16_t overlong2Utf16[] = { 0xFFFD, 0xFFFD, 'x' };
+    ExpectUtf16("overlong C0 AF", overlong2, 3, overlong2Utf16, 3);
+    static const uint8_t overlongNul[] = { 0xC1, 0x80 };
+    static const uint16_t overlongNulUtf16[] = { 0xFFFD, 0xFFFD };
+    ExpectUtf16("overlong C1 80", overlongNul, 2, overlongNulUtf16, 2);
+    static const uint8_t overlong3[] = { 0xE0, 0x80, 0xAF };
+    static const uint16_t overlong3Utf16[] = { 0xFFFD, 0xFFFD, 0xFFFD };
+    ExpectUtf16("overlong E0 80 AF", overlong3, 3, overlong3Utf16, 3);
+    static const uint8_t overlong4[] = { 0xF0, 0x8F, 0xBF, 0xBF };
+    static const uint16_t overlong4Utf16[] = { 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD };
+    ExpectUtf16("overlong F0 8F BF BF", overlong4, 4, overlong4Utf16, 4);
+
+    // Above U+10FFFF and bytes that never start a sequence
+    static const uint8_t tooLarge[] = { 0xF4, 0x90, 0x80, 0x80 };
+    ExpectUtf16("F4 90 80 80", tooLarge, 4, overlong4Utf16, 4);
+    static const uint8_t neverLead[] = { 0xF5, 0xFF, 0x80 };
+    ExpectUtf16("F5 FF 80", neverLead, 3, overlong3Utf16, 3);
+
+    // Truncated sequences: one U+FFFD for the whole valid prefix, whether cut by the end or by another byte
+    static const uint8_t truncatedEnd[] = { 'a', 0xF0, 0x9F, 0x98 };
+    static const uint16_t truncatedEndUtf16[] = { 'a', 0xFFFD };
+    ExpectUtf16("truncated 4-byte at end", truncatedEnd, 4, truncatedEndUtf16, 2);
+    static const uint8_t truncated3[] = { 0xE2, 0x82, 'b' };
+    static const uint16_t truncated3Utf16[] = { 0xFFFD, 'b' };
+    ExpectUtf16("truncated 3-byte before ASCII", truncated3, 3, truncated3Utf16, 2);
+    static const uint8_t truncatedThenValid[] = { 0xF0, 0x9F, 0xF0, 0x9F, 0x98, 0x80 };
+    static const uint16_t truncatedThenValidUtf16[] = { 0xFFFD, 0xD83D, 0xDE00 };
+    ExpectUtf16("truncated 4-byte before a pair", truncatedThenValid, 6, truncatedThenValidUtf16, 3);
+    static const uint8_t lone[] = { 0x80, 0xBF };
+    static const uint16_t loneUtf16[] = { 0xFFFD, 0xFFFD };
+    ExpectUtf16("lone continuation bytes", lone, 2, loneUtf16, 2);
+
+    // A malformed sequence right after a 16-byte ASCII block, and one cut by the end of the input
+    uint8_t block[20];
+    uint16_t blockUtf16[20];
+    for (size_t i = 0; i < 16; i++) {
+        block[i] = (uint8_t)('0' + i % 10);
+        blockUtf16[i] = block[i];
+    }
+    block[16] = 0xE2;
+    block[17] = 0x28;
+    blockUtf16[16] = 0xFFFD;
+    blockUtf16[17] = 0x28;
+    ExpectUtf16("truncated after SSE2 block", block, 18, blockUtf16, 18);
+    block[17] = 0x82;
+    ExpectUtf16("truncated at end after SSE2 block", block, 18, blockUtf16, 17);
+}
+
+int main(void) {
+    TestValidPairs();
+    TestLoneSurrogates();
+    TestSplitPairs();
+    TestMalformedUtf8();
+
+    printf("%d of %d text encoding checks passed\n", checks - failures, checks);
+    return failures ? 1 : 0;
+}
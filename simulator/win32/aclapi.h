@@ -0,0 +1,7 @@
+#ifndef SIM_ACLAPI_H
+#define SIM_ACLAPI_H
+
+// Stands in for the Windows SDK header when the toolkit is built against the simulator
+#include "../Sim_Win32.h"
+
+#endif